@@ -3,10 +3,16 @@
 #include <functional>
 #include <print>
 
+#include "aes.hpp"
+#include "aes1rhash.hpp"
+#include "aes1rrandom.hpp"
+#include "aes4rrandom.hpp"
 #include "argon2d.hpp"
 #include "blake2b.hpp"
+#include "cpuinfo.hpp"
 #include "dataset.hpp"
 #include "hasher.hpp"
+#include "isa.hpp"
 #include "superscalar.hpp"
 #include "trace.hpp"
 
@@ -136,17 +142,25 @@ struct Options {
     }
 };
 
+void printCPUInfo();
 void hasherBenchmark(const Options options);
 void microbenchmarks();
 void blake2bBenchmark();
+void blake2bManyBenchmark();
 void blake2bLongBenchmark();
 void argon2dFillMemoryBenchmark();
+void aesGenerator1RFillBenchmark();
+void aesGenerator4RFillBenchmark();
+void aesHashAndFill1RBenchmark();
 void superscalarGenerateBenchmark();
 void datasetGenerateBenchmark();
+void datasetGenerateYMMBenchmark();
 
 std::array<std::byte, 64> data;
 std::array<std::byte, 72> data_long;
 std::array<std::byte, 64> hash;
+std::array<std::array<std::byte, 64>, blake2b::Multi_Buffer_Lanes> data_many;
+std::array<std::array<std::byte, 64>, blake2b::Multi_Buffer_Lanes> hash_many;
 std::vector<std::byte> hash_long(1024, std::byte(0));
 HeapArray<argon2d::Block, 4096> memory(Rx_Argon2d_Memory_Blocks);
 std::vector<std::byte> aes_input;
@@ -184,6 +198,8 @@ int main(int argc, char **argv) {
         }
     }
 
+    printCPUInfo();
+
     if (options.microbenchmarks) {
         microbenchmarks();
     }
@@ -191,6 +207,23 @@ int main(int argc, char **argv) {
     hasherBenchmark(options);
 }
 
+void printCPUInfo() {
+    const auto topology{ CPUInfo::topology() };
+    constexpr std::array<std::string_view, 4> Cache_Types{ "", "d", "i", "" };
+
+    std::println("CPU features: AVX2: {}, AVX512F: {}, AVX512VL: {}, AVX512DQ: {}, AVX512BW: {}, AVX512VBMI: {}, AES: {}, VAES: {}", 
+        CPUInfo::AVX2(), CPUInfo::AVX512F(), CPUInfo::AVX512VL(), CPUInfo::AVX512DQ(), CPUInfo::AVX512BW(), CPUInfo::AVX512VBMI(), CPUInfo::AES(), CPUInfo::VAES());
+    std::println("CPU topology (per package): {:d} logical processors, {:d} physical cores, {:d} threads per core{}", 
+        topology.logical_processors, topology.physical_cores, topology.threads_per_core, topology.hybrid ? ", hybrid" : "");
+
+    for (const auto& cache : topology.caches) {
+        std::println("- L{:d}{:s}: {:d} KB, {:d}-way, {:d}B line, shared by {:d} logical processors", 
+            cache.level, Cache_Types[static_cast<uint8_t>(cache.type)], cache.size / 1024, cache.ways, cache.line_size, cache.shared_by);
+    }
+
+    std::println("");
+}
+
 void hasherBenchmark(const Options options) {
     TraceResults trace_results;
 
@@ -299,12 +332,22 @@ void microbenchmarks() {
         program = superscalar.generate();
     }
 
+    aes_input.resize(Rx_Scratchpad_L3_Size);
+    program_input.resize(Rx_Program_Bytes_Size);
+    const std::string_view aes_isa{ intrinsics::aes::vaesSelected() ? "VAES" : "AES-NI" };
+    const std::string_view ymm_mode{ selectedIsa() == Isa::AVX512 ? "YMM" : "AVX2" };
+
     std::vector<Benchmark> benchmarks{
         { "Blake2b::hash (64B input/output)", 1, "H/s", blake2bBenchmark },
+        { std::format("Blake2b::hashMany ({:d}x64B input/output)", blake2b::Multi_Buffer_Lanes), blake2b::Multi_Buffer_Lanes, "H/s", blake2bManyBenchmark },
         { "Argon2d::Blake2b::hash (72B input, 1 KB output)", 1, "H/s", blake2bLongBenchmark },
         { "Argon2d::fillMemory (256MB output)", 268'435'456, "B/s", argon2dFillMemoryBenchmark },
+        { std::format("AesGenerator1R::fill {:s} ({:d}B output)", aes_isa, Rx_Scratchpad_L3_Size), Rx_Scratchpad_L3_Size, "B/s", aesGenerator1RFillBenchmark },
+        { std::format("AesGenerator4R::fill {:s} ({:d}B output)", aes_isa, Rx_Program_Bytes_Size), Rx_Program_Bytes_Size, "B/s", aesGenerator4RFillBenchmark },
+        { std::format("AesHash1R::hashAndFill {:s} ({:d}B input/output)", aes_isa, Rx_Scratchpad_L3_Size), Rx_Scratchpad_L3_Size, "B/s", aesHashAndFill1RBenchmark },
         { "Superscalar::generate (1 Program output)", 1, "Program/s", superscalarGenerateBenchmark },
         { std::format("Dataset::generate ({:d}B output)", Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size), Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size, "B/s", datasetGenerateBenchmark },
+        { std::format("Dataset::generate {:s} ({:d}B output)", ymm_mode, Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size), Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size, "B/s", datasetGenerateYMMBenchmark },
     };
 
     std::println("Running {:d} benchmarks...\n", benchmarks.size());
@@ -315,6 +358,17 @@ void blake2bBenchmark() {
     blake2b::hash(hash, data);
 }
 
+void blake2bManyBenchmark() {
+    std::array<std::span<const std::byte>, blake2b::Multi_Buffer_Lanes> inputs;
+    std::array<std::span<std::byte>, blake2b::Multi_Buffer_Lanes> outputs;
+    for (uint32_t i = 0; i < blake2b::Multi_Buffer_Lanes; ++i) {
+        inputs[i] = data_many[i];
+        outputs[i] = hash_many[i];
+    }
+
+    blake2b::hashMany(outputs, inputs);
+}
+
 void blake2bLongBenchmark() {
     argon2d::blake2b::hash(hash_long, data_long);
 }
@@ -325,6 +379,18 @@ void argon2dFillMemoryBenchmark() {
     argon2d::fillMemory(memory.buffer(), block_template.view());
 }
 
+void aesGenerator1RFillBenchmark() {
+    aes::fill1R(aes_input, hash);
+}
+
+void aesGenerator4RFillBenchmark() {
+    aes::fill4R(program_input, hash);
+}
+
+void aesHashAndFill1RBenchmark() {
+    aes::hashAndFill1R(data, hash, aes_input);
+}
+
 void superscalarGenerateBenchmark() {
     auto _ { superscalar.generate() };
 }
@@ -336,3 +402,13 @@ void datasetGenerateBenchmark() {
 
     auto _ { generateDataset(memory.view(), programs)};
 }
+
+void datasetGenerateYMMBenchmark() {
+    for (auto& program : programs) {
+        program = superscalar.generate();
+    }
+
+    // YMM mode requires AVX512VL/DQ extensions.
+    const auto mode{ selectedIsa() == Isa::AVX512 ? DatasetCompilerMode::YMM : DatasetCompilerMode::AVX2 };
+    auto _ { generateDataset(memory.view(), programs, mode)};
+}
@@ -1,9 +1,9 @@
 #include <print>
-#include <thread>
 
 #include "3rdparty/RandomX/src/dataset.hpp"
 #include "3rdparty/RandomX/src/jit_compiler.hpp"
 
+#include "threadpool.hpp"
 #include "virtualmachine.hpp"
 
 using namespace modernRX;
@@ -32,14 +32,14 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
         auto dataset{ generateDataset(cache.view(), programs) };
         HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad(VirtualMachine::requiredMemory());
         auto vm_scratchpad = scratchpad.buffer<VirtualMachine::requiredMemory()>();
-        auto vm_jit_buffer = makeExecutable<JITRxProgram>(12 * 1024);
+        DualMappedMemory vm_jit_buffer(VirtualMachine::requiredCodeMemory());
 
-        VirtualMachine vm(vm_scratchpad, reinterpret_cast<JITRxProgram>(vm_jit_buffer.get()));
+        VirtualMachine vm(vm_scratchpad, JITRxBuffer{ vm_jit_buffer.writable(), vm_jit_buffer.executable<JITRxProgram>() });
         BlockTemplate bt;
         std::memcpy(bt.data, key_or_data.data(), key_or_data.size());
 
         // Initialize RandomX dataset and VM
-        auto initThreadCount{ std::thread::hardware_concurrency() };
+        auto initThreadCount{ ThreadPool::global().size() };
         auto rx_flags{ randomx_get_flags() | RANDOMX_FLAG_FULL_MEM };
         auto rx_cache{ randomx_alloc_cache(rx_flags) };
         randomx_init_cache(rx_cache, key_or_data.data(), key_or_data.size());
@@ -48,18 +48,12 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
         auto datasetItemCount{ randomx_dataset_item_count() };
         auto perThread{ datasetItemCount / initThreadCount };
         auto remainder{ datasetItemCount % initThreadCount };
-        auto startItem{ 0 };
-        std::vector<std::thread> threads;
 
-        for (int i = 0; i < initThreadCount; ++i) {
+        ThreadPool::global().parallelFor(initThreadCount, [&](const uint32_t i) {
+            auto startItem{ i * perThread };
             auto count{ perThread + (i == initThreadCount - 1 ? remainder : 0) };
-            threads.push_back(std::thread(&randomx_init_dataset, rx_dataset, rx_cache, startItem, count));
-            startItem += count;
-        }
-
-        for (unsigned i = 0; i < threads.size(); ++i) {
-            threads[i].join();
-        }
+            randomx_init_dataset(rx_dataset, rx_cache, startItem, count);
+        });
 
         randomx_vm* rx_vm = randomx_create_vm(rx_flags, rx_cache, rx_dataset);
         std::array<uint8_t, RANDOMX_HASH_SIZE> randomx_hash{};
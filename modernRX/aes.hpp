@@ -7,9 +7,22 @@
 #include <span>
 
 #include "aliases.hpp"
+#include "cpuinfo.hpp"
 #include "intrinsics.hpp"
+#include "isa.hpp"
 
 namespace modernRX::intrinsics::aes {
+    // True if CPU supports VAES on ZMM registers, so AES generators and hashes can process four 128-bit states with single instruction.
+    // Some CPUs (eg. Zen 3) support VAES only on YMM registers, so AVX512F is required as well.
+    inline const bool Vaes_Supported{ CPUInfo::VAES() && CPUInfo::AVX512F() };
+
+    // Returns true if VAES kernels should be used. They are skipped if kernels for instruction set other than AVX512 were selected.
+    [[nodiscard]] inline bool vaesSelected() noexcept {
+        return Vaes_Supported && selectedIsa() == Isa::AVX512;
+    }
+
+    // Qword mask selecting lanes 1 and 3 of ZMM register. RandomX applies AES encoding to these lanes and decoding to lanes 0 and 2 (or the other way round).
+    inline constexpr __mmask8 Odd_Lanes{ 0b1100'1100 };
 
     // Performs AES encoding of an input state with given key.
     // Overwrites input state with encoding result.
@@ -22,4 +35,22 @@ namespace modernRX::intrinsics::aes {
     inline void decode(xmm128i_t& state, const xmm128i_t key) noexcept {
         state = _mm_aesdec_si128(state, key);
     }
+
+    // Performs AES encoding of every 128-bit lane of an input state with corresponding lane of given key.
+    // Overwrites input state with encoding result. Requires VAES.
+    inline void encode(zmm<int>& state, const zmm<int> key) noexcept {
+        state = _mm512_aesenc_epi128(state, key);
+    }
+
+    // Performs AES decoding of every 128-bit lane of an input state with corresponding lane of given key.
+    // Overwrites input state with decoding result. Requires VAES.
+    inline void decode(zmm<int>& state, const zmm<int> key) noexcept {
+        state = _mm512_aesdec_epi128(state, key);
+    }
+
+    // Returns ZMM register with given 128-bit values in lanes 0, 1, 2 and 3.
+    [[nodiscard]] inline zmm<int> lanes(const xmm128i_t lane0, const xmm128i_t lane1, const xmm128i_t lane2, const xmm128i_t lane3) noexcept {
+        const auto low{ _mm512_castsi128_si512(lane0) };
+        return _mm512_inserti32x4(_mm512_inserti32x4(_mm512_inserti32x4(low, lane1, 1), lane2, 2), lane3, 3);
+    }
 }
@@ -8,18 +8,7 @@
 #include "sse.hpp"
 
 namespace modernRX::aes {
-    template void fill4R<true>(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept;
-    template void fill4R<false>(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept;
-
-    template<bool Fixed>
-    void fill4R(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept {
-        ASSERTUME(output.size() > 0 && output.size() % 64 == 0);
-
-        intrinsics::xmm128i_t& seed0{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data()) };
-        intrinsics::xmm128i_t& seed1{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 16) };
-        intrinsics::xmm128i_t& seed2{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 32) };
-        intrinsics::xmm128i_t& seed3{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 48) };
-
+    namespace {
         // key0, key1, key2, key3 = Blake2b-512("RandomX AesGenerator4R keys 0-3")
         // key4, key5, key6, key7 = Blake2b-512("RandomX AesGenerator4R keys 4-7")
         // key0 = dd aa 21 64 db 3d 83 d1 2b 6d 54 2f 3f d2 e5 99
@@ -31,22 +20,74 @@ namespace modernRX::aes {
         // key6 = e7 c9 73 f2 8b a3 65 f7 0a 66 a9 2b a7 ef 3b f6
         // key7 = 09 d6 7c 7a de 39 58 91 fd d1 06 0c 2d 76 b0 c0
         constexpr auto key0{ intrinsics::fromChars(0xdd, 0xaa, 0x21, 0x64, 0xdb, 0x3d, 0x83, 0xd1, 0x2b, 0x6d, 0x54, 0x2f, 0x3f, 0xd2, 0xe5, 0x99) };
-        auto state0{ intrinsics::sse::vload<int>(seed.data()) };
-        auto state1{ intrinsics::sse::vload<int>(seed.data() + 16) };
-
-        constexpr auto key4{ intrinsics::fromChars(0x73, 0x6f, 0x82, 0xb5, 0xa6, 0xa7, 0xd6, 0xe3, 0x6d, 0x8b, 0x51, 0x3d, 0xb4, 0xff, 0x9e, 0x22) };
-        auto state2{ intrinsics::sse::vload<int>(seed.data() + 32) };
-        auto state3{ intrinsics::sse::vload<int>(seed.data() + 48) };
-
         constexpr auto key1{ intrinsics::fromChars(0x50, 0x34, 0x0e, 0xb2, 0x55, 0x3f, 0x91, 0xb6, 0x53, 0x9d, 0xf7, 0x06, 0xe5, 0xcd, 0xdf, 0xa5) };
-        constexpr auto key5{ intrinsics::fromChars(0xf3, 0x6b, 0x56, 0xc7, 0xd9, 0xb3, 0x10, 0x9c, 0x4e, 0x4d, 0x02, 0xe9, 0xd2, 0xb7, 0x72, 0xb2) };
         constexpr auto key2{ intrinsics::fromChars(0x04, 0xd9, 0x3e, 0x5c, 0xaf, 0x7b, 0x5e, 0x51, 0x9f, 0x67, 0xa4, 0x0a, 0xbf, 0x02, 0x1c, 0x17) };
-        constexpr auto key6{ intrinsics::fromChars(0xe7, 0xc9, 0x73, 0xf2, 0x8b, 0xa3, 0x65, 0xf7, 0x0a, 0x66, 0xa9, 0x2b, 0xa7, 0xef, 0x3b, 0xf6) };
         constexpr auto key3{ intrinsics::fromChars(0x63, 0x37, 0x62, 0x85, 0x08, 0x5d, 0x8f, 0xe7, 0x85, 0x37, 0x67, 0xcd, 0x91, 0xd2, 0xde, 0xd8) };
+        constexpr auto key4{ intrinsics::fromChars(0x73, 0x6f, 0x82, 0xb5, 0xa6, 0xa7, 0xd6, 0xe3, 0x6d, 0x8b, 0x51, 0x3d, 0xb4, 0xff, 0x9e, 0x22) };
+        constexpr auto key5{ intrinsics::fromChars(0xf3, 0x6b, 0x56, 0xc7, 0xd9, 0xb3, 0x10, 0x9c, 0x4e, 0x4d, 0x02, 0xe9, 0xd2, 0xb7, 0x72, 0xb2) };
+        constexpr auto key6{ intrinsics::fromChars(0xe7, 0xc9, 0x73, 0xf2, 0x8b, 0xa3, 0x65, 0xf7, 0x0a, 0x66, 0xa9, 0x2b, 0xa7, 0xef, 0x3b, 0xf6) };
         constexpr auto key7{ intrinsics::fromChars(0x09, 0xd6, 0x7c, 0x7a, 0xde, 0x39, 0x58, 0x91, 0xfd, 0xd1, 0x06, 0x0c, 0x2d, 0x76, 0xb0, 0xc0) };
 
+        // Mask applied to program instructions (all but first 128 bytes), limits dst and src registers to 0-7.
         constexpr auto mask{ intrinsics::fromChars(0xff, 0x07, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x07, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff) };
 
+        // VAES version of fill4R. States 0 and 2 are only decoded, states 1 and 3 only encoded, so they are kept in two registers
+        // (valid lanes 0 and 2 in one of them and 1 and 3 in the other) and lanes are merged only for stores.
+        template<bool Fixed>
+        void fill4RVaes(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept {
+            const auto keys0{ intrinsics::aes::lanes(key0, key0, key4, key4) };
+            const auto keys1{ intrinsics::aes::lanes(key1, key1, key5, key5) };
+            const auto keys2{ intrinsics::aes::lanes(key2, key2, key6, key6) };
+            const auto keys3{ intrinsics::aes::lanes(key3, key3, key7, key7) };
+            const auto mask4{ _mm512_broadcast_i32x4(mask) };
+
+            auto dec_state{ _mm512_loadu_si512(seed.data()) };
+            auto enc_state{ dec_state };
+
+            for (size_t i = 0; i < (Fixed ? Rx_Program_Bytes_Size : output.size()); i += 64) {
+                intrinsics::aes::decode(dec_state, keys0);
+                intrinsics::aes::encode(enc_state, keys0);
+                intrinsics::aes::decode(dec_state, keys1);
+                intrinsics::aes::encode(enc_state, keys1);
+                intrinsics::aes::decode(dec_state, keys2);
+                intrinsics::aes::encode(enc_state, keys2);
+                intrinsics::aes::decode(dec_state, keys3);
+                intrinsics::aes::encode(enc_state, keys3);
+
+                const auto state{ _mm512_mask_blend_epi64(intrinsics::aes::Odd_Lanes, dec_state, enc_state) };
+                if constexpr (Fixed) {
+                    _mm512_storeu_si512(output.data() + i, i >= 128 ? _mm512_and_si512(state, mask4) : state);
+                } else {
+                    _mm512_storeu_si512(output.data() + i, state);
+                }
+            }
+
+            _mm512_storeu_si512(seed.data(), _mm512_mask_blend_epi64(intrinsics::aes::Odd_Lanes, dec_state, enc_state));
+        }
+    }
+
+    template void fill4R<true>(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept;
+    template void fill4R<false>(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept;
+
+    template<bool Fixed>
+    void fill4R(std::span<std::byte> output, std::span<std::byte, 64> seed) noexcept {
+        ASSERTUME(output.size() > 0 && output.size() % 64 == 0);
+
+        if (intrinsics::aes::vaesSelected()) {
+            fill4RVaes<Fixed>(output, seed);
+            return;
+        }
+
+        intrinsics::xmm128i_t& seed0{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data()) };
+        intrinsics::xmm128i_t& seed1{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 16) };
+        intrinsics::xmm128i_t& seed2{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 32) };
+        intrinsics::xmm128i_t& seed3{ *reinterpret_cast<intrinsics::xmm128i_t*>(seed.data() + 48) };
+
+        auto state0{ intrinsics::sse::vload<int>(seed.data()) };
+        auto state1{ intrinsics::sse::vload<int>(seed.data() + 16) };
+        auto state2{ intrinsics::sse::vload<int>(seed.data() + 32) };
+        auto state3{ intrinsics::sse::vload<int>(seed.data() + 48) };
+
         // Switch between fixed and variable output size. 
         for (size_t i = 0; i < (Fixed ? Rx_Program_Bytes_Size : output.size()); i += 64) {
             intrinsics::aes::decode(state0, key0);
@@ -1,12 +1,15 @@
 ﻿#include <bit>
 #include <format>
+#include <vector>
 
 #include "argon2d.hpp"
+#include "argon2davx2.hpp"
 #include "argon2davx512.hpp"
 #include "assertume.hpp"
 #include "blake2b.hpp"
 #include "cast.hpp"
 #include "intrinsics.hpp"
+#include "isa.hpp"
 
 namespace modernRX::argon2d {
     namespace {
@@ -23,10 +26,15 @@ namespace modernRX::argon2d {
         [[nodiscard]] consteval uint32_t blocksPerLane() noexcept;
         [[nodiscard]] consteval uint32_t blocksPerSlice() noexcept;
         [[nodiscard]] std::array<std::byte, Initial_Hash_Size> initialize(const_span<std::byte> password) noexcept;
+        [[nodiscard]] std::array<std::byte, Initial_Hash_Size> initializeAny(const_span<std::byte> password) noexcept;
+
+        template<Isa Target>
         void makeFirstPass(std::span<Block> memory, const_span<std::byte, Initial_Hash_Size> hash) noexcept;
+
+        template<Isa Target>
         void makeSecondPass(std::span<Block> memory) noexcept;
 
-        template<bool XorBlocks>
+        template<bool XorBlocks, Isa Target>
         void mixBlocks(std::span<Block> memory, BlockContext& ctx) noexcept;
 
         template<bool XorBlocks>
@@ -36,13 +44,19 @@ namespace modernRX::argon2d {
     void fillMemory(std::span<Block> memory, const_span<std::byte> password) noexcept {
         // Some assumptions were made to optimize this function:
         //   - This function is only called with memory that size is Rx_Argon2d_Memory_Blocks.
-        //   - This function is only called with password that size is equal to block template.
+        //   - Password usually has size of block template (other sizes are handled by slower path).
         ASSERTUME(memory.size() == Rx_Argon2d_Memory_Blocks);
-        ASSERTUME(password.size() > 0 && password.size() <= Rx_Block_Template_Size);
 
-        const auto hash{ initialize(password) };
-        makeFirstPass(memory, hash);
-        makeSecondPass(memory);
+        const bool fast_path{ password.size() > 0 && password.size() <= Rx_Block_Template_Size };
+        const auto hash{ fast_path ? initialize(password) : initializeAny(password) };
+
+        if (selectedIsa() == Isa::AVX512) {
+            makeFirstPass<Isa::AVX512>(memory, hash);
+            makeSecondPass<Isa::AVX512>(memory);
+        } else {
+            makeFirstPass<Isa::AVX2>(memory, hash);
+            makeSecondPass<Isa::AVX2>(memory);
+        }
     }
 
     namespace blake2b {
@@ -135,6 +149,38 @@ namespace modernRX::argon2d {
             return hash;
         }
 
+        // Same as initialize, but for password of any size (including empty one), which may not fit into single Blake2b block with other parameters.
+        // Used only for keys coming from outside of RandomX algorithm (e.g. C interface), so it is not optimized.
+        std::array<std::byte, Initial_Hash_Size> initializeAny(const_span<std::byte> password) noexcept {
+            std::vector<std::byte> input;
+            const auto append = [&input](const_span<std::byte> data) {
+                input.insert(input.end(), data.begin(), data.end());
+            };
+            const auto appendUint32 = [&append](const uint32_t value) {
+                append(span_cast<const std::byte, sizeof(uint32_t)>(value));
+            };
+
+            appendUint32(Rx_Argon2d_Parallelism);
+            appendUint32(Rx_Argon2d_Tag_Length);
+            appendUint32(Rx_Argon2d_Memory_Blocks);
+            appendUint32(Rx_Argon2d_Iterations);
+            appendUint32(Rx_Argon2d_Version);
+            appendUint32(Rx_Argon2d_Type);
+            appendUint32(static_cast<uint32_t>(password.size()));
+            append(password);
+            appendUint32(static_cast<uint32_t>(Rx_Argon2d_Salt.size()));
+            append(Rx_Argon2d_Salt);
+            appendUint32(static_cast<uint32_t>(Rx_Argon2d_Secret.size()));
+            append(Rx_Argon2d_Secret);
+            appendUint32(static_cast<uint32_t>(Rx_Argon2d_Data.size()));
+            append(Rx_Argon2d_Data);
+
+            std::array<std::byte, Initial_Hash_Size> hash{};
+            modernRX::blake2b::hashAny(hash, input);
+
+            return hash;
+        }
+
         /*
         * Performs first iteration of filling memory in two steps:
         * 1. Initializes first three blocks of every memory lane, because they are special cases:
@@ -160,6 +206,7 @@ namespace modernRX::argon2d {
         *
         * Function was simplified with assumption that parallelism is always 1, thus no synchronization is needed because there is always only one thread.
         */
+        template<Isa Target>
         void makeFirstPass(std::span<Block> memory, const_span<std::byte, Initial_Hash_Size> hash) noexcept {
             // Below assertion is very limiting and removing this will not simply make function work with other values.
             static_assert(Rx_Argon2d_Parallelism == 1, "This simplification requires parallelism to be 1.");
@@ -184,7 +231,7 @@ namespace modernRX::argon2d {
             // Calculate next blocks in a lane.
             for (BlockContext ctx{ 2, 1, 0 }; ctx.cur_idx < blocksPerLane(); ) {
                 intrinsics::prefetch<intrinsics::PrefetchMode::T0, 16>(&memory[(ctx.cur_idx + 2) % Rx_Argon2d_Memory_Blocks]);
-                mixBlocks<false>(memory, ctx);
+                mixBlocks<false, Target>(memory, ctx);
             }
         }
 
@@ -201,6 +248,7 @@ namespace modernRX::argon2d {
         *
         * For more details check https://github.com/P-H-C/phc-winner-argon2/blob/master/argon2-specs.pdf section 3.2 and 3.3.
         */
+        template<Isa Target>
         void makeSecondPass(std::span<Block> memory) noexcept {
             // Below assertion is very limiting and removing this will not simply make function work with other values.
             static_assert(Rx_Argon2d_Parallelism == 1, "This simplification requires parallelism to be 1.");
@@ -221,13 +269,13 @@ namespace modernRX::argon2d {
                 // Calculate all next blocks in a lane.
                 for (BlockContext ctx{ 0, prev_idx, ref_index }; ctx.cur_idx < blocksPerLane(); ) {
                     intrinsics::prefetch<intrinsics::PrefetchMode::T0, 16>(&memory[(ctx.cur_idx + 2) % Rx_Argon2d_Memory_Blocks]);
-                    mixBlocks<true>(memory, ctx);
+                    mixBlocks<true, Target>(memory, ctx);
                 }
             }
         }
 
         // Calculates reference index needed for mixing function and updates BlockContext for next iteration.
-        // This function is called inside ROUND_V2 macro to prefetch referenced block as soon as possible and reduce stalls because of cache misses.
+        // This function is called inside ROUND_V2 macro (or right after first column round for AVX2) to prefetch referenced block as soon as possible and reduce stalls because of cache misses.
         template<bool XorBlocks>
         void calcRefIndex(std::span<Block> memory, BlockContext& ctx, const uint32_t tmp_value) noexcept {
             static_assert(Rx_Argon2d_Parallelism == 1, "This simplification requires parallelism to be 1.");
@@ -267,11 +315,54 @@ namespace modernRX::argon2d {
         // Calculates current block based on previous and referenced random block.
         // If its first iteration XorBlocks should be false, otherwise should be true and will perform xor operation with overwritten block.
         // The mixing function refers to https://github.com/P-H-C/phc-winner-argon2/blob/master/argon2-specs.pdf section 3.4.
-        // Enhanced by AVX512 intrinsics.
-        template<bool XorBlocks>
+        // Enhanced by AVX512 intrinsics (or AVX2 intrinsics on CPUs without AVX512 support).
+        template<bool XorBlocks, Isa Target>
         void mixBlocks(std::span<Block> memory, BlockContext& ctx) noexcept {
             using namespace intrinsics;
 
+            if constexpr (Target == Isa::AVX2) {
+                constexpr uint32_t YMM_Per_Block{ Block_Size / sizeof(ymm<uint64_t>) };
+
+                alignas(64) ymm<uint64_t> tmp_block_ymm[YMM_Per_Block];
+                ymm<uint64_t> (&cur_block_ymm)[YMM_Per_Block]{ reinterpret_cast<ymm<uint64_t>(&)[YMM_Per_Block]>(memory[ctx.cur_idx]) };
+                const ymm<uint64_t> (&prev_block_ymm)[YMM_Per_Block] { reinterpret_cast<const ymm<uint64_t>(&)[YMM_Per_Block]>(memory[ctx.prev_idx]) };
+                const ymm<uint64_t> (&ref_block_ymm)[YMM_Per_Block] { reinterpret_cast<const ymm<uint64_t>(&)[YMM_Per_Block]>(memory[ctx.ref_idx]) };
+
+                // Initialize new block with previous and referenced ones.
+                for (uint32_t i = 0; i < YMM_Per_Block; ++i) {
+                    tmp_block_ymm[i] = avx2::vxor<uint64_t>(prev_block_ymm[i], ref_block_ymm[i]);
+                }
+
+                // Apply blake2b "rowwise" (8 rows, two per ROUND_AVX2_V1).
+                for (uint32_t i = 0; i < 4; ++i) {
+                    ROUND_AVX2_V1(tmp_block_ymm[8 * i + 0], tmp_block_ymm[8 * i + 4], tmp_block_ymm[8 * i + 1], tmp_block_ymm[8 * i + 5],
+                        tmp_block_ymm[8 * i + 2], tmp_block_ymm[8 * i + 6], tmp_block_ymm[8 * i + 3], tmp_block_ymm[8 * i + 7]);
+                }
+
+                // Apply blake2b "columnwise" (8 columns, two per ROUND_AVX2_V2).
+                // After first column round, first word of new block is final, so reference index can be calculated early for prefetching.
+                for (uint32_t i = 0; i < 4; ++i) {
+                    ROUND_AVX2_V2(tmp_block_ymm[0 + i], tmp_block_ymm[4 + i], tmp_block_ymm[8 + i], tmp_block_ymm[12 + i],
+                        tmp_block_ymm[16 + i], tmp_block_ymm[20 + i], tmp_block_ymm[24 + i], tmp_block_ymm[28 + i]);
+
+                    if (i == 0) {
+                        calcRefIndex<XorBlocks>(memory, ctx, static_cast<uint32_t>(_mm256_cvtsi256_si32(tmp_block_ymm[0])));
+                        prefetch<PrefetchMode::NTA, 16>(memory[ctx.ref_idx].data());
+                    }
+                }
+
+                // Finalize new block.
+                for (uint32_t i = 0; i < YMM_Per_Block; ++i) {
+                    if constexpr (XorBlocks) {
+                        cur_block_ymm[i] = avx2::vxor<uint64_t>(avx2::vxor<uint64_t>(avx2::vxor<uint64_t>(prev_block_ymm[i], tmp_block_ymm[i]), cur_block_ymm[i]), ref_block_ymm[i]);
+                    } else {
+                        cur_block_ymm[i] = avx2::vxor<uint64_t>(avx2::vxor<uint64_t>(prev_block_ymm[i], tmp_block_ymm[i]), ref_block_ymm[i]);
+                    }
+                }
+
+                return;
+            }
+
             constexpr uint32_t ZMM_Per_Block{ Block_Size / sizeof(zmm<uint64_t>) };
 
             // For some reason its faster to use C-array than std::array (at least for tmp_block_ymm).
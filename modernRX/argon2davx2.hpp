@@ -0,0 +1,153 @@
+#pragma once
+
+
+/*
+* Argon2d AVX2 single round function implementation based on libsodium implementation:
+* https://github.com/jedisct1/libsodium/blob/master/src/libsodium/crypto_pwhash/argon2/argon2-fill-block-avx2.c
+* https://github.com/jedisct1/libsodium/blob/master/src/libsodium/crypto_pwhash/argon2/blamka-round-avx2.h
+* Used as a fallback on CPUs without AVX512 support.
+*/
+
+#include "avx2.hpp"
+
+namespace modernRX::argon2d {
+    namespace {
+        inline intrinsics::ymm<uint64_t> muladd(const intrinsics::ymm<uint64_t> x, const intrinsics::ymm<uint64_t> y) noexcept {
+            const auto z{ intrinsics::avx2::vmul<uint64_t>(x, y) };
+            return intrinsics::avx2::vadd<uint64_t>(intrinsics::avx2::vadd<uint64_t>(x, y), intrinsics::avx2::vadd<uint64_t>(z, z));
+        }
+
+        // Rotation by 24 and 16 bits is a byte shuffle; rotation by 63 bits is emulated with shift and add.
+        inline intrinsics::ymm<uint64_t> ror24(const intrinsics::ymm<uint64_t> x) noexcept {
+            return intrinsics::avx2::vshuffleepi8<uint64_t>(x, intrinsics::avx2::vsetrepi8<uint64_t>(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+        }
+
+        inline intrinsics::ymm<uint64_t> ror16(const intrinsics::ymm<uint64_t> x) noexcept {
+            return intrinsics::avx2::vshuffleepi8<uint64_t>(x, intrinsics::avx2::vsetrepi8<uint64_t>(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+        }
+
+        inline intrinsics::ymm<uint64_t> ror63(const intrinsics::ymm<uint64_t> x) noexcept {
+            return intrinsics::avx2::vxor<uint64_t>(intrinsics::avx2::vsrlepi64<uint64_t, 63>(x), intrinsics::avx2::vadd<uint64_t>(x, x));
+        }
+    }
+
+#define G1_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                             \
+    do {                                                                                                            \
+        ymmA0 = muladd(ymmA0, ymmB0);                                                                               \
+        ymmA1 = muladd(ymmA1, ymmB1);                                                                               \
+                                                                                                                    \
+        ymmD0 = intrinsics::avx2::vxor<uint64_t>(ymmD0, ymmA0);                                                     \
+        ymmD1 = intrinsics::avx2::vxor<uint64_t>(ymmD1, ymmA1);                                                     \
+                                                                                                                    \
+        ymmD0 = intrinsics::avx2::vshuffleepi32<uint64_t, 0xb1>(ymmD0);                                             \
+        ymmD1 = intrinsics::avx2::vshuffleepi32<uint64_t, 0xb1>(ymmD1);                                             \
+                                                                                                                    \
+        ymmC0 = muladd(ymmC0, ymmD0);                                                                               \
+        ymmC1 = muladd(ymmC1, ymmD1);                                                                               \
+                                                                                                                    \
+        ymmB0 = intrinsics::avx2::vxor<uint64_t>(ymmB0, ymmC0);                                                     \
+        ymmB1 = intrinsics::avx2::vxor<uint64_t>(ymmB1, ymmC1);                                                     \
+                                                                                                                    \
+        ymmB0 = ror24(ymmB0);                                                                                       \
+        ymmB1 = ror24(ymmB1);                                                                                       \
+    } while(0);
+
+#define G2_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                             \
+    do {                                                                                                            \
+        ymmA0 = muladd(ymmA0, ymmB0);                                                                               \
+        ymmA1 = muladd(ymmA1, ymmB1);                                                                               \
+                                                                                                                    \
+        ymmD0 = intrinsics::avx2::vxor<uint64_t>(ymmD0, ymmA0);                                                     \
+        ymmD1 = intrinsics::avx2::vxor<uint64_t>(ymmD1, ymmA1);                                                     \
+                                                                                                                    \
+        ymmD0 = ror16(ymmD0);                                                                                       \
+        ymmD1 = ror16(ymmD1);                                                                                       \
+                                                                                                                    \
+        ymmC0 = muladd(ymmC0, ymmD0);                                                                               \
+        ymmC1 = muladd(ymmC1, ymmD1);                                                                               \
+                                                                                                                    \
+        ymmB0 = intrinsics::avx2::vxor<uint64_t>(ymmB0, ymmC0);                                                     \
+        ymmB1 = intrinsics::avx2::vxor<uint64_t>(ymmB1, ymmC1);                                                     \
+                                                                                                                    \
+        ymmB0 = ror63(ymmB0);                                                                                       \
+        ymmB1 = ror63(ymmB1);                                                                                       \
+    } while(0);
+
+#define DIAGONALIZE_1(ymmA0, ymmB0, ymmC0, ymmD0, ymmA1, ymmB1, ymmC1, ymmD1)                                       \
+    do {                                                                                                            \
+        ymmB0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x39>(ymmB0);                                             \
+        ymmC0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x4e>(ymmC0);                                             \
+        ymmD0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x93>(ymmD0);                                             \
+                                                                                                                    \
+        ymmB1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x39>(ymmB1);                                             \
+        ymmC1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x4e>(ymmC1);                                             \
+        ymmD1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x93>(ymmD1);                                             \
+    } while(0);
+
+#define UNDIAGONALIZE_1(ymmA0, ymmB0, ymmC0, ymmD0, ymmA1, ymmB1, ymmC1, ymmD1)                                     \
+    do {                                                                                                            \
+        ymmB0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x93>(ymmB0);                                             \
+        ymmC0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x4e>(ymmC0);                                             \
+        ymmD0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x39>(ymmD0);                                             \
+                                                                                                                    \
+        ymmB1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x93>(ymmB1);                                             \
+        ymmC1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x4e>(ymmC1);                                             \
+        ymmD1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0x39>(ymmD1);                                             \
+    } while(0);
+
+#define DIAGONALIZE_2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                       \
+    do {                                                                                                            \
+        auto t1{ intrinsics::avx2::vblendepi32<uint64_t, 0xcc>(ymmB0, ymmB1) };                                     \
+        auto t2{ intrinsics::avx2::vblendepi32<uint64_t, 0x33>(ymmB0, ymmB1) };                                     \
+        ymmB1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t1);                                                \
+        ymmB0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t2);                                                \
+                                                                                                                    \
+        std::swap(ymmC0, ymmC1);                                                                                    \
+                                                                                                                    \
+        t1 = intrinsics::avx2::vblendepi32<uint64_t, 0xcc>(ymmD0, ymmD1);                                           \
+        t2 = intrinsics::avx2::vblendepi32<uint64_t, 0x33>(ymmD0, ymmD1);                                           \
+        ymmD0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t1);                                                \
+        ymmD1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t2);                                                \
+    } while(0);
+
+#define UNDIAGONALIZE_2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                     \
+    do {                                                                                                            \
+        auto t1{ intrinsics::avx2::vblendepi32<uint64_t, 0xcc>(ymmB0, ymmB1) };                                     \
+        auto t2{ intrinsics::avx2::vblendepi32<uint64_t, 0x33>(ymmB0, ymmB1) };                                     \
+        ymmB0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t1);                                                \
+        ymmB1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t2);                                                \
+                                                                                                                    \
+        std::swap(ymmC0, ymmC1);                                                                                    \
+                                                                                                                    \
+        t1 = intrinsics::avx2::vblendepi32<uint64_t, 0x33>(ymmD0, ymmD1);                                           \
+        t2 = intrinsics::avx2::vblendepi32<uint64_t, 0xcc>(ymmD0, ymmD1);                                           \
+        ymmD0 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t1);                                                \
+        ymmD1 = intrinsics::avx2::vpermuteepi64<uint64_t, 0xb1>(t2);                                                \
+    } while(0);
+
+#define ROUND_AVX2_V1(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                       \
+    do {                                                                                                            \
+        G1_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+        G2_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+                                                                                                                    \
+        DIAGONALIZE_1(ymmA0, ymmB0, ymmC0, ymmD0, ymmA1, ymmB1, ymmC1, ymmD1);                                      \
+                                                                                                                    \
+        G1_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+        G2_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+                                                                                                                    \
+        UNDIAGONALIZE_1(ymmA0, ymmB0, ymmC0, ymmD0, ymmA1, ymmB1, ymmC1, ymmD1);                                    \
+    } while(0);
+
+#define ROUND_AVX2_V2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1)                                       \
+    do {                                                                                                            \
+        G1_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+        G2_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+                                                                                                                    \
+        DIAGONALIZE_2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                      \
+                                                                                                                    \
+        G1_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+        G2_AVX2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                            \
+                                                                                                                    \
+        UNDIAGONALIZE_2(ymmA0, ymmA1, ymmB0, ymmB1, ymmC0, ymmC1, ymmD0, ymmD1);                                    \
+    } while(0);
+}
@@ -8,6 +8,7 @@
 
 #include <array>
 #include <iterator>
+#include <span>
 #include <vector>
 
 #include "alignedallocator.hpp"
@@ -21,12 +22,23 @@ namespace modernRX::assembler {
         using code_vector = HeapArray<uint8_t, 4096>;
 
     public:
-        [[nodiscard]] explicit Context(const size_t code_size, const size_t data_size = 0) {
+        [[nodiscard]] explicit Context(const size_t code_size, const size_t data_size = 0, const CallingConvention calling_convention = Native_Calling_Convention)
+            : calling_convention(calling_convention) {
             code.reserve(code_size);
             data.reserve(data_size);
             instruction.reserve(32);
         }
 
+        // Returns calling convention that generated function follows.
+        [[nodiscard]] constexpr CallingConvention callingConvention() const noexcept {
+            return calling_convention;
+        }
+
+        // Returns register that holds integer argument with given index (counted from 0) at generated function entry.
+        [[nodiscard]] constexpr Register argument(const uint32_t index) const noexcept {
+            return argumentRegister(calling_convention, index);
+        }
+
         constexpr void inject(const_span<char> _code) {
             code.append_range(_code);
         }
@@ -145,7 +157,12 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpmuludq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            vex256<PP::PP0x66, MM::MM0x0F, Opcode{ 0xf4, -1 }>(dst_reg, src_reg1, src_reg2);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 F4 /r VPMULUDQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xf4, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else {
+                vex256<PP::PP0x66, MM::MM0x0F, Opcode{ 0xf4, -1 }>(dst_reg, src_reg1, src_reg2);
+            }
         }
 
         constexpr void ldmxcsr(const Memory src_reg) {
@@ -157,7 +174,10 @@ namespace modernRX::assembler {
 
         template<typename Operand, typename Control>
         constexpr void vpshufd(const Register dst_reg, const Operand src_reg, const Control control) {
-            if (dst_reg.type == RegisterType::YMM) {
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W0 70 /r ib VPSHUFD zmm1 {k1}{z}, zmm2/m512/m32bcst, imm8
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x70, -1 }>(dst_reg, src_reg, control);
+            } else if (dst_reg.type == RegisterType::YMM) {
                 vex256<PP::PP0x66, MM::MM0x0F, Opcode{ 0x70, -1 }>(dst_reg, src_reg, control);
             } else {
                 vex128<PP::PP0x66, MM::MM0x0F, Opcode{ 0x70, -1 }>(dst_reg, src_reg, control);
@@ -166,12 +186,22 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpunpcklqdq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x6c, -1 } > (dst_reg, src_reg1, src_reg2);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 6C /r VPUNPCKLQDQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x6c, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else {
+                vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x6c, -1 } > (dst_reg, src_reg1, src_reg2);
+            }
         }
 
         template<typename Operand>
         constexpr void vpunpckhqdq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x6d, -1 } > (dst_reg, src_reg1, src_reg2);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 6D /r VPUNPCKHQDQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x6d, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else {
+                vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x6d, -1 } > (dst_reg, src_reg1, src_reg2);
+            }
         }
 
         template<typename Operand, typename Control>
@@ -180,6 +210,19 @@ namespace modernRX::assembler {
             vex256 < PP::PP0x66, MM::MM0x0F3A, Opcode{ 0x46, -1 } > (dst_reg, src_reg1, src_reg2, control);
         }
 
+        // Shuffles 128-bit lanes. Two lower lanes of destination are selected from src_reg1, two upper lanes from src_reg2.
+        template<typename Control>
+        constexpr void vshufi64x2(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Control control) {
+            // EVEX.512.66.0F3A.W1 43 /r ib VSHUFI64X2 zmm1{k1}{z}, zmm2, zmm3/m512/m64bcst, imm8
+            evex<PP::PP0x66, MM::MM0x0F3A, Opcode{ 0x43, -1 }, 1>(dst_reg, src_reg1, src_reg2, control);
+        }
+
+        // Sets each bit of opmask register to the sign bit of corresponding quadword.
+        constexpr void vpmovq2m(const Register dst_reg, const Register src_reg) {
+            // EVEX.512.F3.0F38.W1 39 /r VPMOVQ2M k1, zmm1
+            evex<PP::PP0xF3, MM::MM0x0F38, Opcode{ 0x39, -1 }, 1>(dst_reg, src_reg);
+        }
+
         constexpr void vzeroupper() {
             encode(vex1<uint8_t>(false));
             encode(vex2<uint8_t>(0, PP::PP0x00, 0, 0));
@@ -189,24 +232,30 @@ namespace modernRX::assembler {
 
         // https://stackoverflow.com/a/28827013
         // Multiply packed unsigned quadwords and store high result.
-        // This is emulated instruction (not available in AVX2).
-        // Requires an 0x00000000ffffffff mask in YMM4 register.
-        // Uses YMM0-YMM3 registers.
+        // This is emulated instruction (not available in AVX2 nor AVX512).
+        // Requires an 0x00000000ffffffff mask in YMM4 (ZMM4 for ZMM operands) register.
+        // Uses YMM0-YMM3 (ZMM0-ZMM3 for ZMM operands) registers.
         constexpr void vpmulhuq(const Register dst_reg, const Register src_reg1, const Register src_reg2) {
-            vpshufd(registers::YMM1, src_reg1, 0xb1); // vpshufd dst
-            vpshufd(registers::YMM2, src_reg2, 0xb1); // vpshufd src
-            vpmuludq(registers::YMM3, src_reg1, src_reg2); // vpmuludq_w0
-            vpmuludq(registers::YMM0, registers::YMM1, registers::YMM2); // vpmuludq_w3
-            vpmuludq(registers::YMM2, src_reg1, registers::YMM2); // vpmuludq_w1
-            vpsrlq(registers::YMM3, registers::YMM3, 32); // vpsrlq_w0h
-            vpaddq(registers::YMM3, registers::YMM3, registers::YMM2); // vpaddq_s1
-            vpand(registers::YMM2, registers::YMM3, registers::YMM4); // vpand_s1l
-            vpmuludq(registers::YMM1, src_reg2, registers::YMM1); // vpmuludq_w2
-            vpsrlq(registers::YMM3, registers::YMM3, 32); // vpsrlq_s1h
-            vpaddq(registers::YMM0, registers::YMM0, registers::YMM3); // vpaddq_hi
-            vpaddq(registers::YMM2, registers::YMM2, registers::YMM1); // vpaddq_s2
-            vpsrlq(registers::YMM2, registers::YMM2, 32); // vpsrlq_s2h
-            vpaddq(dst_reg, registers::YMM0, registers::YMM2); // vpaddq_ret)
+            const Register tmp0{ dst_reg.type, 0 };
+            const Register tmp1{ dst_reg.type, 1 };
+            const Register tmp2{ dst_reg.type, 2 };
+            const Register tmp3{ dst_reg.type, 3 };
+            const Register mask{ dst_reg.type, 4 };
+
+            vpshufd(tmp1, src_reg1, 0xb1); // vpshufd dst
+            vpshufd(tmp2, src_reg2, 0xb1); // vpshufd src
+            vpmuludq(tmp3, src_reg1, src_reg2); // vpmuludq_w0
+            vpmuludq(tmp0, tmp1, tmp2); // vpmuludq_w3
+            vpmuludq(tmp2, src_reg1, tmp2); // vpmuludq_w1
+            vpsrlq(tmp3, tmp3, 32); // vpsrlq_w0h
+            vpaddq(tmp3, tmp3, tmp2); // vpaddq_s1
+            vpand(tmp2, tmp3, mask); // vpand_s1l
+            vpmuludq(tmp1, src_reg2, tmp1); // vpmuludq_w2
+            vpsrlq(tmp3, tmp3, 32); // vpsrlq_s1h
+            vpaddq(tmp0, tmp0, tmp3); // vpaddq_hi
+            vpaddq(tmp2, tmp2, tmp1); // vpaddq_s2
+            vpsrlq(tmp2, tmp2, 32); // vpsrlq_s2h
+            vpaddq(dst_reg, tmp0, tmp2); // vpaddq_ret)
         }
 
 
@@ -216,7 +265,21 @@ namespace modernRX::assembler {
         // This is emulated instruction (not available in AVX2).
         // Requires YMM5 to be zeroed.
         // Uses YMM0-YMM2 registers.
+        // For ZMM operands sign correction is done with opmask registers instead and YMM5 requirement does not apply.
+        // Requires an 0x00000000ffffffff mask in ZMM4 register then. Uses ZMM0-ZMM3, ZMM5, K1 and K2 registers.
         constexpr void vpmulhq(const Register dst_reg, const Register src_reg) {
+            if (dst_reg.type == RegisterType::ZMM) {
+                // Original dst value is kept in ZMM5, because dst_reg is overwritten before sign correction (src_reg may be the same register).
+                const Register src_copy{ src_reg == dst_reg ? registers::ZMM5 : src_reg };
+                vpmovq2m(registers::K1, dst_reg);
+                vpmovq2m(registers::K2, src_reg);
+                vmovdqa(registers::ZMM5, dst_reg);
+                vpmulhuq(dst_reg, dst_reg, src_reg);
+                vpsubq(dst_reg, dst_reg, src_copy, registers::K1); // subtract src where dst was negative
+                vpsubq(dst_reg, dst_reg, registers::ZMM5, registers::K2); // subtract dst where src was negative
+                return;
+            }
+
             vpmulhuq(registers::YMM2, dst_reg, src_reg);
             vpcmpgtq(registers::YMM0, registers::YMM5, dst_reg);
             vpand(registers::YMM0, src_reg, registers::YMM0);
@@ -268,26 +331,64 @@ namespace modernRX::assembler {
         // Multiply packed quadwords and store low result.
         // Uses native AVX512 instruction.
         template<typename Operand>
-        constexpr void vpmullq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            // EVEX.256.66.0F38.W1 40 /r VPMULLQ ymm1 {k1}{z}, ymm2, ymm3/m256/m64bcst
-            if constexpr (std::is_same_v<Operand, Register>) {
-               evex256 < PP::PP0x66, MM::MM0x0F38, Opcode{ 0x40, -1 }, 1, 0 > (dst_reg, src_reg1, src_reg2);
-            }
-            else {
-               evex256 < PP::PP0x66, MM::MM0x0F38, Opcode{ 0x40, -1 }, 1, 0 > (dst_reg, src_reg1, src_reg2);
-            }
+        constexpr void vpmullq(const Register dst_reg, const Register src_reg1, const Operand src_reg2, const Mask mask = {}) {
+            // EVEX.512.66.0F38.W1 40 /r VPMULLQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+            evex<PP::PP0x66, MM::MM0x0F38, Opcode{ 0x40, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask);
+        }
+
+        constexpr void vprorq(const Register dst_reg, const Register src_reg1, const int imm32, const Mask mask = {}) {
+           // EVEX.512.66.0F.W1 72 /0 ib VPRORQ zmm1 {k1}{z}, zmm2/m512/m64bcst, imm8
+           evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x72, 0 }, 1>(dst_reg, src_reg1, imm32, mask);
         }
 
-        constexpr void vprorq(const Register dst_reg, const Register src_reg1, const int imm32) {
-           // EVEX.256.66.0F.W1 72 / 0 ib VPRORQ ymm1{ k1 }{z}, ymm2 / m256 / m64bcst, imm8
-           evex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x72, 0 }, 1, 0 > (dst_reg, src_reg1, imm32);
+        // Multiply packed doublewords and store low result.
+        template<typename Operand>
+        constexpr void vpmulld(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
+            // VEX.256.66.0F38.WIG 40 /r VPMULLD ymm1, ymm2, ymm3/m256
+            vex256<PP::PP0x66, MM::MM0x0F38, Opcode{ 0x40, -1 }>(dst_reg, src_reg1, src_reg2);
+        }
+
+        // Multiply packed quadwords and store low result.
+        // This is emulated instruction for CPUs without AVX512DQ/VL: lo(a) * lo(b) + ((lo(a) * hi(b) + hi(a) * lo(b)) << 32).
+        // Uses YMM0-YMM1 registers.
+        template<typename Operand>
+        constexpr void vpmullqAvx2(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
+            vpshufd(registers::YMM0, src_reg1, 0xb1); // swap dwords of src1
+            vpmulld(registers::YMM0, registers::YMM0, src_reg2); // cross products: hi(a) * lo(b), lo(a) * hi(b)
+            vpsrlq(registers::YMM1, registers::YMM0, 32);
+            vpaddq(registers::YMM0, registers::YMM0, registers::YMM1); // sum of cross products in lower dwords
+            vpsllq(registers::YMM0, registers::YMM0, 32);
+            vpmuludq(registers::YMM1, src_reg1, src_reg2); // lo(a) * lo(b)
+            vpaddq(dst_reg, registers::YMM0, registers::YMM1);
+        }
+
+        // Rotate packed quadwords right.
+        // This is emulated instruction for CPUs without AVX512VL.
+        // Uses YMM0 register.
+        constexpr void vprorqAvx2(const Register dst_reg, const Register src_reg, const int imm32) {
+            vpsrlq(registers::YMM0, src_reg, imm32);
+            vpsllq(dst_reg, src_reg, 64 - imm32);
+            vpor(dst_reg, dst_reg, registers::YMM0);
         }
 
         // Broadcasts 64-bit value from XMM register into YMM register.
         // In a case when src is a GPR register, it is first moved to XMM register.
         // In a case when src is an immediate value, it is first moved to RAX register.
+        // ZMM register can be filled only from GPR register or immediate value, which is broadcasted directly from GPR.
         template<typename Operand>
         constexpr void vpbroadcastq(const Register ymm, const Operand src) {
+            if (ymm.type == RegisterType::ZMM) {
+                if constexpr (std::is_same_v<Operand, Register>) {
+                    // EVEX.512.66.0F38.W1 7C /r VPBROADCASTQ zmm1 {k1}{z}, r64
+                    evex<PP::PP0x66, MM::MM0x0F38, Opcode{ 0x7c, -1 }, 1>(ymm, src);
+                } else {
+                    mov(registers::RAX, src);
+                    evex<PP::PP0x66, MM::MM0x0F38, Opcode{ 0x7c, -1 }, 1>(ymm, registers::RAX);
+                }
+
+                return;
+            }
+
             if constexpr (std::is_same_v<Operand, Register>) {
                 if (src.type == RegisterType::GPR) {
                     vmovq(Register::XMM(ymm.idx), src);
@@ -418,7 +519,12 @@ namespace modernRX::assembler {
 
         constexpr void vmovntdq(const Memory dst, const Register src) {
             // VEX.256.66.0F.WIG E7 /r VMOVNTDQ m256, ymm1
-            vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xe7, -1 } > (src, dst);
+            if (src.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W0 E7 /r VMOVNTDQ m512, zmm1
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xe7, -1 }>(src, dst);
+            } else {
+                vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xe7, -1 } > (src, dst);
+            }
         }
 
         // Align to 32 bytes and store label.
@@ -442,14 +548,19 @@ namespace modernRX::assembler {
         )
         constexpr void vmovdqa(const Dst dst, const Src src) {
             // vmovqdu ymmX, ymmword ptr [gpr + offset]: {vex.2B: 0xc5} {vex.0bR'0000'1'66} {opcode: #L:0x6f|#S:0x7f /r} {modrm: 0b00'ymm'gpr} [sib: rsp] [disp8/32]
+            // For ZMM registers vmovdqa64 is used.
             if constexpr (std::is_same_v<Dst, Register>) {
-                if (dst.type == RegisterType::YMM) {
+                if (dst.type == RegisterType::ZMM) {
+                    evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x6f, -1 }, 1>(dst, src);
+                } else if (dst.type == RegisterType::YMM) {
                     vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x6f, -1 } > (dst, src);
                 } else {
                     vex128<PP::PP0x66, MM::MM0x0F, Opcode{ 0x6f, -1 } > (dst, src);
                 }
             } else {
-                if (src.type == RegisterType::YMM) {
+                if (src.type == RegisterType::ZMM) {
+                    evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x7f, -1 }, 1>(src, dst);
+                } else if (src.type == RegisterType::YMM) {
                     vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x7f, -1 } > (src, dst);
                 } else {
                     vex128<PP::PP0x66, MM::MM0x0F, Opcode{ 0x7f, -1 } > (src, dst);
@@ -466,14 +577,19 @@ namespace modernRX::assembler {
         )
         constexpr void vmovdqu(const Dst dst, const Src src) {
             // vmovqdu ymmX, ymmword ptr [gpr + offset]: {vex.2B: 0xc5} {vex.0bR'0000'1'66} {opcode: #L:0x6f|#S:0x7f /r} {modrm: 0b00'ymm'gpr} [sib: rsp] [disp8/32]
+            // For ZMM registers vmovdqu64 is used.
             if constexpr (std::is_same_v<Dst, Register>) {
-                if (dst.type == RegisterType::YMM) {
+                if (dst.type == RegisterType::ZMM) {
+                    evex<PP::PP0xF3, MM::MM0x0F, Opcode{ 0x6f, -1 }, 1>(dst, src);
+                } else if (dst.type == RegisterType::YMM) {
                     vex256 < PP::PP0xF3, MM::MM0x0F, Opcode{ 0x6f, -1 } > (dst, src);
                 } else {
                     vex128 < PP::PP0xF3, MM::MM0x0F, Opcode{ 0x6f, -1 } > (dst, src);
                 }
             } else {
-                if (src.type == RegisterType::YMM) {
+                if (src.type == RegisterType::ZMM) {
+                    evex<PP::PP0xF3, MM::MM0x0F, Opcode{ 0x7f, -1 }, 1>(src, dst);
+                } else if (src.type == RegisterType::YMM) {
                     vex256 < PP::PP0xF3, MM::MM0x0F, Opcode{ 0x7f, -1 } > (src, dst);
                 } else {
                     vex128 < PP::PP0xF3, MM::MM0x0F, Opcode{ 0x7f, -1 } > (src, dst);
@@ -483,18 +599,38 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpsrlq(const Register dst_reg, const Register src_reg, const Operand shift) {
-            vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 2 } > (dst_reg, src_reg, shift);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 73 /2 ib VPSRLQ zmm1 {k1}{z}, zmm2/m512/m64bcst, imm8
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 2 }, 1>(dst_reg, src_reg, shift);
+            } else {
+                vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 2 } > (dst_reg, src_reg, shift);
+            }
         }
 
         template<typename Operand>
         constexpr void vpsllq(const Register dst_reg, const Register src_reg, const Operand shift) {
-            vex256< PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 6 }>(dst_reg, src_reg, shift);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 73 /6 ib VPSLLQ zmm1 {k1}{z}, zmm2/m512/m64bcst, imm8
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 6 }, 1>(dst_reg, src_reg, shift);
+            } else {
+                vex256< PP::PP0x66, MM::MM0x0F, Opcode{ 0x73, 6 }>(dst_reg, src_reg, shift);
+            }
         }
 
 
         template<typename Operand>
         constexpr void vpsubq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xfb, -1 } > (dst_reg, src_reg1, src_reg2);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 FB /r VPSUBQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xfb, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else {
+                vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xfb, -1 } > (dst_reg, src_reg1, src_reg2);
+            }
+        }
+
+        // Subtracts packed quadwords only in elements selected by opmask; other elements of dst_reg are left unchanged (or zeroed, see Mask::Z).
+        constexpr void vpsubq(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Mask mask) {
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xfb, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask);
         }
 
         template<typename Operand>
@@ -504,12 +640,20 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpaddq(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            vex256< PP::PP0x66, MM::MM0x0F, Opcode{ 0xd4, -1 }>(dst_reg, src_reg1, src_reg2);
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 D4 /r VPADDQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xd4, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else {
+                vex256< PP::PP0x66, MM::MM0x0F, Opcode{ 0xd4, -1 }>(dst_reg, src_reg1, src_reg2);
+            }
         }
 
         template<typename Operand>
         constexpr void vpxor(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            if (dst_reg.type == RegisterType::XMM) {
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 EF /r VPXORQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xef, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else if (dst_reg.type == RegisterType::XMM) {
                 vex128 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xef, -1 } > (dst_reg, src_reg1, src_reg2);
             } else {
                 vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xef, -1 } > (dst_reg, src_reg1, src_reg2);
@@ -522,6 +666,13 @@ namespace modernRX::assembler {
         }
 
         constexpr void vmaxreg(const Register dst_reg) {
+           if (dst_reg.type == RegisterType::ZMM) {
+               // EVEX.512.66.0F3A.W0 25 /r ib VPTERNLOGD zmm1 {k1}{z}, zmm2, zmm3/m512/m32bcst, imm8
+               // AVX512 comparisons write to opmask registers, so all bits are set with ternary logic function returning 1.
+               evex<PP::PP0x66, MM::MM0x0F3A, Opcode{ 0x25, -1 }>(dst_reg, dst_reg, dst_reg, 0xff);
+               return;
+           }
+
            // VEX.256.66.0F38.WIG 29 / r VPCMPEQQ ymm1, ymm2, ymm3 / m256
            vex256 < PP::PP0x66, MM::MM0x0F38, Opcode{ 0x29, -1 } > (dst_reg, dst_reg, dst_reg);
         }
@@ -534,7 +685,10 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpand(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            if (dst_reg.type == RegisterType::YMM) {
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 DB /r VPANDQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xdb, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else if (dst_reg.type == RegisterType::YMM) {
                 vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xdb, -1 } > (dst_reg, src_reg1, src_reg2);
             } else {
                 vex128 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xdb, -1 } > (dst_reg, src_reg1, src_reg2);
@@ -543,13 +697,59 @@ namespace modernRX::assembler {
 
         template<typename Operand>
         constexpr void vpor(const Register dst_reg, const Register src_reg1, const Operand src_reg2) {
-            if (dst_reg.type == RegisterType::YMM) {
+            if (dst_reg.type == RegisterType::ZMM) {
+                // EVEX.512.66.0F.W1 EB /r VPORQ zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst
+                evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0xeb, -1 }, 1>(dst_reg, src_reg1, src_reg2);
+            } else if (dst_reg.type == RegisterType::YMM) {
                 vex256 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xeb, -1 } > (dst_reg, src_reg1, src_reg2);
             } else {
                 vex128 < PP::PP0x66, MM::MM0x0F, Opcode{ 0xeb, -1 } > (dst_reg, src_reg1, src_reg2);
             }
         }
 
+        // Packed double precision floating point arithmetic. EVEX encoded only, so all 32 registers, opmasks and embedded rounding can be used.
+        // Embedded rounding requires ZMM register operands.
+        constexpr void vaddpd(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+            // EVEX.512.66.0F.W1 58 /r VADDPD zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst{er}
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x58, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask, rounding);
+        }
+
+        constexpr void vsubpd(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+            // EVEX.512.66.0F.W1 5C /r VSUBPD zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst{er}
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x5c, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask, rounding);
+        }
+
+        constexpr void vmulpd(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+            // EVEX.512.66.0F.W1 59 /r VMULPD zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst{er}
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x59, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask, rounding);
+        }
+
+        constexpr void vdivpd(const Register dst_reg, const Register src_reg1, const Register src_reg2, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+            // EVEX.512.66.0F.W1 5E /r VDIVPD zmm1 {k1}{z}, zmm2, zmm3/m512/m64bcst{er}
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x5e, -1 }, 1>(dst_reg, src_reg1, src_reg2, mask, rounding);
+        }
+
+        constexpr void vsqrtpd(const Register dst_reg, const Register src_reg, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+            // EVEX.512.66.0F.W1 51 /r VSQRTPD zmm1 {k1}{z}, zmm2/m512/m64bcst{er}
+            evex<PP::PP0x66, MM::MM0x0F, Opcode{ 0x51, -1 }, 1>(dst_reg, src_reg, mask, rounding);
+        }
+
+        // Moves 64 bits between opmask register and GPR.
+        constexpr void kmovq(const Register dst, const Register src) {
+            // VEX.L0.F2.0F.W1 92 /r KMOVQ k1, r64
+            // VEX.L0.F2.0F.W1 93 /r KMOVQ r64, k1
+            const bool to_mask{ dst.type == RegisterType::OPMASK };
+            const Register gpr{ to_mask ? src : dst };
+            const Register k{ to_mask ? dst : src };
+
+            encode(vex1<uint8_t>(true));
+            encode(vex2<uint8_t>(MM::MM0x0F, to_mask || gpr.isLow(), 1, !to_mask || gpr.isLow()));
+            encode(vex3<uint8_t>(0, PP::PP0xF2, 1, 0));
+            encode(to_mask ? 0x92 : 0x93);
+            encode(modregrm<uint8_t>(to_mask ? k.idx : gpr.lowIdx(), to_mask ? gpr.lowIdx() : k.idx));
+            schedule();
+        }
+
         // Pushes single GPR register on stack.
         constexpr void push(const Register reg) {
             if (reg.isHigh()) {
@@ -614,32 +814,19 @@ namespace modernRX::assembler {
         constexpr void push(Reg... regs) {
             static_assert(sizeof...(regs) > 0);
 
-            std::array<Register, sizeof...(regs)> xmm_regs{};
-            int32_t xmm_regs_cnt{ 0 };
-
-            for (const auto& reg : { regs... }) {
-                // General purpose registers are pushed on stack using PUSH instruction: 
-                if (reg.type == RegisterType::GPR) {
-                    push(reg);
-                }
-                // XMM registers are pushed on stack by expanding stack and copying register to stack.
-                // Lets just count how many XMM registers was passed and push them at the end, because they may be between general purpose registers.
-                else if (reg.type == RegisterType::XMM) {
-                    xmm_regs[xmm_regs_cnt++] = reg;
-                }
-            }
-
-            if (xmm_regs_cnt > 0) {
-                const int32_t stack_size{ xmm_regs_cnt * Register::XMM(0).size() };
-                sub(registers::RSP, stack_size);
+            const std::array<Register, sizeof...(regs)> all_regs{ regs... };
+            push(std::span<const Register>{ all_regs });
+        }
 
-                for (int32_t i = xmm_regs_cnt - 1; i >= 0; --i) {
-                    const auto& reg{ xmm_regs[i] };
-                    const int32_t stack_offset{ (xmm_regs_cnt - 1 - i) * reg.size() };
+        // Same as push, but skips registers that are volatile in calling convention of generated function.
+        // Allows to list registers used by function once, regardless of calling convention.
+        template<typename... Reg>
+        requires (std::is_same_v<Reg, Register> && ...)
+        constexpr void pushCalleeSaved(Reg... regs) {
+            static_assert(sizeof...(regs) > 0);
 
-                    vmovdqu(registers::RSP[stack_offset], reg);
-                }
-            }
+            std::array<Register, sizeof...(regs)> saved_regs{};
+            push(std::span<const Register>{ saved_regs.data(), filterCalleeSaved(saved_regs, regs...) });
         }
 
         // Generates binary code for poping registers from stack.
@@ -659,35 +846,19 @@ namespace modernRX::assembler {
         constexpr void pop(Reg... regs) {
             static_assert(sizeof...(regs) > 0);
 
-            std::array<Register, sizeof...(regs)> xmm_regs{};
-            int32_t xmm_regs_cnt{ 0 };
-
-            for (const auto& reg : { regs... }) {
-                // XMM registers are popped from stack by copying values from stack back to register and shrinking stack.
-                // Lets just count how many XMM registers was passed and pop them right after, when stack size reserved for them is known.
-                if (reg.type == RegisterType::XMM) {
-                    xmm_regs[xmm_regs_cnt++] = reg;
-                }
-            }
-
-            if (xmm_regs_cnt > 0) {
-                for (int32_t i = 0; i < xmm_regs_cnt; ++i) {
-                    const auto& reg{ xmm_regs[i] };
-                    const int32_t stack_offset{ i * reg.size() };
-
-                    vmovdqu(reg, registers::RSP[stack_offset]);
-                }
+            const std::array<Register, sizeof...(regs)> all_regs{ regs... };
+            pop(std::span<const Register>{ all_regs });
+        }
 
-                const int32_t stack_size{ xmm_regs_cnt * Register::XMM(0).size() };
-                add(registers::RSP, stack_size);
-            }
+        // Same as pop, but skips registers that are volatile in calling convention of generated function.
+        // Must be called with the same registers (in reverse order) as pushCalleeSaved.
+        template<typename... Reg>
+        requires (std::is_same_v<Reg, Register> && ...)
+        constexpr void popCalleeSaved(Reg... regs) {
+            static_assert(sizeof...(regs) > 0);
 
-            for (const auto& reg : { regs... }) {
-                // General purpose registers are popped from stack using POP instruction: 
-                if (reg.type == RegisterType::GPR) {
-                    pop(reg);
-                }
-            }
+            std::array<Register, sizeof...(regs)> saved_regs{};
+            pop(std::span<const Register>{ saved_regs.data(), filterCalleeSaved(saved_regs, regs...) });
         }
 
         // Generates nop instructions for given size in bytes.
@@ -759,6 +930,83 @@ namespace modernRX::assembler {
             return code.size();
         }
 
+        // Pushes registers in given order. See variadic push for details.
+        constexpr void push(std::span<const Register> regs) {
+            std::array<Register, 32> xmm_regs{};
+            int32_t xmm_regs_cnt{ 0 };
+
+            for (const auto& reg : regs) {
+                // General purpose registers are pushed on stack using PUSH instruction: 
+                if (reg.type == RegisterType::GPR) {
+                    push(reg);
+                }
+                // XMM registers are pushed on stack by expanding stack and copying register to stack.
+                // Lets just count how many XMM registers was passed and push them at the end, because they may be between general purpose registers.
+                else if (reg.type == RegisterType::XMM) {
+                    xmm_regs[xmm_regs_cnt++] = reg;
+                }
+            }
+
+            if (xmm_regs_cnt > 0) {
+                const int32_t stack_size{ xmm_regs_cnt * Register::XMM(0).size() };
+                sub(registers::RSP, stack_size);
+
+                for (int32_t i = xmm_regs_cnt - 1; i >= 0; --i) {
+                    const auto& reg{ xmm_regs[i] };
+                    const int32_t stack_offset{ (xmm_regs_cnt - 1 - i) * reg.size() };
+
+                    vmovdqu(registers::RSP[stack_offset], reg);
+                }
+            }
+        }
+
+        // Pops registers in given order. See variadic pop for details.
+        constexpr void pop(std::span<const Register> regs) {
+            std::array<Register, 32> xmm_regs{};
+            int32_t xmm_regs_cnt{ 0 };
+
+            for (const auto& reg : regs) {
+                // XMM registers are popped from stack by copying values from stack back to register and shrinking stack.
+                // Lets just count how many XMM registers was passed and pop them right after, when stack size reserved for them is known.
+                if (reg.type == RegisterType::XMM) {
+                    xmm_regs[xmm_regs_cnt++] = reg;
+                }
+            }
+
+            if (xmm_regs_cnt > 0) {
+                for (int32_t i = 0; i < xmm_regs_cnt; ++i) {
+                    const auto& reg{ xmm_regs[i] };
+                    const int32_t stack_offset{ i * reg.size() };
+
+                    vmovdqu(reg, registers::RSP[stack_offset]);
+                }
+
+                const int32_t stack_size{ xmm_regs_cnt * Register::XMM(0).size() };
+                add(registers::RSP, stack_size);
+            }
+
+            for (const auto& reg : regs) {
+                // General purpose registers are popped from stack using POP instruction: 
+                if (reg.type == RegisterType::GPR) {
+                    pop(reg);
+                }
+            }
+        }
+
+        // Copies registers that are callee-saved in calling convention of generated function into output array. Returns number of copied registers.
+        template<size_t Size, typename... Reg>
+        [[nodiscard]] constexpr size_t filterCalleeSaved(std::array<Register, Size>& output, Reg... regs) const noexcept {
+            size_t count{ 0 };
+            for (const auto& reg : { regs... }) {
+                if (isCalleeSaved(calling_convention, reg)) {
+                    output[count++] = reg;
+                }
+            }
+
+            return count;
+        }
+
+        CallingConvention calling_convention;
         std::vector<std::pair<size_t, size_t>> data_ptr_pos;
         code_vector code;
         data_vector data;
@@ -805,9 +1053,14 @@ namespace modernRX::assembler {
             const auto srcreg{ is_sib ? registers::RSP.idx : src.lowIdx() };
             const auto basereg{ src.lowIdx() };
 
-            if (src.offset == 0 && basereg != registers::RBP.idx) {
+            // EVEX encoded instructions use compressed disp8 (disp8*N), where N is passed as vecsize. Disp32 is never compressed.
+            const auto disp8_offset{ src.offset / static_cast<int32_t>(vecsize) };
+            const auto is_disp8{ src.offset % vecsize == 0 && disp8_offset >= std::numeric_limits<int8_t>::min() && disp8_offset <= std::numeric_limits<int8_t>::max() };
+            const auto mod{ (src.offset == 0 && basereg != registers::RBP.idx) ? MOD::MOD00 : (is_disp8 ? MOD::MOD01 : MOD::MOD10) };
+
+            if (mod == MOD::MOD00) {
                 encode(modregrm<uint8_t>(dst % 8, srcreg, MOD::MOD00)); // Indirect or SIB mode if RSP used.
-            } else if (src.offset >= std::numeric_limits<int8_t>::min() && src.offset <= std::numeric_limits<int8_t>::max()) {
+            } else if (mod == MOD::MOD01) {
                 encode(modregrm<uint8_t>(dst % 8, srcreg, MOD::MOD01)); // Indirect + disp8 or SIB mode + disp8 if RSP used.
             } else {
                 encode(modregrm<uint8_t>(dst % 8, srcreg, MOD::MOD10)); // Indirect + disp32 or SIB mode + disp32 if RSP used.
@@ -835,18 +1088,14 @@ namespace modernRX::assembler {
                 }
             }
 
-            auto offset = src.offset / vecsize;
-
             // Disp8
-            if (offset != 0 || basereg == registers::RBP.idx) {
-                encode((uint8_t)byte<0>(offset));
+            if (mod == MOD::MOD01) {
+                encode((uint8_t)byte<0>(disp8_offset));
             }
 
             // Disp32
-            if (offset < std::numeric_limits<int8_t>::min() || offset > std::numeric_limits<int8_t>::max()) {
-                encode((uint8_t)byte<1>(offset));
-                encode((uint8_t)byte<2>(offset));
-                encode((uint8_t)byte<3>(offset));
+            if (mod == MOD::MOD10) {
+                encode32(src.offset);
             }
         }
 
@@ -1007,46 +1256,6 @@ namespace modernRX::assembler {
         }
 
 
-        // Generates instruction with EVEX256 prefix and Register/Register as operands (eg. vpmullq).
-        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0, uint8_t mask = 0>
-        constexpr void evex256(const Register dst, const Register src1, const Register src2) {
-           encode(evex1<uint8_t>());
-           encode(evex2<uint8_t>(mm, dst.isLow(), 1, src2.isLow(), 1, 0));
-           encode(evex3<uint8_t>(src1.idx, pp, w, 1));
-           encode(evex4<uint8_t>(0, 1, 0, 1, mask));
-           encode(opcode.code);
-           encode(modregrm<uint8_t>(dst.lowIdx(), src2.lowIdx()));
-           schedule();
-        }
-
-        // Generates instruction with EVEX256 prefix and Register/Register/Immediate as operands (eg. vprorq).
-        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0, uint8_t mask = 0>
-        constexpr void evex256(const Register dst, const Register src1, const int imm32) {
-           const reg_idx_t vvvv{ opcode.mod > -1 ? dst.idx : uint8_t(0) };
-           const reg_idx_t reg{ opcode.mod > -1 ? (uint8_t)opcode.mod : dst.lowIdx() };
-
-           encode(evex1<uint8_t>());
-           encode(evex2<uint8_t>(mm, dst.isLow(), 1, src1.isLow(), 1, 0));
-           encode(evex3<uint8_t>(src1.idx, pp, w, 1));
-           encode(evex4<uint8_t>(0, 1, 0, 1, mask));
-           encode(opcode.code);
-           encode(modregrm<uint8_t>(reg, src1.lowIdx()));
-           encode((uint8_t)byte<0>(imm32));
-           schedule();
-        }
-
-        // Generates instruction with EVEX256 prefix and Register/Register/Memory as operands (eg. vpxor).
-        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0, uint8_t mask = 0>
-        constexpr void evex256(const Register dst, const Register src1, const Memory src2) {
-           encode(evex1<uint8_t>());
-           encode(evex2<uint8_t>(mm, dst.isLow(), 1, src2.isLow(), 1, 0));
-           encode(evex3<uint8_t>(src1.idx, pp, w, 1));
-           encode(evex4<uint8_t>(0, 1, 0, 1, mask));
-           encode(opcode.code);
-           addr(dst.idx, src2, 1, 32);
-           schedule();
-        }
-
         // Generates instruction with VEX256 prefix and Register/Register/Register as operands (eg. vpxor).
         template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
         constexpr void vex256(const Register dst, const Register src1, const Register src2) {
@@ -1205,5 +1414,96 @@ namespace modernRX::assembler {
             encode((uint8_t)byte<0>(imm32));
             schedule();
         }
+
+        // Generates EVEX prefix. Supports all 32 vector registers, opmask registers (merge and zero masking), embedded broadcast and embedded rounding.
+        // reg - index of operand encoded in ModRM.reg, vvvv - index of operand encoded in EVEX.vvvv (0 if unused),
+        // rm - index of operand encoded in ModRM.rm (base register for memory operand), x - 5th bit of rm register or 4th bit of index register for memory operand.
+        // Vector length is taken from vec register. Embedded rounding reuses vector length bits, so it implies 512-bit instruction.
+        template<PP pp, MM mm, uint8_t w>
+        constexpr void evexprefix(const reg_idx_t reg, const reg_idx_t vvvv, const reg_idx_t rm, const bool x, const Register vec,
+                                  const Mask mask, const bool broadcast, const Rounding rounding = Rounding::None) {
+           const bool er{ rounding != Rounding::None };
+           const uint8_t ll{ er ? static_cast<uint8_t>(rounding) : evexVectorLength(vec) };
+
+           encode(evex1<uint8_t>());
+           encode(evex2<uint8_t>(mm, !(reg & 8), !x, !(rm & 8), !(reg & 16), 0));
+           encode(evex3<uint8_t>(vvvv, pp, w, 1));
+           encode(evex4<uint8_t>(mask.zeroing, ll, broadcast || er, !(vvvv & 16), mask.k.idx));
+        }
+
+        // Returns N used to compress disp8 of memory operand (disp8*N): size of whole vector or size of single element if it is broadcasted.
+        template<uint8_t w>
+        [[nodiscard]] static constexpr uint8_t evexDisp8Scale(const Register vec, const Memory mem) noexcept {
+           if (mem.broadcast) {
+               return w ? sizeof(uint64_t) : sizeof(uint32_t);
+           }
+
+           return static_cast<uint8_t>(vec.size());
+        }
+
+        // Returns vector register that decides about EVEX vector length. Some instructions have GPR or opmask as one of operands (eg. vpbroadcastq, vpmovq2m).
+        [[nodiscard]] static constexpr Register evexVector(const Register dst, const Register src) noexcept {
+           return (dst.type == RegisterType::GPR || dst.type == RegisterType::OPMASK) ? src : dst;
+        }
+
+        // Generates instruction with EVEX prefix and Register/Register as operands (eg. vmovdqa64, vpbroadcastq, vpmovq2m, vsqrtpd).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Register src1, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+           evexprefix<pp, mm, w>(dst.idx, 0, src1.idx, src1.idx & 16, evexVector(dst, src1), mask, false, rounding);
+           encode(opcode.code);
+           encode(modregrm<uint8_t>(dst.lowIdx(), src1.lowIdx()));
+           schedule();
+        }
+
+        // Generates instruction with EVEX prefix and Register/Memory as operands (eg. vmovdqa64, vmovntdq).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Memory src1, const Mask mask = {}) {
+           evexprefix<pp, mm, w>(dst.idx, 0, src1.reg, src1.index_reg != registers::DUMMY.idx && (src1.index_reg & 8), dst, mask, src1.broadcast);
+           encode(opcode.code);
+           addr(dst.idx, src1, 1, evexDisp8Scale<w>(dst, src1));
+           schedule();
+        }
+
+        // Generates instruction with EVEX prefix and Register/Register/Register as operands (eg. vpaddq, vaddpd).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Register src1, const Register src2, const Mask mask = {}, const Rounding rounding = Rounding::None) {
+           evexprefix<pp, mm, w>(dst.idx, src1.idx, src2.idx, src2.idx & 16, evexVector(dst, src1), mask, false, rounding);
+           encode(opcode.code);
+           encode(modregrm<uint8_t>(dst.lowIdx(), src2.lowIdx()));
+           schedule();
+        }
+
+        // Generates instruction with EVEX prefix and Register/Register/Memory as operands (eg. vpaddq).
+        // Memory operand may be a single element broadcasted to all elements (see Memory::BCST).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Register src1, const Memory src2, const Mask mask = {}) {
+           evexprefix<pp, mm, w>(dst.idx, src1.idx, src2.reg, src2.index_reg != registers::DUMMY.idx && (src2.index_reg & 8), evexVector(dst, src1), mask, src2.broadcast);
+           encode(opcode.code);
+           addr(dst.idx, src2, 1, evexDisp8Scale<w>(evexVector(dst, src1), src2));
+           schedule();
+        }
+
+        // Generates instruction with EVEX prefix and Register/Register/Immediate as operands (eg. vprorq, vpshufd).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Register src1, const int imm32, const Mask mask = {}) {
+           const reg_idx_t vvvv{ opcode.mod > -1 ? dst.idx : uint8_t(0) };
+           const reg_idx_t reg{ opcode.mod > -1 ? (uint8_t)opcode.mod : dst.idx };
+
+           evexprefix<pp, mm, w>(reg, vvvv, src1.idx, src1.idx & 16, dst, mask, false);
+           encode(opcode.code);
+           encode(modregrm<uint8_t>(reg % 8, src1.lowIdx()));
+           encode((uint8_t)byte<0>(imm32));
+           schedule();
+        }
+
+        // Generates instruction with EVEX prefix and Register/Register/Register/Immediate as operands (eg. vshufi64x2).
+        template<PP pp, MM mm, Opcode opcode, uint8_t w = 0>
+        constexpr void evex(const Register dst, const Register src1, const Register src2, const int imm32, const Mask mask = {}) {
+           evexprefix<pp, mm, w>(dst.idx, src1.idx, src2.idx, src2.idx & 16, evexVector(dst, src1), mask, false);
+           encode(opcode.code);
+           encode(modregrm<uint8_t>(dst.lowIdx(), src2.lowIdx()));
+           encode((uint8_t)byte<0>(imm32));
+           schedule();
+        }
     };
 }
@@ -5,13 +5,16 @@
 * Code may be a little bit messy and not fully documented as this will be further extended in unknown direction.
 */
 
+#include <array>
 #include <bit>
+#include <cstdint>
+#include <utility>
 
 namespace modernRX::assembler {
     using reg_idx_t = uint8_t;
 
     enum class RegisterType : uint8_t {
-        GPR = 0, XMM = 1, YMM = 2, ZMM = 4,
+        GPR = 0, XMM = 1, YMM = 2, ZMM = 4, OPMASK = 8,
         DUMMY = 255
     };
 
@@ -41,12 +44,18 @@ namespace modernRX::assembler {
         reg_idx_t index_reg{ 0xff };
         int32_t offset;
         bool rip{ false };
+        bool broadcast{ false }; // Embedded broadcast of single element ({1toN}, element size follows EVEX.W); only for EVEX encoded instructions.
 
         // Should be used only when mem.reg is RBP.
         [[nodiscard]] static constexpr Memory RIP(const Memory& mem) noexcept {
             return Memory{ mem.reg, mem.index_reg, mem.offset, true };
         }
 
+        // Marks memory operand as a single element broadcasted to all vector elements.
+        [[nodiscard]] static constexpr Memory BCST(const Memory& mem) noexcept {
+            return Memory{ mem.reg, mem.index_reg, mem.offset, mem.rip, true };
+        }
+
         [[nodiscard]] constexpr bool isLow() const noexcept {
             return reg < 8;
         }
@@ -80,6 +89,14 @@ namespace modernRX::assembler {
             return Register{ RegisterType::XMM, idx };
         }
 
+        [[nodiscard]] static constexpr Register ZMM(const reg_idx_t idx) noexcept {
+            return Register{ RegisterType::ZMM, idx };
+        }
+
+        [[nodiscard]] static constexpr Register K(const reg_idx_t idx) noexcept {
+            return Register{ RegisterType::OPMASK, idx };
+        }
+
         [[nodiscard]] constexpr bool isLow() const noexcept {
             return idx < 8;
         }
@@ -101,6 +118,8 @@ namespace modernRX::assembler {
                 return 32;
             } else if (type == RegisterType::ZMM) {
                 return 64;
+            } else if (type == RegisterType::OPMASK) {
+                return 8;
             }
 
             std::unreachable();
@@ -172,6 +191,123 @@ namespace modernRX::assembler {
         inline constexpr Register YMM13{ RegisterType::YMM, 13 };
         inline constexpr Register YMM14{ RegisterType::YMM, 14 };
         inline constexpr Register YMM15{ RegisterType::YMM, 15 };
+
+        inline constexpr Register ZMM0{ RegisterType::ZMM, 0 };
+        inline constexpr Register ZMM1{ RegisterType::ZMM, 1 };
+        inline constexpr Register ZMM2{ RegisterType::ZMM, 2 };
+        inline constexpr Register ZMM3{ RegisterType::ZMM, 3 };
+        inline constexpr Register ZMM4{ RegisterType::ZMM, 4 };
+        inline constexpr Register ZMM5{ RegisterType::ZMM, 5 };
+        inline constexpr Register ZMM6{ RegisterType::ZMM, 6 };
+        inline constexpr Register ZMM7{ RegisterType::ZMM, 7 };
+        inline constexpr Register ZMM8{ RegisterType::ZMM, 8 };
+        inline constexpr Register ZMM9{ RegisterType::ZMM, 9 };
+        inline constexpr Register ZMM10{ RegisterType::ZMM, 10 };
+        inline constexpr Register ZMM11{ RegisterType::ZMM, 11 };
+        inline constexpr Register ZMM12{ RegisterType::ZMM, 12 };
+        inline constexpr Register ZMM13{ RegisterType::ZMM, 13 };
+        inline constexpr Register ZMM14{ RegisterType::ZMM, 14 };
+        inline constexpr Register ZMM15{ RegisterType::ZMM, 15 };
+        inline constexpr Register ZMM16{ RegisterType::ZMM, 16 };
+        inline constexpr Register ZMM17{ RegisterType::ZMM, 17 };
+        inline constexpr Register ZMM18{ RegisterType::ZMM, 18 };
+        inline constexpr Register ZMM19{ RegisterType::ZMM, 19 };
+        inline constexpr Register ZMM20{ RegisterType::ZMM, 20 };
+        inline constexpr Register ZMM21{ RegisterType::ZMM, 21 };
+        inline constexpr Register ZMM22{ RegisterType::ZMM, 22 };
+        inline constexpr Register ZMM23{ RegisterType::ZMM, 23 };
+        inline constexpr Register ZMM24{ RegisterType::ZMM, 24 };
+        inline constexpr Register ZMM25{ RegisterType::ZMM, 25 };
+        inline constexpr Register ZMM26{ RegisterType::ZMM, 26 };
+        inline constexpr Register ZMM27{ RegisterType::ZMM, 27 };
+        inline constexpr Register ZMM28{ RegisterType::ZMM, 28 };
+        inline constexpr Register ZMM29{ RegisterType::ZMM, 29 };
+        inline constexpr Register ZMM30{ RegisterType::ZMM, 30 };
+        inline constexpr Register ZMM31{ RegisterType::ZMM, 31 };
+
+        inline constexpr Register K0{ RegisterType::OPMASK, 0 };
+        inline constexpr Register K1{ RegisterType::OPMASK, 1 };
+        inline constexpr Register K2{ RegisterType::OPMASK, 2 };
+        inline constexpr Register K3{ RegisterType::OPMASK, 3 };
+        inline constexpr Register K4{ RegisterType::OPMASK, 4 };
+        inline constexpr Register K5{ RegisterType::OPMASK, 5 };
+        inline constexpr Register K6{ RegisterType::OPMASK, 6 };
+        inline constexpr Register K7{ RegisterType::OPMASK, 7 };
+    }
+
+    // Opmask applied to destination of EVEX encoded instruction. K0 means no masking.
+    // Register converts implicitly to merge-masking, so masked instructions can be called with opmask register directly.
+    struct Mask {
+        Register k{ registers::K0 };
+        bool zeroing{ false }; // If true elements not selected by mask are zeroed ({z}), otherwise they are left unchanged.
+
+        [[nodiscard]] constexpr Mask() noexcept = default;
+        [[nodiscard]] constexpr Mask(const Register k, const bool zeroing = false) noexcept
+            : k(k), zeroing(zeroing) {}
+
+        // Returns zero-masking variant of given opmask.
+        [[nodiscard]] static constexpr Mask Z(const Register k) noexcept {
+            return Mask{ k, true };
+        }
+    };
+
+    // Embedded rounding control of EVEX encoded instruction ({rn-sae}, {rd-sae}, {ru-sae}, {rz-sae}).
+    // Overrides MXCSR rounding mode for single instruction and suppresses all floating point exceptions.
+    // Available only for 512-bit instructions with register operands.
+    enum class Rounding : uint8_t {
+        Nearest = 0, Down = 1, Up = 2, Zero = 3,
+        None = 255
+    };
+
+    // Returns EVEX.L'L field for given vector register.
+    [[nodiscard]] constexpr uint8_t evexVectorLength(const Register reg) noexcept {
+        switch (reg.type) {
+        case RegisterType::XMM:
+            return 0;
+        case RegisterType::YMM:
+            return 1;
+        case RegisterType::ZMM:
+            return 2;
+        default:
+            std::unreachable();
+        }
+    }
+
+    // Calling convention of JIT-compiled functions. Decides where arguments are passed and which registers have to be preserved.
+    enum class CallingConvention : uint8_t {
+        Win64, // Microsoft x64: RCX, RDX, R8, R9; callee-saved: RBX, RBP, RDI, RSI, R12-R15, XMM6-XMM15.
+        SysV, // System V AMD64: RDI, RSI, RDX, RCX, R8, R9; callee-saved: RBX, RBP, R12-R15 (no XMM registers).
+    };
+
+#ifdef _WIN32
+    inline constexpr CallingConvention Native_Calling_Convention{ CallingConvention::Win64 };
+#else
+    inline constexpr CallingConvention Native_Calling_Convention{ CallingConvention::SysV };
+#endif
+
+    // Returns register that holds integer argument with given index (counted from 0) at function entry.
+    // Stack passed arguments are not supported.
+    [[nodiscard]] constexpr Register argumentRegister(const CallingConvention cc, const uint32_t index) noexcept {
+        using namespace registers;
+        constexpr std::array<Register, 4> Win64_Arguments{ RCX, RDX, R08, R09 };
+        constexpr std::array<Register, 6> SysV_Arguments{ RDI, RSI, RDX, RCX, R08, R09 };
+
+        return cc == CallingConvention::Win64 ? Win64_Arguments[index] : SysV_Arguments[index];
+    }
+
+    // Returns true if register has to be preserved by callee.
+    [[nodiscard]] constexpr bool isCalleeSaved(const CallingConvention cc, const Register reg) noexcept {
+        using namespace registers;
+        if (reg.type == RegisterType::GPR) {
+            if (reg == RBX || reg == RBP || reg == RSP || reg.idx >= 12) {
+                return true;
+            }
+
+            return cc == CallingConvention::Win64 && (reg == RSI || reg == RDI);
+        }
+
+        // Only lower 128 bits of XMM6-XMM15 are callee-saved in Win64, upper bits of YMM/ZMM registers are always volatile.
+        return cc == CallingConvention::Win64 && reg.type == RegisterType::XMM && reg.idx >= 6 && reg.idx < 16;
     }
 
     // generates 3rd byte of VEX prefix.
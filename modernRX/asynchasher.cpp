@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <utility>
+
+#include "asynchasher.hpp"
+#include "exception.hpp"
+#include "hasher.hpp"
+
+namespace modernRX {
+    AsyncHasher::HashAwaitable::HashAwaitable(AsyncHasher& hasher, const_span<std::byte> input, Executor executor)
+        : hasher(hasher), input(input.begin(), input.end()), executor(std::move(executor)) {
+        // Digest is calculated here, so it does not extend time spent under hasher's lock.
+        if (hasher.cache != nullptr) {
+            input_digest = HashCache::digest(input);
+        }
+    }
+
+    bool AsyncHasher::HashAwaitable::await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+
+        // Coroutine may be resumed on other thread before enqueue returns, so this is the last access to awaitable here.
+        return hasher.enqueue(this);
+    }
+
+    AsyncHasher::AsyncHasher(const_span<std::byte> key, const uint32_t vm_count, const size_t cache_capacity) :
+        AsyncHasher(std::make_shared<Dataset>(), vm_count, cache_capacity) {
+        reset(key);
+    }
+
+    AsyncHasher::AsyncHasher(std::shared_ptr<Dataset> dataset, const uint32_t vm_count, const size_t cache_capacity) :
+        dataset(std::move(dataset)), pool(vm_count != 0 ? vm_count : Hasher::optimalThreads()) {
+        if (this->dataset == nullptr) {
+            throw Exception{ "Dataset cannot be null" };
+        }
+
+        Hasher::checkCPU();
+
+        if (!pool.pinned()) {
+            throw Exception{ "Failed to initialize VirtualMachine worker threads" };
+        }
+
+        const auto threads{ pool.size() };
+
+        vms.reserve(threads);
+        idle_vms.reserve(threads);
+
+        // Allocate memory for VMs.
+        constexpr auto Vm_Required_Memory{ VirtualMachine::requiredMemory() };
+        scratchpads.reserve(threads * Vm_Required_Memory);
+
+        constexpr auto Vm_Required_Code_Memory{ VirtualMachine::requiredCodeMemory() };
+        jit = DualMappedMemory(threads * Vm_Required_Code_Memory);
+
+        for (uint32_t i = 0; i < threads; ++i) {
+            const auto vm_scratchpad{ scratchpads.buffer<Vm_Required_Memory>(i * Vm_Required_Memory, Vm_Required_Memory) };
+            const JITRxBuffer vm_jit_buffer{ jit.writable(i * Vm_Required_Code_Memory), jit.executable<JITRxProgram>(i * Vm_Required_Code_Memory) };
+            vms.emplace_back(vm_scratchpad, vm_jit_buffer, i);
+            idle_vms.push_back(i);
+        }
+
+        if (cache_capacity != 0) {
+            cache = std::make_unique<HashCache>(cache_capacity);
+        }
+
+        // No VirtualMachine runs yet, so lock is not needed.
+        if (this->dataset->wait()) {
+            current_key = this->dataset->key();
+            key_digest = HashCache::digest(current_key);
+            paused = false;
+        }
+    }
+
+    AsyncHasher::~AsyncHasher() {
+        std::unique_lock lock{ mutex };
+        waitIdle(lock);
+
+        // Queued requests would never be calculated, so their coroutines are resumed with exception instead of being leaked.
+        const auto abandoned{ std::exchange(requests, {}) };
+        lock.unlock();
+
+        if (abandoned.empty()) {
+            return;
+        }
+
+        const auto error{ std::make_exception_ptr(Exception{ "AsyncHasher destroyed before hash was calculated" }) };
+        for (const auto request : abandoned) {
+            request->error = error;
+            resume(request);
+        }
+    }
+
+    AsyncHasher::HashAwaitable AsyncHasher::hash(const_span<std::byte> input, Executor executor) {
+        return HashAwaitable{ *this, input, std::move(executor) };
+    }
+
+    void AsyncHasher::reset(const_span<std::byte> key) {
+        std::unique_lock lock{ mutex };
+        if (!paused && dataset->ready(key)) {
+            return;
+        }
+
+        // Requests queued from now on have to wait for new Dataset.
+        paused = true;
+        waitIdle(lock);
+        lock.unlock();
+
+        const bool generated{ dataset->reset(key) };
+        if (!generated) {
+            throw Exception{ "Failed to generate Dataset" };
+        }
+
+        lock.lock();
+        paused = false;
+        current_key.assign(key.begin(), key.end());
+        key_digest = HashCache::digest(key);
+        dispatch();
+    }
+
+    std::shared_ptr<Dataset> AsyncHasher::getDataset() const noexcept {
+        return dataset;
+    }
+
+    HashCacheStats AsyncHasher::cacheStats() const noexcept {
+        return cache != nullptr ? cache->stats() : HashCacheStats{};
+    }
+
+    bool AsyncHasher::enqueue(HashAwaitable* request) {
+        std::lock_guard lock{ mutex };
+
+        // Cache can be used only while Dataset is generated for key of the digest: it may be reset by this hasher (then it is paused) or by other user of shared Dataset.
+        if (cache != nullptr && !paused && dataset->ready(current_key)) {
+            if (const auto hash{ cache->find(key_digest, request->input_digest) }; hash.has_value()) {
+                request->result = *hash;
+                return false;
+            }
+        }
+
+        requests.push_back(request);
+        dispatch();
+        return true;
+    }
+
+    void AsyncHasher::dispatch() {
+        while (!paused && !requests.empty() && !idle_vms.empty()) {
+            const auto vm_id{ idle_vms.back() };
+            idle_vms.pop_back();
+
+            const auto request{ requests.front() };
+            requests.pop_front();
+
+            // VM with given id always runs on the same pinned worker.
+            pool.submitTo(vm_id, [this, vm_id, request]() {
+                run(vm_id, request);
+            });
+        }
+    }
+
+    void AsyncHasher::run(const uint32_t vm_id, HashAwaitable* request) noexcept {
+        auto& vm{ vms[vm_id] };
+
+        std::unique_lock lock{ mutex, std::defer_lock };
+        while (request != nullptr) {
+            // Reader keeps Dataset from being regenerated while the batch is hashed; it is released between batches, so other users can reset it.
+            const auto reader{ readDataset() };
+            if (!reader.has_value()) {
+                // Requests wait for successful reset.
+                lock.lock();
+                requests.push_front(request);
+                paused = true;
+                idle_vms.push_back(vm_id);
+                idle_cv.notify_all();
+                return;
+            }
+
+            lock.lock();
+            const auto digest{ keyDigest(*reader) };
+            lock.unlock();
+
+            vm.hashFirst(request->input, reader->view());
+
+            // Pipeline requests that are already waiting: next one is seeded while current hash finalizes.
+            // Batch ends early when new Dataset generation is requested, as it waits for reader to be released.
+            while (true) {
+                lock.lock();
+                if (requests.empty() || paused || dataset->state() != DatasetState::Ready) {
+                    lock.unlock();
+                    break;
+                }
+
+                const auto next{ requests.front() };
+                requests.pop_front();
+                lock.unlock();
+
+                const auto hash{ vm.hashNext(next->input) };
+                complete(request, hash, digest);
+                request = next;
+            }
+
+            complete(request, vm.hashLast(), digest);
+            request = nullptr;
+
+            // Requests may have arrived while the last hash was being calculated.
+            lock.lock();
+            if (!requests.empty() && !paused) {
+                request = requests.front();
+                requests.pop_front();
+            } else {
+                idle_vms.push_back(vm_id);
+                idle_cv.notify_all();
+            }
+            lock.unlock();
+        }
+    }
+
+    std::optional<Dataset::Reader> AsyncHasher::readDataset() const noexcept {
+        while (true) {
+            if (auto reader{ dataset->read() }; reader.has_value()) {
+                return reader;
+            }
+
+            bool generated{ false };
+            try {
+                generated = dataset->wait();
+            } catch (...) {
+                // Failure is reported to the user that reset the Dataset.
+            }
+
+            // Generation may have been cancelled by a newer one, which has to be waited for as well.
+            if (!generated && dataset->state() != DatasetState::Generating) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    HashCache::Digest AsyncHasher::keyDigest(const Dataset::Reader& reader) {
+        if (cache != nullptr && !std::ranges::equal(reader.key(), current_key)) {
+            current_key.assign(reader.key().begin(), reader.key().end());
+            key_digest = HashCache::digest(current_key);
+        }
+
+        return key_digest;
+    }
+
+    void AsyncHasher::complete(HashAwaitable* request, const RxHash& hash, const HashCache::Digest& digest) noexcept {
+        if (cache != nullptr) {
+            cache->insert(digest, request->input_digest, hash);
+        }
+
+        request->result = hash;
+        resume(request);
+    }
+
+    void AsyncHasher::resume(HashAwaitable* request) noexcept {
+        if (!request->executor) {
+            request->handle.resume();
+            return;
+        }
+
+        // Executor may resume coroutine (and destroy request with its frame) before it returns, so it is moved out first.
+        const auto executor{ std::move(request->executor) };
+        executor(request->handle);
+    }
+
+    void AsyncHasher::waitIdle(std::unique_lock<std::mutex>& lock) {
+        idle_cv.wait(lock, [this]() {
+            return idle_vms.size() == vms.size();
+        });
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+* Coroutine-based RandomX hash calculator meant for verification of many independent inputs (e.g. blocks received from network).
+* Hashes are calculated by fixed number of VirtualMachines, each driven by its own pinned worker, so any number of hashes
+* can be awaited at once (co_await hasher.hash(input)) without parking a thread per hash.
+* Workers are not taken from shared thread pool, because its workers may be occupied by long-running tasks (e.g. Hasher's mining loops).
+* Requests waiting in queue are pipelined: scratchpad for the next request is filled while hash of the previous one finalizes.
+* Optionally, calculated hashes are stored in HashCache, so duplicated inputs are served without running VirtualMachine.
+* Not a part of RandomX algorithm.
+*/
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "dataset.hpp"
+#include "hash.hpp"
+#include "hashcache.hpp"
+#include "heaparray.hpp"
+#include "threadpool.hpp"
+#include "virtualmachine.hpp"
+#include "virtualmem.hpp"
+
+namespace modernRX {
+    class AsyncHasher {
+    public:
+        // Resumes awaiting coroutine. Called on VirtualMachine's worker thread, so it should hand coroutine over to caller's executor (e.g. post it to event loop);
+        // coroutine resumed inline keeps VirtualMachine busy until it suspends again.
+        using Executor = std::function<void(std::coroutine_handle<>)>;
+
+        // Awaitable returned by hash. Holds request state in awaiting coroutine's frame, so no allocation is needed per hash.
+        class [[nodiscard]] HashAwaitable {
+        public:
+            HashAwaitable(const HashAwaitable&) = delete;
+            HashAwaitable& operator=(const HashAwaitable&) = delete;
+            HashAwaitable(HashAwaitable&&) = delete;
+            HashAwaitable& operator=(HashAwaitable&&) = delete;
+
+            [[nodiscard]] bool await_ready() const noexcept {
+                return false;
+            }
+
+            // Returns false if hash was found in cache, so coroutine continues without suspension.
+            [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle);
+
+            // Throws if hasher was destroyed before hash was calculated.
+            [[nodiscard]] RxHash await_resume() const {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+
+                return result;
+            }
+
+        private:
+            friend class AsyncHasher;
+
+            [[nodiscard]] explicit HashAwaitable(AsyncHasher& hasher, const_span<std::byte> input, Executor executor);
+
+            AsyncHasher& hasher;
+            std::vector<std::byte> input; // Copy of input, so caller's buffer does not need to outlive the call.
+            HashCache::Digest input_digest; // Calculated only if cache is enabled.
+            Executor executor;
+            std::coroutine_handle<> handle;
+            RxHash result;
+            std::exception_ptr error; // Set if request was abandoned without calculating hash.
+        };
+
+        // Generates Dataset for given key and allocates given number of VirtualMachines (by default as many as Hasher would use).
+        // If cache capacity is not 0, calculated hashes are cached (see HashCache); by default cache is disabled.
+        // Throws if CPU is not supported or VirtualMachine workers cannot be pinned.
+        [[nodiscard]] explicit AsyncHasher(const_span<std::byte> key, const uint32_t vm_count = 0, const size_t cache_capacity = 0);
+
+        // Same as above, but uses Dataset shared with other hashers (e.g. mining Hasher). Waits for generation in progress.
+        // If dataset is not generated, hashes are queued until reset is called. Throws if dataset is null.
+        [[nodiscard]] explicit AsyncHasher(std::shared_ptr<Dataset> dataset, const uint32_t vm_count = 0, const size_t cache_capacity = 0);
+
+        // Waits for hashes being calculated and resumes their coroutines. Coroutines of hashes still queued (e.g. while Dataset is not generated)
+        // are resumed with exception, so none of them is leaked. Resumed coroutines must not use this hasher anymore.
+        ~AsyncHasher();
+
+        AsyncHasher(const AsyncHasher&) = delete;
+        AsyncHasher& operator=(const AsyncHasher&) = delete;
+        AsyncHasher(AsyncHasher&&) = delete;
+        AsyncHasher& operator=(AsyncHasher&&) = delete;
+
+        // Returns awaitable that yields RandomX hash of given input (of any size). Input is copied at call.
+        // Awaiting coroutine is resumed with given executor, or inline on VirtualMachine's worker thread if executor is empty.
+        HashAwaitable hash(const_span<std::byte> input, Executor executor = nullptr);
+
+        // Resets Dataset with new key. Does nothing if Dataset is already generated for given key (e.g. by other user of shared Dataset).
+        // Hashes already being calculated are finished with previous key; queued ones wait and are calculated with new key.
+        // If generation fails (also when it was started by other user of shared Dataset), queued hashes keep waiting for successful reset.
+        // Must not be called from coroutine resumed inline on VirtualMachine's worker thread.
+        void reset(const_span<std::byte> key);
+
+        // Returns Dataset used by this hasher, so it can be shared.
+        [[nodiscard]] std::shared_ptr<Dataset> getDataset() const noexcept;
+
+        // Returns hit/miss counters of hash cache. All zeros if cache is disabled.
+        [[nodiscard]] HashCacheStats cacheStats() const noexcept;
+
+    private:
+        std::vector<VirtualMachine> vms; // Virtual machines used for program execution.
+        std::shared_ptr<Dataset> dataset; // Dataset used for program execution.
+        HeapArray<std::byte, 64 * Rx_Scratchpad_L3_Size> scratchpads; // Scratchpads used for program execution.
+        DualMappedMemory jit; // JIT-compiled RandomX program buffers.
+        std::unique_ptr<HashCache> cache; // Cache of calculated hashes. Null if disabled.
+
+        std::mutex mutex; // Guards all fields below.
+        std::vector<std::byte> current_key; // Key of Dataset content most recently used by this hasher. Dataset may be reset by its other users.
+        HashCache::Digest key_digest{}; // Digest of current_key, under which hashes are cached.
+        std::condition_variable idle_cv; // Notified when VirtualMachine becomes idle.
+        std::deque<HashAwaitable*> requests; // Requests waiting for VirtualMachine.
+        std::vector<uint32_t> idle_vms; // VirtualMachines not running on thread pool.
+        bool paused{ true }; // True while Dataset is not generated; requests are only queued then.
+
+        // Queues request and starts idle VirtualMachine if there is any.
+        // Returns false if request was not queued, because its hash was found in cache.
+        [[nodiscard]] bool enqueue(HashAwaitable* request);
+
+        // Starts idle VirtualMachines for queued requests. Requires locked mutex.
+        void dispatch();
+
+        // Calculates hashes of given and queued requests on given VirtualMachine, until queue is empty.
+        void run(const uint32_t vm_id, HashAwaitable* request) noexcept;
+
+        // Returns reader of generated Dataset, waiting for generation started by other user of shared Dataset. Returns std::nullopt if generation failed.
+        [[nodiscard]] std::optional<Dataset::Reader> readDataset() const noexcept;
+
+        // Returns digest of key that given reader's content was generated for. Requires locked mutex.
+        [[nodiscard]] HashCache::Digest keyDigest(const Dataset::Reader& reader);
+
+        // Stores hash in request (and cache under given key digest) and resumes awaiting coroutine.
+        // Request must not be accessed afterwards, as it is part of coroutine's frame.
+        void complete(HashAwaitable* request, const RxHash& hash, const HashCache::Digest& digest) noexcept;
+
+        // Resumes awaiting coroutine with its executor, or inline if there is none. Request must not be accessed afterwards.
+        static void resume(HashAwaitable* request) noexcept;
+
+        // Blocks until all VirtualMachines are idle. Requires locked mutex.
+        void waitIdle(std::unique_lock<std::mutex>& lock);
+
+        // Workers dedicated to VirtualMachines (one per VirtualMachine). They are pinned the same way as shared pool workers, so VirtualMachines
+        // of Hasher mining at the same time share processors with them. Declared last, so workers are joined before any other field is destroyed.
+        ThreadPool pool;
+    };
+}
@@ -64,6 +64,15 @@ namespace modernRX::intrinsics::avx2 {
         }
     }
 
+    template<typename T, int imm8>
+    [[nodiscard]] constexpr ymm<T> vsrlepi64(const ymm<T> x) noexcept {
+        if constexpr (std::is_same_v<T, uint64_t>) {
+            return _mm256_srli_epi64(x, imm8);
+        } else {
+            static_assert(!sizeof(T), "the only supported type for this operation is: uint64");
+        }
+    }
+
     template<typename T, int imm8>
     [[nodiscard]] constexpr ymm<T> vblendepi32(const ymm<T> x, const ymm<T> y) noexcept {
         if constexpr (std::is_same_v<T, uint64_t>) {
@@ -11,6 +11,20 @@ namespace modernRX::blake2b {
     namespace {
         template<bool Last>
         void compress(Context& ctx) noexcept;
+
+        template<bool Last, Isa Target>
+        void compressIsa(Context& ctx) noexcept;
+
+        // Message blocks of every lane, laid out one after another, so words of the same index can be gathered into single ZMM register.
+        using LaneBlocks = std::array<std::array<std::array<uint64_t, Block_Size / sizeof(uint64_t)>, 2>, Multi_Buffer_Lanes>;
+
+        // Initialization vector as scalars, used to broadcast into every lane of multi-buffer state.
+        constexpr std::array<uint64_t, 8> IV_Words{
+            0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+        };
+
+        void compressMany(std::array<intrinsics::zmm<uint64_t>, 8>& state, const LaneBlocks& blocks, const uint32_t block, const uint64_t counter, const bool last) noexcept;
     }
 
     void hash(std::span<std::byte> output, const_span<std::byte> input) noexcept {
@@ -40,6 +54,81 @@ namespace modernRX::blake2b {
         final(output, ctx);
     }
 
+    void hashAny(std::span<std::byte> output, const_span<std::byte> input) noexcept {
+        ASSERTUME(output.size() == Max_Digest_Size / 2 || output.size() == Max_Digest_Size);
+
+        Context ctx{ static_cast<uint32_t>(output.size()) };
+
+        // Every block but the last one is compressed as soon as it is filled.
+        while (input.size() > Block_Size) {
+            update(ctx, input.first(Block_Size));
+            compress<false>(ctx);
+            input = input.subspan(Block_Size);
+        }
+
+        // Last block has to be padded with zeros, but previous blocks left their data in block buffer.
+        ctx.block.fill(std::byte{ 0 });
+        if (!input.empty()) {
+            update(ctx, input);
+        }
+
+        final(output, ctx);
+    }
+
+    void hashMany(std::span<const std::span<std::byte>> outputs, std::span<const std::span<const std::byte>> inputs) noexcept {
+        ASSERTUME(inputs.size() > 0 && inputs.size() <= Multi_Buffer_Lanes);
+        ASSERTUME(outputs.size() == inputs.size());
+
+        const size_t input_size{ inputs[0].size() };
+        const uint32_t digest_size{ static_cast<uint32_t>(outputs[0].size()) };
+        ASSERTUME(input_size > 0 && input_size <= 256);
+        ASSERTUME(digest_size == Max_Digest_Size / 2 || digest_size == Max_Digest_Size);
+
+        // Multi-buffer kernel requires AVX512; fallback hashes every input separately.
+        if (selectedIsa() != Isa::AVX512) {
+            for (size_t lane = 0; lane < inputs.size(); ++lane) {
+                hash(outputs[lane], inputs[lane]);
+            }
+            return;
+        }
+
+        using namespace intrinsics;
+
+        // Unused lanes hash zeros and their results are dropped.
+        alignas(64) LaneBlocks blocks{};
+        for (size_t lane = 0; lane < inputs.size(); ++lane) {
+            ASSERTUME(inputs[lane].size() == input_size && outputs[lane].size() == digest_size);
+            std::memcpy(blocks[lane].data(), inputs[lane].data(), input_size);
+        }
+
+        // Initialize state of every lane.
+        std::array<zmm<uint64_t>, 8> state;
+        for (uint32_t i = 0; i < state.size(); ++i) {
+            state[i] = _mm512_set1_epi64(IV_Words[i]);
+        }
+        state[0] = avx512::vpxorq(state[0], _mm512_set1_epi64(0x01010000 ^ digest_size));
+
+        // With the same assumptions as for hash, no more than two blocks will be compressed.
+        if (input_size <= Block_Size) {
+            compressMany(state, blocks, 0, input_size, true);
+        } else {
+            compressMany(state, blocks, 0, Block_Size, false);
+            compressMany(state, blocks, 1, input_size, true);
+        }
+
+        // Transpose state back: i-th word of every lane lands in i-th row.
+        alignas(64) std::array<std::array<uint64_t, Multi_Buffer_Lanes>, 8> words;
+        for (uint32_t i = 0; i < state.size(); ++i) {
+            _mm512_store_si512(words[i].data(), state[i]);
+        }
+
+        for (size_t lane = 0; lane < outputs.size(); ++lane) {
+            for (uint32_t i = 0; i < digest_size / sizeof(uint64_t); ++i) {
+                std::memcpy(outputs[lane].data() + i * sizeof(uint64_t), &words[i][lane], sizeof(uint64_t));
+            }
+        }
+    }
+
     inline namespace internal {
         Context::Context(const uint32_t digest_size) noexcept
             : digest_size{ digest_size } {
@@ -78,9 +167,19 @@ namespace modernRX::blake2b {
 
     namespace {
         // Compress does all the magic with compressing block buffer. Works differently for last and non-last block buffer.
-        // Optimized with AVX2 intrinsics.
+        // Dispatches to kernel specialized for selected instruction set.
         template<bool Last>
         void compress(Context& ctx) noexcept {
+            if (selectedIsa() == Isa::AVX512) {
+                compressIsa<Last, Isa::AVX512>(ctx);
+            } else {
+                compressIsa<Last, Isa::AVX2>(ctx);
+            }
+        }
+
+        // Optimized with AVX2 intrinsics. AVX512 variant uses native rotation instruction.
+        template<bool Last, Isa Target>
+        void compressIsa(Context& ctx) noexcept {
             using namespace intrinsics;
 
             // Prepare block for permutations.
@@ -110,24 +209,71 @@ namespace modernRX::blake2b {
             const auto rot16{ avx2::vsetrepi8<uint64_t>(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9) };
 
             // Make cryptographic message mixing (12 rounds)
-            ROUND(0, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(1, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(2, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(3, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(4, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(5, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(6, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(7, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(8, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(9, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 0, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 1, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 2, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 3, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 4, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 5, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 6, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 7, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 8, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 9, msg, v1, v2, v3, v4, rot24, rot16);
 
             // Round 10 is the same as round 0, and round 11 is the same as round 1
-            ROUND(0, msg, v1, v2, v3, v4, rot24, rot16);
-            ROUND(1, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 0, msg, v1, v2, v3, v4, rot24, rot16);
+            ROUND(Target, 1, msg, v1, v2, v3, v4, rot24, rot16);
 
             // Finalize compression
             ctx.state[0] = avx2::vxor<uint64_t>(ctx.state[0], avx2::vxor<uint64_t>(v1, v3));
             ctx.state[1] = avx2::vxor<uint64_t>(ctx.state[1], avx2::vxor<uint64_t>(v2, v4));
         }
+
+        // Compresses one block of every lane. Every 64-bit lane of working vector belongs to other message, so state is never diagonalized.
+        // Optimized with AVX512 intrinsics.
+        void compressMany(std::array<intrinsics::zmm<uint64_t>, 8>& state, const LaneBlocks& blocks, const uint32_t block, const uint64_t counter, const bool last) noexcept {
+            using namespace intrinsics;
+
+            // Gather i-th word of every lane's block into i-th message register.
+            constexpr uint64_t Lane_Stride{ sizeof(LaneBlocks::value_type) / sizeof(uint64_t) };
+            const auto lane_offsets{ _mm512_setr_epi64(0, Lane_Stride, 2 * Lane_Stride, 3 * Lane_Stride, 4 * Lane_Stride, 5 * Lane_Stride, 6 * Lane_Stride, 7 * Lane_Stride) };
+
+            std::array<zmm<uint64_t>, 16> m;
+            for (uint32_t i = 0; i < m.size(); ++i) {
+                m[i] = _mm512_i64gather_epi64(lane_offsets, blocks[0][block].data() + i, sizeof(uint64_t));
+            }
+
+            // Initialize working vector.
+            std::array<zmm<uint64_t>, 16> v;
+            for (uint32_t i = 0; i < 8; ++i) {
+                v[i] = state[i];
+                v[i + 8] = _mm512_set1_epi64(IV_Words[i]);
+            }
+            v[12] = avx512::vpxorq(v[12], _mm512_set1_epi64(counter));
+            if (last) {
+                v[14] = avx512::vpxorq(v[14], _mm512_set1_epi64(-1));
+            }
+
+            // Make cryptographic message mixing (12 rounds)
+            ROUND8(0, v, m);
+            ROUND8(1, v, m);
+            ROUND8(2, v, m);
+            ROUND8(3, v, m);
+            ROUND8(4, v, m);
+            ROUND8(5, v, m);
+            ROUND8(6, v, m);
+            ROUND8(7, v, m);
+            ROUND8(8, v, m);
+            ROUND8(9, v, m);
+
+            // Round 10 is the same as round 0, and round 11 is the same as round 1
+            ROUND8(0, v, m);
+            ROUND8(1, v, m);
+
+            // Finalize compression
+            for (uint32_t i = 0; i < 8; ++i) {
+                state[i] = avx512::vpxorq(state[i], avx512::vpxorq(v[i], v[i + 8]));
+            }
+        }
     }
 };
@@ -3,6 +3,7 @@
 /*
 * Single-threaded, AVX2 supported and RandomX-specialized implementation of Blake2b based on: https://datatracker.ietf.org/doc/html/rfc7693 and https://github.com/tevador/RandomX
 * This is used by Argon2d algorithm, Blake2bRandom, Aes4RGenerator and by the RandomX algorithm to calculate final hash.
+* Multi-buffer variant (hashMany) is AVX512 supported and is used to seed many VMs at once (on AVX2 CPUs it hashes inputs one by one).
 */
 
 #include <array>
@@ -32,6 +33,23 @@ namespace modernRX::blake2b {
     */
     void hash(std::span<std::byte> output, const_span<std::byte> input) noexcept;
 
+    // Same as hash, but without assumption about input size (input may be empty or longer than 256 bytes).
+    // Slower than hash. Used where input comes from outside of RandomX algorithm (e.g. C interface, see randomx.h).
+    void hashAny(std::span<std::byte> output, const_span<std::byte> input) noexcept;
+
+    inline constexpr uint32_t Multi_Buffer_Lanes{ 8 }; // Number of messages hashed in parallel by hashMany (one per 64-bit lane of ZMM register).
+
+    /*
+    * Multi-buffer version of hash. Hashes up to Multi_Buffer_Lanes independent messages at once and stores i-th hash in i-th output.
+    * Used to seed batch of VMs or verify batch of hashes, where many small and equally sized inputs are hashed one after another.
+    * Same assumptions as for hash apply, additionally:
+    *   - Number of inputs and outputs is equal and between 1 and Multi_Buffer_Lanes.
+    *   - All inputs have the same size and all outputs have the same size.
+    *
+    * Produces the same results as calling hash for every input/output pair. Inputs must not overlap with outputs.
+    */
+    void hashMany(std::span<const std::span<std::byte>> outputs, std::span<const std::span<const std::byte>> inputs) noexcept;
+
     // The content of this namespace should be internal, but Argon2d implementation relies on these.
     inline namespace internal {
         // Holds current state of blake2b algorithm.
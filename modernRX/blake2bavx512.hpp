@@ -3,10 +3,14 @@
 /*
 * Blake2b AVX512 single round function implementation based on libsodium implementation: 
 * https://github.com/jedisct1/libsodium/blob/1.0.16/src/libsodium/crypto_generichash/blake2b/ref/blake2b-compress-avx2.h
+* Single round works on YMM registers, so it is also used as AVX2 fallback (with emulated rotation).
 */
 
+#include <array>
+
 #include "avx2.hpp"
 #include "avx512.hpp"
+#include "isa.hpp"
 
 namespace modernRX::blake2b {
     // Exception from rule to not use macros.
@@ -16,7 +20,8 @@ namespace modernRX::blake2b {
     // vshuffleepi32 performs right rotation by 32 bits.
     // vshuffleepi8 performs right rotation by 24 or 16 bits accordingly to mask.
     // vpermuteepi64 performs rotation by 64, 128 or 192 bits.
-#define ROUND(round, msg, v1, v2, v3, v4, rot24, rot16) do {                        \
+    // ror63 performs right rotation by 63 bits, natively or emulated accordingly to isa.
+#define ROUND(isa, round, msg, v1, v2, v3, v4, rot24, rot16) do {                   \
 /*G1V1*/                                                                            \
         v1 = intrinsics::avx2::vadd<uint64_t>(v1, m);                               \
         v1 = intrinsics::avx2::vadd<uint64_t>(v1, v2);                              \
@@ -34,7 +39,7 @@ namespace modernRX::blake2b {
         v4 = intrinsics::avx2::vshuffleepi8<uint64_t>(v4, rot16);                   \
         v3 = intrinsics::avx2::vadd<uint64_t>(v3, v4);                              \
         v2 = intrinsics::avx2::vxor<uint64_t>(v2, v3);                              \
-        v2 = intrinsics::avx512::vprorq<ymm<uint64_t>, 63>(v2);                     \
+        v2 = ror63<isa>(v2);                                                        \
 /*DIAG_V1*/                                                                         \
         v2 = intrinsics::avx2::vpermuteepi64<uint64_t, 0b00'11'10'01>(v2);          \
         v4 = intrinsics::avx2::vpermuteepi64<uint64_t, 0b10'01'00'11>(v4);          \
@@ -56,7 +61,7 @@ namespace modernRX::blake2b {
         v4 = intrinsics::avx2::vshuffleepi8<uint64_t>(v4, rot16);                   \
         v3 = intrinsics::avx2::vadd<uint64_t>(v3, v4);                              \
         v2 = intrinsics::avx2::vxor<uint64_t>(v2, v3);                              \
-        v2 = intrinsics::avx512::vprorq<ymm<uint64_t>, 63>(v2);                     \
+        v2 = ror63<isa>(v2);                                                        \
 /*UNDIAG_V1*/                                                                       \
         v2 = intrinsics::avx2::vpermuteepi64<uint64_t, 0b10'01'00'11>(v2);          \
         v4 = intrinsics::avx2::vpermuteepi64<uint64_t, 0b00'11'10'01>(v4);          \
@@ -64,6 +69,16 @@ namespace modernRX::blake2b {
 } while(0);
 
 
+    // Rotates every quadword right by 63 bits. AVX2 has no rotate instruction, so it is emulated with shift and add.
+    template<Isa Target>
+    [[nodiscard]] inline intrinsics::ymm<uint64_t> ror63(const intrinsics::ymm<uint64_t> x) noexcept {
+        if constexpr (Target == Isa::AVX512) {
+            return intrinsics::avx512::vprorq<intrinsics::ymm<uint64_t>, 63>(x);
+        } else {
+            return intrinsics::avx2::vxor<uint64_t>(intrinsics::avx2::vsrlepi64<uint64_t, 63>(x), intrinsics::avx2::vadd<uint64_t>(x, x));
+        }
+    }
+
     // Permute the message words for avx2 enhanced version.
     // Its important that this function was always inlined otherwise it may hurt performance.
     // There's no way to force inlining, so it would be safier to use macro, but it seems that compiler is smart enough to inline it anyway.
@@ -252,4 +267,50 @@ namespace modernRX::blake2b {
             static_assert(!N, "Invalid template parameter N");
         }
     }
+
+    // Message word schedule for every round: https://datatracker.ietf.org/doc/html/rfc7693#section-2.7
+    // Used by multi-buffer version, where message words are not permuted but selected by index.
+    inline constexpr std::array<std::array<uint8_t, 16>, 10> Sigma{ {
+        { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+        { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+        { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+        { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+        { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+        { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+        { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+        { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+        { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+        { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+    } };
+
+    // Multi-buffer mixing function. Every 64-bit lane of ZMM register holds word of other, independent message,
+    // so there is no need for diagonalization and rotations are made with single vprorq.
+    // Macro for the same reason as ROUND.
+#define G8(a, b, c, d, x, y) do {                                                   \
+        a = intrinsics::avx512::vpaddq(a, b);                             \
+        a = intrinsics::avx512::vpaddq(a, x);                             \
+        d = intrinsics::avx512::vpxorq(d, a);                             \
+        d = intrinsics::avx512::vprorq<intrinsics::zmm<uint64_t>, 32>(d);           \
+        c = intrinsics::avx512::vpaddq(c, d);                             \
+        b = intrinsics::avx512::vpxorq(b, c);                             \
+        b = intrinsics::avx512::vprorq<intrinsics::zmm<uint64_t>, 24>(b);           \
+        a = intrinsics::avx512::vpaddq(a, b);                             \
+        a = intrinsics::avx512::vpaddq(a, y);                             \
+        d = intrinsics::avx512::vpxorq(d, a);                             \
+        d = intrinsics::avx512::vprorq<intrinsics::zmm<uint64_t>, 16>(d);           \
+        c = intrinsics::avx512::vpaddq(c, d);                             \
+        b = intrinsics::avx512::vpxorq(b, c);                             \
+        b = intrinsics::avx512::vprorq<intrinsics::zmm<uint64_t>, 63>(b);           \
+} while(0);
+
+#define ROUND8(round, v, m) do {                                                    \
+        G8(v[0], v[4], v[8],  v[12], m[Sigma[round][0]],  m[Sigma[round][1]]);      \
+        G8(v[1], v[5], v[9],  v[13], m[Sigma[round][2]],  m[Sigma[round][3]]);      \
+        G8(v[2], v[6], v[10], v[14], m[Sigma[round][4]],  m[Sigma[round][5]]);      \
+        G8(v[3], v[7], v[11], v[15], m[Sigma[round][6]],  m[Sigma[round][7]]);      \
+        G8(v[0], v[5], v[10], v[15], m[Sigma[round][8]],  m[Sigma[round][9]]);      \
+        G8(v[1], v[6], v[11], v[12], m[Sigma[round][10]], m[Sigma[round][11]]);     \
+        G8(v[2], v[7], v[8],  v[13], m[Sigma[round][12]], m[Sigma[round][13]]);     \
+        G8(v[3], v[4], v[9],  v[14], m[Sigma[round][14]], m[Sigma[round][15]]);     \
+} while(0);
 }
@@ -1,4 +1,6 @@
 #include "bytecodecompiler.hpp"
+#include "cpuinfo.hpp"
+#include "isa.hpp"
 #include "randomxparams.hpp"
 #include "reciprocal.hpp"
 #include "sse.hpp"
@@ -9,634 +11,940 @@ namespace modernRX {
         constexpr uint32_t Scratchpad_L2_Mask{ (Rx_Scratchpad_L2_Size - 1) & ~7 }; // L2 cache 8-byte alignment mask.
         constexpr uint32_t Scratchpad_L3_Mask{ (Rx_Scratchpad_L3_Size - 1) & ~7 }; // L3 cache 8-byte alignment mask.
         constexpr uint8_t Sib_Reg_Idx{ 4 };
-    }
-
-    void BytecodeCompiler::iaddrs_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        constexpr uint8_t Displacement_Reg_Idx{ 5 };
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
 
-        reg_usage[dst_register] = idx;
-        const auto scale{ 64 * instr.modShift() };
-        const auto index{ 8 * src_register };
-        const auto base{ dst_register };
+        // Scratchpad levels used as index into Memory_Operand_Code.
+        constexpr uint32_t Scratchpad_L1{ 0 };
+        constexpr uint32_t Scratchpad_L2{ 1 };
+        constexpr uint32_t Scratchpad_L3{ 2 };
+
+        // Register that holds scratchpad address of memory operand. Multiplication instructions need RAX for themselves.
+        enum class AddressRegister : uint8_t {
+            RAX = 0, RCX = 1
+        };
+
+        // Kinds of immediate patched into instruction template at compilation. Value is index into Imm_Masks.
+        enum class Imm : uint8_t {
+            None = 0,
+            Imm32 = 1, // imm32 as is.
+            L3_Offset = 2, // imm32 masked to 8-byte aligned L3 scratchpad offset.
+            Rotate = 3, // imm32 % 64 as 8-bit rotation count.
+        };
+
+        // Masks applied to instruction's imm32 before it is patched into template.
+        constexpr std::array<uint32_t, 4> Imm_Masks{ 0, 0xffff'ffff, Scratchpad_L3_Mask, 63 };
+
+        // Machine code of single instruction for one combination of operands, with immediate left zeroed.
+        // Template is copied as a whole (32 bytes), bytes after the code are overwritten by the next instruction.
+        struct alignas(32) InstrTemplate {
+            std::array<uint8_t, 29> code{};
+            uint8_t size{ 0 };
+            uint8_t imm_offset{ 0 }; // Immediate is OR-ed as 32-bit value, so code must not have anything but zeros in its place.
+            Imm imm{ Imm::None };
+
+            // Appends given number of bytes of value (little-endian).
+            constexpr void put(const uint64_t value, const uint32_t count) noexcept {
+                for (uint32_t i = 0; i < count; ++i) {
+                    code[size++] = static_cast<uint8_t>(value >> (8 * i));
+                }
+            }
 
-        if (dst_register != Displacement_Reg_Idx) {
-            const uint32_t lea{ 0x00'04'8d'4f | uint32_t(scale | index | base) << 24 | uint32_t(8 * dst_register) << 16 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            code_size += 4;
+            // Appends zeroed space of given size for immediate of given kind.
+            constexpr void putImm(const Imm kind, const uint32_t imm_size) noexcept {
+                imm = kind;
+                imm_offset = size;
+                size += imm_size;
+            }
+        };
+        static_assert(sizeof(InstrTemplate) == 32);
+
+        // Generates table of templates. Generator is called with index of every template and decodes operands from it.
+        template<size_t Size, typename Generator>
+        [[nodiscard]] consteval std::array<InstrTemplate, Size> makeTemplates(Generator generator) {
+            std::array<InstrTemplate, Size> table{};
+            for (uint32_t i = 0; i < Size; ++i) {
+                table[i] = generator(i);
+            }
 
-        } else {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t lea{ 0x00'00'00'00'00'ac'8d'4f | uint64_t(scale | index | base) << 24 | imm << 32 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            code_size += 8;
+            return table;
         }
 
-    }
+        // Writes template into code buffer and patches its immediate. Returns size of written code.
+        [[nodiscard]] uint32_t compileTemplate(char* const code, const InstrTemplate& tmpl, const uint32_t imm) noexcept {
+            std::memcpy(code, &tmpl, sizeof(tmpl));
 
-    void BytecodeCompiler::iaddm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t imm{ instr.imm32 };
-            const auto mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x04'03'4c'00'00'00'00'25 | uint64_t(mem_mask) << 8 | uint64_t(8 * dst_register) << 56 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint8_t mov{ static_cast<uint8_t>(0x06) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 1);
-                code_size += 17;
-            } else {
-                const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x03'4c'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint16_t mov{ static_cast<uint16_t>(0x06'04 | uint16_t(8 * dst_register)) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 2);
-                code_size += 18;
-            }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
-            const uint64_t add{ 0x00'00'00'00'00'86'03'4c | uint64_t(8 * dst_register) << 16 | offset << 24 };
-            std::memcpy(code_buffer + code_size, &add, sizeof(add));
-            code_size += 7;
+            // Immediate is OR-ed with bytes of the template, not the ones just written, to not stall on store forwarding.
+            uint32_t patched;
+            std::memcpy(&patched, tmpl.code.data() + tmpl.imm_offset, sizeof(patched));
+            patched |= imm & Imm_Masks[static_cast<uint8_t>(tmpl.imm)];
+            std::memcpy(code + tmpl.imm_offset, &patched, sizeof(patched));
+
+            return tmpl.size;
         }
-    }
 
-    void BytecodeCompiler::isubr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
+        // Machine code of every instruction for every combination of registers and modes is generated at compile time,
+        // so compiling instruction is a lookup of its template and patching of immediate.
+        // Index of template is given next to each table. Tables are not indexed by operands that do not change the code.
 
-        if (dst_register != src_register) {
-            const uint32_t sub{ 0x00'c0'29'4d | uint32_t(dst_register + 8 * src_register) << 16 };
-            std::memcpy(code_buffer + code_size, &sub, sizeof(sub));
-            code_size += 3;
-        } else {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t sub{ 0x00'00'00'00'00'e8'81'49 | uint64_t(dst_register) << 16 | imm << 24 };
-            std::memcpy(code_buffer + code_size, &sub, sizeof(sub));
-            code_size += 7;
+        // Returns index of memory operand template in Memory_Operand_Code.
+        [[nodiscard]] constexpr uint32_t memoryOperandIndex(const uint32_t addr, const uint32_t base, const uint32_t level) noexcept {
+            return 3 * (Int_Register_Count * addr + base) + level;
         }
-    }
 
-    void BytecodeCompiler::isubm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const auto imm{ instr.imm32 };
-            const auto mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x04'2b'4c'00'00'00'00'25 | uint64_t(mem_mask) << 8 | uint64_t(8 * dst_register) << 56 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint8_t mov{ static_cast<uint8_t>(0x06) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 1);
-                code_size += 17;
-            } else {
-                const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x2b'4c'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint16_t mov{ static_cast<uint16_t>(0x06'04 | uint16_t(8 * dst_register)) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 2);
-                code_size += 18;
+        // Index of empty template, compiled for instructions without memory operand.
+        constexpr uint32_t No_Memory_Operand{ memoryOperandIndex(2, 0, 0) };
+
+        // lea rax/rcx, [base + imm32]; and rax/rcx, mask. Index: memoryOperandIndex(address register, base, scratchpad level).
+        constexpr alignas(64) std::array<InstrTemplate, No_Memory_Operand + 1> Memory_Operand_Code = []() consteval {
+            std::array<InstrTemplate, No_Memory_Operand + 1> table{};
+            constexpr std::array<uint32_t, 3> Masks{ Scratchpad_L1_Mask, Scratchpad_L2_Mask, Scratchpad_L3_Mask };
+
+            for (uint8_t addr = 0; addr < 2; ++addr) {
+                for (uint8_t base = 0; base < Int_Register_Count; ++base) {
+                    for (uint32_t level = 0; level < Masks.size(); ++level) {
+                        auto& mem{ table[memoryOperandIndex(addr, base, level)] };
+
+                        // lea rax/rcx, [r8-r15 + imm32]
+                        mem.put(0x8d'49, 2);
+                        mem.put(0x80 | (addr << 3) | base, 1);
+                        if (base == Sib_Reg_Idx) {
+                            mem.put(0x24, 1);
+                        }
+
+                        mem.putImm(Imm::Imm32, sizeof(uint32_t));
+
+                        // and rax/rcx, mask
+                        if (static_cast<AddressRegister>(addr) == AddressRegister::RAX) {
+                            mem.put(0x25'48, 2);
+                        } else {
+                            mem.put(0xe1'81'48, 3);
+                        }
+
+                        mem.put(Masks[level], sizeof(uint32_t));
+                    }
+                }
             }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
-            const uint64_t add{ 0x00'00'00'00'00'86'2b'4c | uint64_t(8 * dst_register) << 16 | offset << 24 };
-            std::memcpy(code_buffer + code_size, &add, sizeof(add));
-            code_size += 7;
-        }
-    }
 
-    void BytecodeCompiler::imulr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
+            return table;
+        }();
 
-        reg_usage[dst_register] = idx;
+        // lea dst, [dst + src * scale (+ imm32)]. Index: [shift][dst][src].
+        constexpr auto Iadd_Rs_Code{ makeTemplates<4 * Int_Register_Count * Int_Register_Count>([](const uint32_t i) {
+            constexpr uint8_t Displacement_Reg_Idx{ 5 };
+            const uint32_t shift{ i / 64 }, dst_register{ (i / 8) % 8 }, src_register{ i % 8 };
+            const auto sib{ 64 * shift | 8 * src_register | dst_register };
 
-        if (dst_register != src_register) {
-            const uint32_t imul{ 0xc0'af'0f'4d | uint32_t(8 * dst_register + src_register) << 24 };
-            std::memcpy(code_buffer + code_size, &imul, sizeof(imul));
-            code_size += 4;
-        } else {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t imul{ 0x00'00'00'00'00'c0'69'4d | imm << 24 | uint64_t(9 * dst_register) << 16 };
-            std::memcpy(code_buffer + code_size, &imul, sizeof(imul));
-            code_size += 7;
+            InstrTemplate t{};
+            if (dst_register != Displacement_Reg_Idx) {
+                t.put(0x04'8d'4f | sib << 24 | (8 * dst_register) << 16, 4);
+            } else {
+                t.put(0xac'8d'4f | sib << 24, 4);
+                t.putImm(Imm::Imm32, 4);
+            }
+
+            return t;
+        }) };
+
+        // Operation of instruction with memory operand (L1/L2) or with L3 address in imm32 when dst == src.
+        // Index: [dst][dst == src].
+        template<uint32_t Reg_Opcode, uint32_t L3_Opcode>
+        consteval auto makeMemoryOpTemplates() {
+            return makeTemplates<2 * Int_Register_Count>([](const uint32_t i) {
+                const uint32_t dst_register{ i / 2 };
+
+                InstrTemplate t{};
+                if (i % 2 == 0) {
+                    t.put(Reg_Opcode | (8 * dst_register) << 16, 4);
+                } else {
+                    t.put(L3_Opcode | (8 * dst_register) << 16, 3);
+                    t.putImm(Imm::L3_Offset, 4);
+                }
+
+                return t;
+            });
         }
-    }
 
-    void BytecodeCompiler::imulm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const auto imm{ instr.imm32 };
-            const auto mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x0f'4c'00'00'00'00'e1'81 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint32_t mov{ uint32_t(0x00'0e'04'af) | uint32_t(8 * dst_register) << 8 };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                code_size += 19;
+        constexpr auto Iadd_M_Code{ makeMemoryOpTemplates<0x06'04'03'4c, 0x86'03'4c>() }; // add dst, [rsi + rax/imm32]
+        constexpr auto Isub_M_Code{ makeMemoryOpTemplates<0x06'04'2b'4c, 0x86'2b'4c>() }; // sub dst, [rsi + rax/imm32]
+        constexpr auto Ixor_M_Code{ makeMemoryOpTemplates<0x06'04'33'4c, 0x86'33'4c>() }; // xor dst, [rsi + rax/imm32]
+
+        // imul dst, [rsi + rcx/imm32]. Index: [dst][dst == src].
+        constexpr auto Imul_M_Code{ makeTemplates<2 * Int_Register_Count>([](const uint32_t i) {
+            const uint64_t dst_register{ i / 2 };
+
+            InstrTemplate t{};
+            if (i % 2 == 0) {
+                t.put(0x0e'04'af'0f'4c | (8 * dst_register) << 24, 5);
             } else {
-                const uint64_t lea{ 0x00'00'00'00'24'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x4c'00'00'00'00'e1'81'48 | uint64_t(mem_mask) << 24 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint32_t mov{ uint32_t(0x0e'04'af'0f) | uint32_t(8 * dst_register) << 16 };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                code_size += 20;
+                t.put(0x86'af'0f'4c | (8 * dst_register) << 24, 4);
+                t.putImm(Imm::L3_Offset, 4);
             }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
-            const uint64_t imul{ 0x00'00'00'00'86'af'0f'4c | uint64_t(8 * dst_register) << 24 | offset << 32 };
-            std::memcpy(code_buffer + code_size, &imul, sizeof(imul));
-            code_size += 8;
+
+            return t;
+        }) };
+
+        // mov rax, dst; mul/imul qword [rsi + rcx/imm32]; mov dst, rdx. Index: [dst][dst == src].
+        template<uint32_t Reg_Modrm, uint32_t L3_Modrm>
+        consteval auto makeMulhMTemplates() {
+            return makeTemplates<2 * Int_Register_Count>([](const uint32_t i) {
+                const uint64_t dst_register{ i / 2 };
+
+                InstrTemplate t{};
+                t.put(0xf7'48'c0'89'4c | (8 * dst_register) << 16, 5);
+                if (i % 2 == 0) {
+                    t.put(0x0e'00 | Reg_Modrm, 2);
+                } else {
+                    t.put(L3_Modrm, 1);
+                    t.putImm(Imm::L3_Offset, 4);
+                }
+                t.put(0xd0'89'49 | dst_register << 16, 3);
+
+                return t;
+            });
         }
-    }
 
-    void BytecodeCompiler::imulhr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
+        constexpr auto Imulh_M_Code{ makeMulhMTemplates<0x24, 0xa6>() };
+        constexpr auto Ismulh_M_Code{ makeMulhMTemplates<0x2c, 0xae>() };
+
+        // Operation of two registers or of register and imm32 when dst == src. Index: [dst][src].
+        template<uint32_t Reg_Opcode, uint32_t Imm_Opcode>
+        consteval auto makeRegImmTemplates() {
+            return makeTemplates<Int_Register_Count * Int_Register_Count>([](const uint32_t i) {
+                const uint32_t dst_register{ i / 8 }, src_register{ i % 8 };
+
+                InstrTemplate t{};
+                if (dst_register != src_register) {
+                    t.put(Reg_Opcode | (dst_register + 8 * src_register) << 16, 3);
+                } else {
+                    t.put(Imm_Opcode | dst_register << 16, 3);
+                    t.putImm(Imm::Imm32, 4);
+                }
+
+                return t;
+            });
+        }
 
-        const uint64_t imulhr{ 0x89'49'e0'f7'49'c0'89'4c | uint64_t(src_register) << 40 | uint64_t(8 * dst_register) << 16 };
-        std::memcpy(code_buffer + code_size, &imulhr, sizeof(imulhr));
-        const uint8_t mov{ static_cast<uint8_t>(0xd0 + dst_register) };
-        std::memcpy(code_buffer + code_size + 8, &mov, 1);
-        code_size += 9;
+        constexpr auto Isub_R_Code{ makeRegImmTemplates<0xc0'29'4d, 0xe8'81'49>() }; // sub dst, src/imm32
+        constexpr auto Ixor_R_Code{ makeRegImmTemplates<0xc0'31'4d, 0xf0'81'49>() }; // xor dst, src/imm32
 
-    }
+        // imul dst, src/imm32. Index: [dst][src].
+        constexpr auto Imul_R_Code{ makeTemplates<Int_Register_Count * Int_Register_Count>([](const uint32_t i) {
+            const uint32_t dst_register{ i / 8 }, src_register{ i % 8 };
 
-    void BytecodeCompiler::imulhm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x89'4c'00'00'00'00'e1'81 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint64_t mov{ 0xd0'89'49'0e'24'f7'48'c0 | uint64_t(dst_register) << 56 | uint64_t(8 * dst_register) };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                code_size += 24;
+            InstrTemplate t{};
+            if (dst_register != src_register) {
+                t.put(0xc0'af'0f'4d | (8 * dst_register + src_register) << 24, 4);
             } else {
-                const uint64_t lea{ 0x00'00'00'00'24'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x4c'00'00'00'00'e1'81'48 | uint64_t(mem_mask) << 24 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint64_t mov{ 0x89'49'0e'24'f7'48'c0'89 | uint64_t(8 * dst_register) << 8 };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                const uint8_t mov2{ uint8_t(0xd0 + dst_register) };
-                std::memcpy(code_buffer + code_size + 24, &mov2, 1);
-                code_size += 25;
+                t.put(0xc0'69'4d | (9 * dst_register) << 16, 3);
+                t.putImm(Imm::Imm32, 4);
             }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
-            const uint64_t mov{ 0x00'00'a6'f7'48'c0'89'4c | uint64_t(8 * dst_register) << 16 | offset << 48 };
-            std::memcpy(code_buffer + code_size, &mov, sizeof(mov));
-            const uint64_t mulh{ 0x00'00'00'd0'89'49'00'00 | uint64_t(dst_register) << 32 | offset >> 16 };
-            std::memcpy(code_buffer + code_size + 8, &mulh, sizeof(mulh));
-            code_size += 13;
+
+            return t;
+        }) };
+
+        // mov rax, dst; mul/imul src; mov dst, rdx. Index: [dst][src].
+        template<uint64_t Opcode>
+        consteval auto makeMulhRTemplates() {
+            return makeTemplates<Int_Register_Count * Int_Register_Count>([](const uint32_t i) {
+                const uint64_t dst_register{ i / 8 }, src_register{ i % 8 };
+
+                InstrTemplate t{};
+                t.put(Opcode | src_register << 40 | (8 * dst_register) << 16, 8);
+                t.put(0xd0 + dst_register, 1);
+
+                return t;
+            });
         }
-    }
 
-    void BytecodeCompiler::ismulhr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
+        constexpr auto Imulh_R_Code{ makeMulhRTemplates<0x89'49'e0'f7'49'c0'89'4c>() };
+        constexpr auto Ismulh_R_Code{ makeMulhRTemplates<0x89'49'e8'f7'49'c0'89'4c>() };
+
+        // neg dst. Index: [dst].
+        constexpr auto Ineg_R_Code{ makeTemplates<Int_Register_Count>([](const uint32_t dst_register) {
+            InstrTemplate t{};
+            t.put(0xd8'f7'49 | dst_register << 16, 3);
+            return t;
+        }) };
+
+        // mov rcx, src; ror/rol dst, cl or ror/rol dst, imm8 when dst == src.
+        // Index: [dst][src], last template is empty (rotation by 0).
+        template<uint64_t Reg_Opcode, uint32_t Imm_Opcode>
+        consteval auto makeRotateTemplates() {
+            return makeTemplates<Int_Register_Count * Int_Register_Count + 1>([](const uint32_t i) {
+                const uint64_t dst_register{ i / 8 }, src_register{ i % 8 };
+
+                InstrTemplate t{};
+                if (i == Int_Register_Count * Int_Register_Count) {
+                    return t;
+                }
+
+                if (dst_register != src_register) {
+                    t.put(Reg_Opcode | (8 * src_register) << 16 | dst_register << 40, 6);
+                } else {
+                    t.put(Imm_Opcode | dst_register << 16, 3);
+                    t.putImm(Imm::Rotate, 1);
+                }
+
+                return t;
+            });
+        }
 
-        reg_usage[dst_register] = idx;
+        constexpr auto Iror_R_Code{ makeRotateTemplates<0xc8'd3'49'c1'89'4c, 0xc8'c1'49>() };
+        constexpr auto Irol_R_Code{ makeRotateTemplates<0xc0'd3'49'c1'89'4c, 0xc0'c1'49>() };
 
-        const uint64_t imulhr{ 0x89'49'e8'f7'49'c0'89'4c | uint64_t(src_register) << 40 | uint64_t(8 * dst_register) << 16 };
-        std::memcpy(code_buffer + code_size, &imulhr, sizeof(imulhr));
-        const uint8_t mov{ static_cast<uint8_t>(0xd0 + dst_register) };
-        std::memcpy(code_buffer + code_size + 8, &mov, 1);
-        code_size += 9;
-    }
+        // mov rax, imm64; imul dst, rax. Index: [dst].
+        // Reciprocal is 64-bit, so it is patched by the instruction itself.
+        constexpr auto Imul_Rcp_Code{ makeTemplates<Int_Register_Count>([](const uint32_t dst_register) {
+            InstrTemplate t{};
+            t.put(0xb8'48, 2);
+            t.putImm(Imm::None, sizeof(uint64_t));
+            t.put(0xc0'af'0f'4c | uint64_t(8 * dst_register) << 24, 4);
 
-    void BytecodeCompiler::ismulhm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x89'4c'00'00'00'00'e1'81 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint64_t mov{ 0xd0'89'49'0e'2c'f7'48'c0 | uint64_t(dst_register) << 56 | uint64_t(8 * dst_register) };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                code_size += 24;
+            return t;
+        }) };
+
+        // xchg dst, src. Index: [dst][src], templates with dst == src are empty.
+        constexpr auto Iswap_R_Code{ makeTemplates<Int_Register_Count * Int_Register_Count>([](const uint32_t i) {
+            const uint32_t dst_register{ i / 8 }, src_register{ i % 8 };
+
+            InstrTemplate t{};
+            if (dst_register != src_register) {
+                t.put(0xc0'87'4d | (dst_register + 8 * src_register) << 16, 3);
+            }
+
+            return t;
+        }) };
+
+        // add dst, imm32; test dst, mask; jz target. Index: [dst][near jump].
+        // Immediate is computed by the instruction, mask and jump offset are patched by it at fixed offsets.
+        constexpr uint32_t Cbranch_Mask_Offset{ 10 };
+        constexpr uint32_t Cbranch_Short_Jump_Offset{ 15 };
+        constexpr uint32_t Cbranch_Near_Jump_Offset{ 16 };
+        constexpr auto Cbranch_Code{ makeTemplates<2 * Int_Register_Count>([](const uint32_t i) {
+            const uint32_t dst_register{ i / 2 };
+
+            InstrTemplate t{};
+            t.put(0xc0'81'49 | dst_register << 16, 3);
+            t.putImm(Imm::Imm32, 4);
+            t.put(0xc0'f7'49 | dst_register << 16, 3);
+            t.put(0, sizeof(uint32_t));
+            if (i % 2 == 0) {
+                t.put(0x74, 1);
+                t.put(0, sizeof(int8_t));
             } else {
-                const uint64_t lea{ 0x00'00'00'00'24'88'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x4c'00'00'00'00'e1'81'48 | uint64_t(mem_mask) << 24 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint64_t mov{ 0x89'49'0e'2c'f7'48'c0'89 | uint64_t(8 * dst_register) << 8 };
-                std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-                const uint8_t mov2{ uint8_t(0xd0 + dst_register) };
-                std::memcpy(code_buffer + code_size + 24, &mov2, 1);
-                code_size += 25;
+                t.put(0x84'0f, 2);
+                t.put(0, sizeof(int32_t));
             }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
 
-            const uint64_t mov{ 0x00'00'ae'f7'48'c0'89'4c | uint64_t(8 * dst_register) << 16 | offset << 48 };
-            std::memcpy(code_buffer + code_size, &mov, sizeof(mov));
-            const uint64_t mulh{ 0x00'00'00'd0'89'49'00'00 | uint64_t(dst_register) << 32 | offset >> 16 };
-            std::memcpy(code_buffer + code_size + 8, &mulh, sizeof(mulh));
-            code_size += 13;
+            return t;
+        }) };
+
+        // vshufpd f/e, f/e, f/e, 1. Index: [dst].
+        constexpr auto Fswap_R_Code{ makeTemplates<Int_Register_Count>([](const uint64_t dst_register) {
+            InstrTemplate t{};
+            t.put(0x01'c0'c6'c1'c5 | (56 - 8 * dst_register) << 8 | (9 * dst_register) << 24, 5);
+            return t;
+        }) };
+
+        // vaddpd f, f, a. Index: [dst][src].
+        constexpr auto Fadd_R_Code{ makeTemplates<Float_Register_Count * Float_Register_Count>([](const uint32_t i) {
+            const uint32_t dst_register{ i / 4 }, src_register{ i % 4 };
+
+            InstrTemplate t{};
+            t.put(0xc0'58'a1'c5 | (24 - 8 * src_register) << 8 | (9 * dst_register) << 24, 4);
+            return t;
+        }) };
+
+        // vsubpd f, f, a. Index: [dst][src].
+        constexpr auto Fsub_R_Code{ makeTemplates<Float_Register_Count * Float_Register_Count>([](const uint32_t i) {
+            const uint64_t dst_register{ i / 4 }, src_register{ i % 4 };
+
+            InstrTemplate t{};
+            t.put(0xc0'5c'61'c1'c4 | (24 - 8 * dst_register) << 16 | (8 * dst_register + src_register) << 32, 5);
+            return t;
+        }) };
+
+        // vmulpd e, e, a. Index: [dst][src].
+        constexpr auto Fmul_R_Code{ makeTemplates<Float_Register_Count * Float_Register_Count>([](const uint32_t i) {
+            const uint32_t dst_register{ i / 4 }, src_register{ i % 4 };
+
+            InstrTemplate t{};
+            t.put(0xe4'59'81'c5 | (56 - 8 * src_register) << 8 | (9 * dst_register) << 24, 4);
+            return t;
+        }) };
+
+        // xorps f, [scale mask]. Index: [dst].
+        constexpr auto Fscal_R_Code{ makeTemplates<Float_Register_Count>([](const uint32_t dst_register) {
+            InstrTemplate t{};
+            t.put(0xc6'57'0f'41 | (8 * dst_register) << 24, 4);
+            return t;
+        }) };
+
+        // vsqrtpd e, e. Index: [dst].
+        constexpr auto Fsqrt_R_Code{ makeTemplates<Float_Register_Count>([](const uint32_t dst_register) {
+            InstrTemplate t{};
+            t.put(0xe4'51'f9'c5 | (9 * dst_register) << 24, 4);
+            return t;
+        }) };
+
+        // vcvtdq2pd xmm12, [rsi + rax]; vaddpd f, f, xmm12. Index: [dst].
+        constexpr auto Fadd_M_Code{ makeTemplates<Float_Register_Count>([](const uint32_t dst_register) {
+            InstrTemplate t{};
+            t.put(0x58'99'c5'06'24'e6'7a'c5, 8);
+            t.put(0xc0 | 9 * dst_register, 1);
+            return t;
+        }) };
+
+        // vcvtdq2pd xmm12, [rsi + rax]; vsubpd f, f, xmm12. Index: [dst].
+        constexpr auto Fsub_M_Code{ makeTemplates<Float_Register_Count>([](const uint64_t dst_register) {
+            InstrTemplate t{};
+            t.put(0x61'c1'c4'06'24'e6'7a'c5 | (24 - 8 * dst_register) << 56, 8);
+            t.put(0xc4'5c | (8 * dst_register) << 8, 2);
+            return t;
+        }) };
+
+        // vcvtdq2pd xmm12, [rsi + rax]; andps xmm12, and mask; orps xmm12, or mask; vdivpd e, e, xmm12. Index: [dst].
+        constexpr auto Fdiv_M_Code{ makeTemplates<Float_Register_Count>([](const uint64_t dst_register) {
+            InstrTemplate t{};
+            t.put(0x54'0f'45'06'24'e6'7a'c5, 8);
+            t.put(0x41'c1'c4'e5'56'0f'45'e7 | (24 - 8 * dst_register) << 56, 8);
+            t.put(0xe4'5e | (8 * dst_register) << 8, 2);
+            return t;
+        }) };
+
+        // mov rax, src; ror rax, imm8; and eax, 3; ldmxcsr [rsi + rax * 4 - 16]. Index: [src][imm32 % 64 != 0].
+        constexpr auto Cfround_Code{ makeTemplates<2 * Int_Register_Count>([](const uint32_t i) {
+            const uint64_t src_register{ i / 2 };
+
+            InstrTemplate t{};
+            t.put(0xc0'89'4c | (8 * src_register) << 16, 3);
+            if (i % 2 != 0) {
+                t.put(0xc8'c1'48, 3);
+                t.putImm(Imm::Rotate, 1);
+            }
+            t.put(0x03'e0'83'48, 4);
+            t.put(0xf0'86'54'ae'0f, 5);
+
+            return t;
+        }) };
+
+        // mov [rsi + rax], src. Index: [src].
+        constexpr auto Istore_Code{ makeTemplates<Int_Register_Count>([](const uint32_t src_register) {
+            InstrTemplate t{};
+            t.put(0x06'04'89'4c | (8 * src_register) << 16, 4);
+            return t;
+        }) };
+
+        // Returns scratchpad level (L1 or L2) read by memory operand of given instruction.
+        [[nodiscard]] uint32_t scratchpadLevel(const RxInstruction& instr) noexcept {
+            return instr.modMask() ? Scratchpad_L1 : Scratchpad_L2;
         }
-    }
 
-    void BytecodeCompiler::inegr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        reg_usage[dst_register] = idx;
-        const uint32_t neg{ 0x00'd8'f7'49 | uint32_t(dst_register) << 16 };
-        std::memcpy(code_buffer + code_size, &neg, sizeof(neg));
-        code_size += 3;
-    }
+        // Program buffer size assumes that no instruction (including its padding) is longer than this.
+        constexpr uint32_t Max_Instruction_Size{ 32 };
+
+        // Recommended multi-byte NOP sequences for 1 to 9 bytes (Intel SDM vol. 2B, NOP instruction).
+        constexpr std::array<std::array<uint8_t, 9>, 9> Nops{ {
+            { 0x90 },
+            { 0x66, 0x90 },
+            { 0x0f, 0x1f, 0x00 },
+            { 0x0f, 0x1f, 0x40, 0x00 },
+            { 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+            { 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+            { 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00 },
+            { 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+            { 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        } };
+
+        // Effects of instruction that whole-program analysis has to track.
+        enum InstrEffect : uint8_t {
+            Writes_Dst = 1, // Always modifies destination integer register.
+            Uses_Rounding = 2, // Result depends on rounding mode.
+            Special = 4, // Effect depends on operands or program state (IMUL_RCP, ISWAP_R, CBRANCH, CFROUND).
+        };
+
+        constexpr uint32_t Bytecode_Count{ static_cast<uint32_t>(Bytecode::ISTORE) + 1 };
+
+        // Holds effects of instruction for given bytecode (array index is equal bytecode).
+        // Opcodes in programs are random, so analysis driven by this table avoids per-instruction branch mispredictions of a switch over bytecodes.
+        // Padded to 64 entries to be looked up with single vpermb.
+        constexpr alignas(64) std::array<uint8_t, 64> Bytecode_Effects = []() consteval {
+            std::array<uint8_t, 64> table{};
+
+            for (uint32_t bytecode = 0; bytecode < Bytecode_Count; ++bytecode) {
+                switch (static_cast<Bytecode>(bytecode)) { using enum Bytecode;
+                case IADD_RS: case IADD_M: case ISUB_R: case ISUB_M: case IMUL_R: case IMUL_M: case IMULH_R: case IMULH_M:
+                case ISMULH_R: case ISMULH_M: case INEG_R: case IXOR_R: case IXOR_M: case IROR_R: case IROL_R:
+                    table[bytecode] = Writes_Dst; // Set even for rotate == 0.
+                    break;
+                case FADD_R: case FADD_M: case FSUB_R: case FSUB_M: case FMUL_R: case FDIV_M: case FSQRT_R:
+                    table[bytecode] = Uses_Rounding;
+                    break;
+                case IMUL_RCP: case ISWAP_R: case CBRANCH: case CFROUND:
+                    table[bytecode] = Special;
+                    break;
+                default:
+                    break;
+                }
+            }
 
-    void BytecodeCompiler::ixorr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        reg_usage[dst_register] = idx;
+            return table;
+        }();
 
-        if (dst_register != src_register) {
-            const uint32_t xor_{ 0x00'c0'31'4d | uint32_t(dst_register + 8 * src_register) << 16 };
-            std::memcpy(code_buffer + code_size, &xor_, sizeof(xor_));
-            code_size += 3;
-        } else {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t xor_{ 0x00'00'00'00'00'f0'81'49 | uint64_t(dst_register) << 16 | imm << 24 };
-            std::memcpy(code_buffer + code_size, &xor_, sizeof(xor_));
-            code_size += 7;
-        }
-    }
+        // Holds effects of instruction for given opcode (array index is equal opcode). Used by scalar decoding.
+        constexpr alignas(64) std::array<uint8_t, 256> LUT_Opcode_Effects = []() consteval {
+            std::array<uint8_t, 256> table{};
 
-    void BytecodeCompiler::ixorm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t imm{ instr.imm32 };
-            const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-
-            if (src_register != Sib_Reg_Idx) {
-                const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x04'33'4c'00'00'00'00'25 | uint64_t(mem_mask) << 8 | uint64_t(8 * dst_register) << 56 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint8_t mov{ static_cast<uint8_t>(0x06) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 1);
-                code_size += 17;
-            } else {
-                const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-                std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-                const uint64_t and_{ 0x33'4c'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-                std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-                const uint16_t mov{ static_cast<uint16_t>(0x06'04 | uint16_t(8 * dst_register)) };
-                std::memcpy(code_buffer + code_size + 16, &mov, 2);
-                code_size += 18;
+            for (uint32_t opcode = 0; opcode < table.size(); ++opcode) {
+                table[opcode] = Bytecode_Effects[static_cast<uint8_t>(LUT_Opcode[opcode])];
             }
-        } else {
-            const uint64_t offset{ instr.imm32 & Scratchpad_L3_Mask };
-            const uint64_t xor_{ 0x00'00'00'00'00'86'33'4c | uint64_t(8 * dst_register) << 16 | offset << 24 };
-            std::memcpy(code_buffer + code_size, &xor_, sizeof(xor_));
-            code_size += 7;
-        }
-    }
 
-    void BytecodeCompiler::irorr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-
-        // Set even for rotate == 0.
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t ror{ 0x00'00'c8'd3'49'c1'89'4c | uint64_t(8 * src_register) << 16 | uint64_t(dst_register) << 40 };
-            std::memcpy(code_buffer + code_size, &ror, sizeof(ror));
-            code_size += 6;
-        } else if (const uint32_t imm = instr.imm32 % 64; imm != 0) {
-            const uint32_t ror{ 0x00'c8'c1'49 | uint32_t(dst_register) << 16 | imm << 24 };
-            std::memcpy(code_buffer + code_size, &ror, sizeof(ror));
-            code_size += 4;
-        }
-    }
+            return table;
+        }();
+
+        // Opcodes of the same bytecode form contiguous ranges (see LUT_Opcode), so without AVX512-VBMI bytecode is decoded with 16-byte lookups (vpshufb):
+        // range of opcode is the range holding first opcode of its 16-opcode block (looked up by high nibble),
+        // advanced by every range that starts inside the block at or below opcode (low nibble compared with range starts looked up by high nibble).
+        struct NibbleDecodeTables {
+            static constexpr uint32_t Max_Range_Starts{ 5 }; // Ranges starting inside single 16-opcode block, not counting its first opcode.
+
+            alignas(16) std::array<uint8_t, 16> range_base{}; // Index: high nibble.
+            alignas(16) std::array<std::array<uint8_t, 16>, Max_Range_Starts> range_starts{}; // Low nibble of range start minus 1, or 15. Index: [k-th start][high nibble].
+            alignas(16) std::array<uint8_t, 32> range_bytecode{}; // Index: range.
+            alignas(16) std::array<uint8_t, 32> range_effects{}; // Index: range.
+        };
+
+        constexpr NibbleDecodeTables Nibble_Decode = []() consteval {
+            NibbleDecodeTables tables{};
+            for (auto& starts : tables.range_starts) {
+                starts.fill(15);
+            }
 
-    void BytecodeCompiler::irolr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        // Set even for rotate == 0.
-        reg_usage[dst_register] = idx;
-
-        if (dst_register != src_register) {
-            const uint64_t rol{ 0x00'00'c0'd3'49'c1'89'4c | uint64_t(8 * src_register) << 16 | uint64_t(dst_register) << 40 };
-            std::memcpy(code_buffer + code_size, &rol, sizeof(rol));
-            code_size += 6;
-        } else if (const uint32_t imm = instr.imm32 % 64; imm != 0) {
-            const uint32_t rol{ 0x00'c0'c1'49 | uint32_t(dst_register) << 16 | imm << 24 };
-            std::memcpy(code_buffer + code_size, &rol, sizeof(rol));
-            code_size += 4;
-        }
-    }
+            uint32_t range{ 0 };
+            uint32_t block_starts{ 0 };
+            for (uint32_t opcode = 0; opcode < LUT_Opcode.size(); ++opcode) {
+                const bool range_start{ opcode > 0 && LUT_Opcode[opcode] != LUT_Opcode[opcode - 1] };
+                range += range_start;
+
+                if (opcode % 16 == 0) {
+                    tables.range_base[opcode / 16] = static_cast<uint8_t>(range);
+                    block_starts = 0;
+                } else if (range_start) {
+                    // at() fails compilation if tables are too small for LUT_Opcode.
+                    tables.range_starts.at(block_starts++)[opcode / 16] = static_cast<uint8_t>(opcode % 16 - 1);
+                }
+
+                tables.range_bytecode.at(range) = static_cast<uint8_t>(LUT_Opcode[opcode]);
+                tables.range_effects.at(range) = Bytecode_Effects[static_cast<uint8_t>(LUT_Opcode[opcode])];
+            }
 
-    void BytecodeCompiler::imulrcp_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        if (const uint32_t imm = instr.imm32; imm != 0 && !std::has_single_bit(imm)) {
-            const uint8_t dst_register{ instr.dst_register };
-            reg_usage[dst_register] = idx;
-            const auto rcp{ reciprocal(imm) };
-
-            const uint64_t mov{ 0x00'00'00'00'00'00'b8'48 | rcp << 16 };
-            std::memcpy(code_buffer + code_size, &mov, sizeof(mov));
-            const uint64_t imul{ 0x00'00'c0'af'0f'4c'00'00 | rcp >> 48 | uint64_t(8 * dst_register) << 40 };
-            std::memcpy(code_buffer + code_size + 8, &imul, sizeof(imul));
-            code_size += 14;
-        }
-    }
+            return tables;
+        }();
 
-    void BytecodeCompiler::iswapr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
+        // vpshufb masks that move opcodes (bytes 0 and 8 of every lane) of j-th 32-byte load into bytes 2j and 2j + 1 of every lane.
+        constexpr alignas(32) std::array<std::array<uint8_t, 32>, 8> Opcode_Gather_Avx2 = []() consteval {
+            std::array<std::array<uint8_t, 32>, 8> masks{};
 
-        if (src_register != dst_register) {
-            reg_usage[src_register] = idx;
-            reg_usage[dst_register] = idx;
+            for (uint32_t j = 0; j < masks.size(); ++j) {
+                masks[j].fill(0x80);
+                for (uint32_t lane = 0; lane < 2; ++lane) {
+                    masks[j][16 * lane + 2 * j] = 0;
+                    masks[j][16 * lane + 2 * j + 1] = 8;
+                }
+            }
 
-            const uint32_t xchg{ 0x00'c0'87'4d | uint32_t(dst_register + 8 * src_register) << 16 };
-            std::memcpy(code_buffer + code_size, &xchg, sizeof(xchg));
-            code_size += 3;
-        }
-    }
+            return masks;
+        }();
 
-    void BytecodeCompiler::cbranch_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
+        // Puts gathered opcodes in program order, after their 64-bit parts are reordered with vpermq.
+        constexpr alignas(32) std::array<uint8_t, 32> Opcode_Order_Avx2{
+            0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+            0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+        };
 
-        constexpr uint32_t Condition_Mask{ (1 << Rx_Jump_Bits) - 1 };
-        const auto shift{ instr.modCond() + Rx_Jump_Offset };
-        const auto mem_mask{ Condition_Mask << shift };
+        // vpermb indexes that move opcode of every instruction in 64-byte load (8 instructions) into consecutive bytes. Repeated for 8 loads.
+        constexpr alignas(64) std::array<uint8_t, 64> Opcode_Gather_Vbmi = []() consteval {
+            std::array<uint8_t, 64> indexes{};
 
-        static_assert(Rx_Jump_Offset > 0, "Below simplification requires this assertion");
-        uint32_t imm{ instr.imm32 | (1 << shift) };
-        imm &= ~(1ULL << (shift - 1)); // Clear the bit below the condition mask - this limits the number of successive jumps to 2.
+            for (uint32_t i = 0; i < indexes.size(); ++i) {
+                indexes[i] = static_cast<uint8_t>(8 * (i % 8));
+            }
 
-        const auto jmp_target{ reg_usage[dst_register] + 1 };
-        if (jmp_target <= last_fp_instr) {
-            last_fp_instr = idx;
-        }
+            return indexes;
+        }();
 
-        int32_t jmp_offset{ instr_offset[jmp_target] - instr_offset[idx] - 16 };
+        const bool Vbmi_Supported{ CPUInfo::AVX512VBMI() && CPUInfo::AVX512BW() };
+        const bool Avx2_Supported{ CPUInfo::AVX2() };
 
-        for (int i = 0; i < Int_Register_Count; ++i) {
-            reg_usage[i] = idx; // Set all registers as used.
+        // Returns 16-byte table broadcasted to both lanes.
+        [[nodiscard]] __m256i broadcastTable(const uint8_t* table) noexcept {
+            return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
         }
 
-        const uint64_t add{ 0x49'00'00'00'00'c0'81'49 | uint64_t(dst_register) << 16 | uint64_t(imm) << 24 };
-        std::memcpy(code_buffer + code_size, &add, sizeof(add));
+        // Decodes 64 instructions per iteration. Bytecode is looked up in whole LUT_Opcode (4 registers) with two vpermi2b.
+        void decodeVbmi(const RxProgram& program, uint8_t* const bytecodes, uint8_t* const effects) noexcept {
+            const auto* instructions{ reinterpret_cast<const __m512i*>(program.instructions.data()) };
+            const auto* lut{ reinterpret_cast<const __m512i*>(LUT_Opcode.data()) };
+            const __m512i lut0{ _mm512_load_si512(lut) };
+            const __m512i lut1{ _mm512_load_si512(lut + 1) };
+            const __m512i lut2{ _mm512_load_si512(lut + 2) };
+            const __m512i lut3{ _mm512_load_si512(lut + 3) };
+            const __m512i effects_lut{ _mm512_load_si512(Bytecode_Effects.data()) };
+            const __m512i gather{ _mm512_load_si512(Opcode_Gather_Vbmi.data()) };
+
+            for (uint32_t i = 0; i < Rx_Program_Size; i += 64) {
+                __m512i opcodes{ _mm512_setzero_si512() };
+                for (uint32_t j = 0; j < 8; ++j) {
+                    opcodes = _mm512_mask_permutexvar_epi8(opcodes, __mmask64{ 0xff } << (8 * j), gather, _mm512_loadu_si512(instructions + i / 8 + j));
+                }
+
+                // Highest bit of opcode selects between lower and upper half of LUT_Opcode.
+                const __m512i lower{ _mm512_permutex2var_epi8(lut0, opcodes, lut1) };
+                const __m512i upper{ _mm512_permutex2var_epi8(lut2, opcodes, lut3) };
+                const __m512i bytecode{ _mm512_mask_blend_epi8(_mm512_movepi8_mask(opcodes), lower, upper) };
+
+                _mm512_storeu_si512(bytecodes + i, bytecode);
+                _mm512_storeu_si512(effects + i, _mm512_permutexvar_epi8(bytecode, effects_lut));
+            }
+        }
 
-        if (jmp_offset >= -128) {
-            const uint64_t test{ 0x00'74'00'00'00'00'c0'f7 | uint64_t(dst_register) << 8 | uint64_t(mem_mask) << 16 | int64_t(jmp_offset) << 56 };
-            std::memcpy(code_buffer + code_size + 8, &test, sizeof(test));
-            code_size += 16;
-        } else {
-            jmp_offset -= 4;
-            const uint64_t test{ 0x84'0f'00'00'00'00'c0'f7 | uint64_t(dst_register) << 8 | uint64_t(mem_mask) << 16 };
-            std::memcpy(code_buffer + code_size + 8, &test, sizeof(test));
-            std::memcpy(code_buffer + code_size + 16, &jmp_offset, sizeof(jmp_offset));
-            code_size += 20;
+        // Decodes 32 instructions per iteration with nibble decoding (see NibbleDecodeTables).
+        void decodeAvx2(const RxProgram& program, uint8_t* const bytecodes, uint8_t* const effects) noexcept {
+            const auto* instructions{ reinterpret_cast<const __m256i*>(program.instructions.data()) };
+            const auto* gather{ reinterpret_cast<const __m256i*>(Opcode_Gather_Avx2.data()) };
+            const __m256i order{ _mm256_load_si256(reinterpret_cast<const __m256i*>(Opcode_Order_Avx2.data())) };
+            const __m256i nibble_mask{ _mm256_set1_epi8(0x0f) };
+            const __m256i upper_ranges{ _mm256_set1_epi8(15) };
+            const __m256i range_base{ broadcastTable(Nibble_Decode.range_base.data()) };
+            const __m256i bytecode_lo{ broadcastTable(Nibble_Decode.range_bytecode.data()) };
+            const __m256i bytecode_hi{ broadcastTable(Nibble_Decode.range_bytecode.data() + 16) };
+            const __m256i effects_lo{ broadcastTable(Nibble_Decode.range_effects.data()) };
+            const __m256i effects_hi{ broadcastTable(Nibble_Decode.range_effects.data() + 16) };
+
+            for (uint32_t i = 0; i < Rx_Program_Size; i += 32) {
+                // Every 32-byte load holds 4 instructions, 2 per lane.
+                __m256i opcodes{ _mm256_setzero_si256() };
+                for (uint32_t j = 0; j < 8; ++j) {
+                    const __m256i x{ _mm256_loadu_si256(instructions + i / 4 + j) };
+                    opcodes = _mm256_or_si256(opcodes, _mm256_shuffle_epi8(x, _mm256_load_si256(gather + j)));
+                }
+                opcodes = _mm256_shuffle_epi8(_mm256_permute4x64_epi64(opcodes, 0b11'01'10'00), order);
+
+                const __m256i lo{ _mm256_and_si256(opcodes, nibble_mask) };
+                const __m256i hi{ _mm256_and_si256(_mm256_srli_epi16(opcodes, 4), nibble_mask) };
+
+                __m256i range{ _mm256_shuffle_epi8(range_base, hi) };
+                for (const auto& starts : Nibble_Decode.range_starts) {
+                    const __m256i threshold{ _mm256_shuffle_epi8(broadcastTable(starts.data()), hi) };
+                    range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(lo, threshold)); // Comparison gives -1 when range starts at or below opcode.
+                }
+
+                const __m256i upper{ _mm256_cmpgt_epi8(range, upper_ranges) };
+                const __m256i bytecode{ _mm256_blendv_epi8(_mm256_shuffle_epi8(bytecode_lo, range), _mm256_shuffle_epi8(bytecode_hi, range), upper) };
+                const __m256i effect{ _mm256_blendv_epi8(_mm256_shuffle_epi8(effects_lo, range), _mm256_shuffle_epi8(effects_hi, range), upper) };
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(bytecodes + i), bytecode);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(effects + i), effect);
+            }
         }
-    }
 
-    void BytecodeCompiler::fswapr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register };
-        const uint64_t vshufpd{ 0x00'00'00'01'c0'c6'c1'c5 | uint64_t(56 - 8 * dst_register) << 8 | uint64_t(9 * dst_register) << 24 };
-        std::memcpy(code_buffer + code_size, &vshufpd, sizeof(vshufpd));
-        code_size += 5;
-    }
+        void decodeScalar(const RxProgram& program, uint8_t* const bytecodes, uint8_t* const effects) noexcept {
+            for (uint32_t i = 0; i < Rx_Program_Size; ++i) {
+                const uint8_t opcode{ program.instructions[i].opcode };
+                bytecodes[i] = static_cast<uint8_t>(LUT_Opcode[opcode]);
+                effects[i] = LUT_Opcode_Effects[opcode];
+            }
+        }
 
-    void BytecodeCompiler::faddr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register % Float_Register_Count };
-        const uint8_t src_register{ instr.src_register % Float_Register_Count };
-        const uint32_t vaddpd{ 0xc0'58'a1'c5 | uint32_t(24 - 8 * src_register) << 8 | uint32_t(9 * dst_register) << 24 };
-        std::memcpy(code_buffer + code_size, &vaddpd, sizeof(vaddpd));
-        code_size += 4;
+        constexpr uint32_t L3_Store_Condition{ 14 }; // ISTORE writes to L3 scratchpad when modCond() is at least this.
+
+        // Describes how to compile instruction of given bytecode without branches: template of operation is
+        // op_code[dst * dst_scale + src * src_scale + (dst == src) * same_scale + modShift() * shift_scale], registers masked by reg_mask.
+        // It is preceded by memory operand (empty template if there is none). Instructions that need more than that are compiled by special handler.
+        struct InstrEncoding {
+            const InstrTemplate* op_code{ nullptr };
+            uint8_t reg_mask{ 0 };
+            uint8_t dst_scale{ 0 };
+            uint8_t src_scale{ 0 };
+            uint8_t same_scale{ 0 };
+            uint8_t shift_scale{ 0 };
+            bool rotate{ false }; // Rotation by 0 of register by itself compiles to empty template at index 64.
+            bool memory{ false }; // Has memory operand with src register as base.
+            bool memory_unless_same{ false }; // Memory operand is skipped when dst == src (L3 address is part of operation's template then).
+            bool store{ false }; // Memory operand has dst register as base and may address L3 scratchpad.
+            AddressRegister addr{ AddressRegister::RAX };
+            InstrCmpl special{ nullptr };
+        };
+
+        // Holds encoding of instruction for given bytecode (array index is equal bytecode).
+        constexpr std::array<InstrEncoding, Bytecode_Count> Instr_Encodings = []() consteval {
+            std::array<InstrEncoding, Bytecode_Count> table{};
+            constexpr uint8_t Int_Mask{ Int_Register_Count - 1 };
+            constexpr uint8_t Float_Mask{ Float_Register_Count - 1 };
+
+            // Integer instructions with memory operand: templates indexed by [2 * dst + (dst == src)].
+            const auto memory_op = [](const InstrTemplate* op_code, const AddressRegister addr) {
+                return InstrEncoding{ .op_code = op_code, .reg_mask = Int_Mask, .dst_scale = 2, .same_scale = 1, .memory = true, .memory_unless_same = true, .addr = addr };
+            };
+            const auto register_op = [](const InstrTemplate* op_code) {
+                return InstrEncoding{ .op_code = op_code, .reg_mask = Int_Mask, .dst_scale = 8, .src_scale = 1 };
+            };
+            const auto float_op = [](const InstrTemplate* op_code) {
+                return InstrEncoding{ .op_code = op_code, .reg_mask = Float_Mask, .dst_scale = 4, .src_scale = 1 };
+            };
+            const auto float_memory_op = [](const InstrTemplate* op_code) {
+                return InstrEncoding{ .op_code = op_code, .reg_mask = Float_Mask, .dst_scale = 1, .memory = true };
+            };
+
+            for (uint32_t bytecode = 0; bytecode < Bytecode_Count; ++bytecode) {
+                auto& encoding{ table[bytecode] };
+
+                switch (static_cast<Bytecode>(bytecode)) { using enum Bytecode;
+                case IADD_RS:
+                    encoding = { .op_code = Iadd_Rs_Code.data(), .reg_mask = Int_Mask, .dst_scale = 8, .src_scale = 1, .shift_scale = 64 };
+                    break;
+                case IADD_M: encoding = memory_op(Iadd_M_Code.data(), AddressRegister::RAX); break;
+                case ISUB_M: encoding = memory_op(Isub_M_Code.data(), AddressRegister::RAX); break;
+                case IXOR_M: encoding = memory_op(Ixor_M_Code.data(), AddressRegister::RAX); break;
+                case IMUL_M: encoding = memory_op(Imul_M_Code.data(), AddressRegister::RCX); break;
+                case IMULH_M: encoding = memory_op(Imulh_M_Code.data(), AddressRegister::RCX); break;
+                case ISMULH_M: encoding = memory_op(Ismulh_M_Code.data(), AddressRegister::RCX); break;
+                case ISUB_R: encoding = register_op(Isub_R_Code.data()); break;
+                case IXOR_R: encoding = register_op(Ixor_R_Code.data()); break;
+                case IMUL_R: encoding = register_op(Imul_R_Code.data()); break;
+                case IMULH_R: encoding = register_op(Imulh_R_Code.data()); break;
+                case ISMULH_R: encoding = register_op(Ismulh_R_Code.data()); break;
+                case ISWAP_R: encoding = register_op(Iswap_R_Code.data()); break;
+                case IROR_R:
+                    encoding = register_op(Iror_R_Code.data());
+                    encoding.rotate = true;
+                    break;
+                case IROL_R:
+                    encoding = register_op(Irol_R_Code.data());
+                    encoding.rotate = true;
+                    break;
+                case INEG_R: encoding = { .op_code = Ineg_R_Code.data(), .reg_mask = Int_Mask, .dst_scale = 1 }; break;
+                case FSWAP_R: encoding = { .op_code = Fswap_R_Code.data(), .reg_mask = Int_Mask, .dst_scale = 1 }; break;
+                case FADD_R: encoding = float_op(Fadd_R_Code.data()); break;
+                case FSUB_R: encoding = float_op(Fsub_R_Code.data()); break;
+                case FMUL_R: encoding = float_op(Fmul_R_Code.data()); break;
+                case FSCAL_R: encoding = { .op_code = Fscal_R_Code.data(), .reg_mask = Float_Mask, .dst_scale = 1 }; break;
+                case FSQRT_R: encoding = { .op_code = Fsqrt_R_Code.data(), .reg_mask = Float_Mask, .dst_scale = 1 }; break;
+                case FADD_M: encoding = float_memory_op(Fadd_M_Code.data()); break;
+                case FSUB_M: encoding = float_memory_op(Fsub_M_Code.data()); break;
+                case FDIV_M: encoding = float_memory_op(Fdiv_M_Code.data()); break;
+                case ISTORE:
+                    encoding = { .op_code = Istore_Code.data(), .reg_mask = Int_Mask, .src_scale = 1, .memory = true, .store = true };
+                    break;
+                case IMUL_RCP: encoding.special = &BytecodeCompiler::imulrcp_cmpl; break;
+                case CBRANCH: encoding.special = &BytecodeCompiler::cbranch_cmpl; break;
+                case CFROUND: encoding.special = &BytecodeCompiler::cfround_cmpl; break;
+                }
+            }
 
-        last_fp_instr = idx;
+            return table;
+        }();
     }
 
-    void BytecodeCompiler::faddm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t src_register{ instr.src_register };
-        const uint8_t f_dst_register{ instr.dst_register % Float_Register_Count };
-        const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-        const uint64_t imm{ instr.imm32 };
-
-        if (src_register != Sib_Reg_Idx) {
-            const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0xe6'7a'c5'00'00'00'00'25 | uint64_t(mem_mask) << 8 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t mov{ 0x00'00'c0'58'99'c5'06'24 | uint64_t(9 * f_dst_register) << 40 };
-            std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-            code_size += 22;
-        } else {
-            const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0x7a'c5'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t mov{ 0x00'c0'58'99'c5'06'24'e6 | uint64_t(9 * f_dst_register) << 48 };
-            std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-            code_size += 23;
-        }
-
-        last_fp_instr = idx;
+    CodeLayoutPolicy CodeLayoutPolicy::detect() noexcept {
+        return CodeLayoutPolicy{
+            .jcc_erratum_padding = CPUInfo::JCCErratum(),
+        };
     }
 
-    void BytecodeCompiler::fsubr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register % Float_Register_Count };
-        const uint8_t src_register{ instr.src_register % Float_Register_Count };
-        const uint64_t vsubpd{ 0x00'00'00'c0'5c'61'c1'c4 | uint64_t(24 - 8 * dst_register) << 16 | uint64_t(8 * dst_register + src_register) << 32 };
-        std::memcpy(code_buffer + code_size, &vsubpd, sizeof(vsubpd));
-        code_size += 5;
-
-        last_fp_instr = idx;
-    }
+    uint32_t CodeLayoutPolicy::jumpPadding(const uint32_t offset, const uint32_t size) const noexcept {
+        constexpr uint32_t Boundary{ 32 };
 
-    void BytecodeCompiler::fsubm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t src_register{ instr.src_register };
-        const uint8_t f_dst_register{ instr.dst_register % Float_Register_Count };
-        const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-        const uint64_t imm{ instr.imm32 };
-
-        if (src_register != Sib_Reg_Idx) {
-            const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0xe6'7a'c5'00'00'00'00'25 | uint64_t(mem_mask) << 8 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t mov{ 0x00'c4'5c'61'c1'c4'06'24 | uint64_t(8 * f_dst_register) << 48 | uint64_t(24 - 8 * f_dst_register) << 32 };
-            std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-            code_size += 23;
-        } else {
-            const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0x7a'c5'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t mov{ 0xc4'5c'61'c1'c4'06'24'e6 | uint64_t(8 * f_dst_register) << 56 | uint64_t(24 - 8 * f_dst_register) << 40 };
-            std::memcpy(code_buffer + code_size + 16, &mov, sizeof(mov));
-            code_size += 24;
+        // Jump ends on boundary if next instruction starts in next 32-byte block.
+        if (!jcc_erratum_padding || offset / Boundary == (offset + size) / Boundary) {
+            return 0;
         }
 
-        last_fp_instr = idx;
+        return Boundary - offset % Boundary;
     }
 
-    void BytecodeCompiler::fscalr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register % Float_Register_Count };
-        const uint32_t xorps{ 0xc6'57'0f'41 | uint32_t(8 * dst_register) << 24 };
-        std::memcpy(code_buffer + code_size, &xorps, sizeof(xorps));
-        code_size += 4;
+    void BytecodeCompiler::emitNops(uint32_t size) noexcept {
+        while (size > 0) {
+            const uint32_t nop_size{ std::min<uint32_t>(size, Nops.size()) };
+            std::memcpy(code_buffer + code_size, Nops[nop_size - 1].data(), nop_size);
+            code_size += nop_size;
+            size -= nop_size;
+        }
     }
 
-    void BytecodeCompiler::fmulr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register % Float_Register_Count };
-        const uint8_t src_register{ instr.src_register % Float_Register_Count };
-        const uint32_t vmulpd{ 0xe4'59'81'c5 | uint32_t(56 - 8 * src_register) << 8 | uint32_t(9 * dst_register) << 24 };
-        std::memcpy(code_buffer + code_size, &vmulpd, sizeof(vmulpd));
-        code_size += 4;
+    void BytecodeCompiler::decode(const RxProgram& program) noexcept {
+        auto* const bytecodes_ptr{ reinterpret_cast<uint8_t*>(bytecodes.data()) };
 
-        last_fp_instr = idx;
+        if (Vbmi_Supported && selectedIsa() == Isa::AVX512) {
+            decodeVbmi(program, bytecodes_ptr, effects.data());
+        } else if (Avx2_Supported) {
+            decodeAvx2(program, bytecodes_ptr, effects.data());
+        } else {
+            decodeScalar(program, bytecodes_ptr, effects.data());
+        }
     }
 
-    void BytecodeCompiler::fdivm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t src_register{ instr.src_register };
-        const uint8_t f_dst_register{ instr.dst_register % Float_Register_Count };
-        const uint64_t mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-        const uint64_t imm{ instr.imm32 };
-
-        if (src_register != Sib_Reg_Idx) {
-            const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 24 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0xe6'7a'c5'00'00'00'00'25 | uint64_t(mem_mask) << 8 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t andps{ 0x0f'45'e7'54'0f'45'06'24 };
-            std::memcpy(code_buffer + code_size + 16, &andps, sizeof(andps));
-            const uint64_t orps{ 0x00'e4'5e'41'c1'c4'e5'56 | uint64_t(8 * f_dst_register) << 48 | uint64_t(24 - 8 * f_dst_register) << 32 };
-            std::memcpy(code_buffer + code_size + 24, &orps, sizeof(orps));
-            code_size += 31;
+    void BytecodeCompiler::analyze(const RxProgram& program) noexcept {
+        // Index of last instruction that modified integer register (or -1). Used to find CBRANCH jump targets: https://github.com/tevador/RandomX/blob/master/doc/specs.md#5619-cbranch
+        std::array<int16_t, Int_Register_Count> reg_usage{ -1, -1, -1, -1, -1, -1, -1, -1 };
+        int16_t last_fp_instr{ -1 }; // Last instruction whose result depends on rounding mode.
+        int16_t last_cfround_instr{ -1 };
 
-        } else {
-            const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(src_register) << 16 | uint64_t(imm) << 32 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0x7a'c5'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint64_t andps{ 0x45'e7'54'0f'45'06'24'e6 };
-            std::memcpy(code_buffer + code_size + 16, &andps, sizeof(andps));
-            const uint64_t orps{ 0xe4'5e'41'c1'c4'e5'56'0f | uint64_t(8 * f_dst_register) << 56 | uint64_t(24 - 8 * f_dst_register) << 40 };
-            std::memcpy(code_buffer + code_size + 24, &orps, sizeof(orps));
-            code_size += 32;
-        }
+        dead_cfround.reset();
 
-        last_fp_instr = idx;
-    }
+        for (int16_t idx = 0; idx < static_cast<int16_t>(program.instructions.size()); ++idx) {
+            const RxInstruction& instr{ program.instructions[idx] };
+            const uint8_t effect{ effects[idx] };
+
+            // Common instructions are handled without branches (compiled to conditional moves).
+            reg_usage[instr.dst_register] = (effect & Writes_Dst) ? idx : reg_usage[instr.dst_register];
+            last_fp_instr = (effect & Uses_Rounding) ? idx : last_fp_instr;
 
-    void BytecodeCompiler::fsqrtr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        const uint8_t dst_register{ instr.dst_register % Float_Register_Count };
-        const uint32_t vsqrtpd{ 0xe4'51'f9'c5 | uint32_t(9 * dst_register) << 24 };
-        std::memcpy(code_buffer + code_size, &vsqrtpd, sizeof(vsqrtpd));
-        code_size += 4;
+            if (!(effect & Special)) [[likely]] {
+                continue;
+            }
 
-        last_fp_instr = idx;
+            switch (bytecodes[idx]) { using enum Bytecode;
+            case IMUL_RCP:
+                if (instr.imm32 != 0 && !std::has_single_bit(instr.imm32)) {
+                    reg_usage[instr.dst_register] = idx;
+                }
+                break;
+            case ISWAP_R:
+                if (instr.src_register != instr.dst_register) {
+                    reg_usage[instr.src_register] = idx;
+                    reg_usage[instr.dst_register] = idx;
+                }
+                break;
+            case CBRANCH:
+                branch_target[idx] = reg_usage[instr.dst_register] + 1;
+
+                // Taken jump repeats floating point instructions placed after the target, so they may use rounding mode set by any CFROUND before this jump.
+                if (branch_target[idx] <= last_fp_instr) {
+                    last_fp_instr = idx;
+                }
+
+                reg_usage.fill(idx); // Set all registers as used.
+                break;
+            case CFROUND:
+                // Rounding mode set by previous CFROUND was not used by any instruction.
+                if (last_cfround_instr > last_fp_instr) {
+                    dead_cfround.set(last_cfround_instr);
+                }
+
+                last_cfround_instr = idx;
+                break;
+            default:
+                break;
+            }
+        }
     }
 
-    void BytecodeCompiler::cfround_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
-        if (last_cfround_instr > last_fp_instr) {
-            constexpr uint8_t nop12[12] = { 0x66, 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    void BytecodeCompiler::compile(const RxProgram& program) noexcept {
+        // Code offset is kept in local variable: stores of code through char pointer would force its reload from memory after every write.
+        uint32_t offset{ static_cast<uint32_t>(code_size) };
 
-            if (program->instructions[last_cfround_instr].imm32 % 64 != 0) {
-                // 2x8 nop
-                std::memcpy(code_buffer + instr_offset[last_cfround_instr], &nop12[4], sizeof(nop12) - 4);
-                std::memcpy(code_buffer + instr_offset[last_cfround_instr] + 8, &nop12[4], sizeof(nop12) - 4);
-            } else {
-                // 1x12 nop
-                std::memcpy(code_buffer + instr_offset[last_cfround_instr], nop12, sizeof(nop12));
+        for (uint32_t idx = 0; idx < program.instructions.size(); ++idx) {
+            const RxInstruction& instr{ program.instructions[idx] };
+            const InstrEncoding& encoding{ Instr_Encodings[static_cast<uint8_t>(bytecodes[idx])] };
+            instr_offset[idx] = static_cast<int16_t>(offset);
+
+            if (encoding.special) {
+                code_size = static_cast<int16_t>(offset);
+                (this->*encoding.special)(instr, idx);
+                offset = code_size;
+                continue;
             }
+
+            const uint8_t dst_register{ instr.dst_register };
+            const uint8_t src_register{ instr.src_register };
+            const uint32_t imm{ instr.imm32 };
+            const bool same_registers{ dst_register == src_register };
+
+            // Operands select templates arithmetically, branches on random bytecodes would be mispredicted.
+            const bool has_memory{ encoding.memory & !(encoding.memory_unless_same & same_registers) };
+            const bool l3_store{ encoding.store & (instr.modCond() >= L3_Store_Condition) };
+            const uint32_t base{ encoding.store ? dst_register : src_register };
+            const uint32_t level{ std::max(scratchpadLevel(instr), l3_store * Scratchpad_L3) };
+            const uint32_t memory_index{ memoryOperandIndex(static_cast<uint8_t>(encoding.addr), base, level) };
+            const InstrTemplate& memory_code{ Memory_Operand_Code[No_Memory_Operand - has_memory * (No_Memory_Operand - memory_index)] }; // Select without branch.
+
+            const bool no_rotation{ encoding.rotate & same_registers & (imm % 64 == 0) };
+            const uint32_t index{ (dst_register & encoding.reg_mask) * encoding.dst_scale + (src_register & encoding.reg_mask) * encoding.src_scale
+                + same_registers * encoding.same_scale + instr.modShift() * encoding.shift_scale };
+            const InstrTemplate& op_code{ encoding.op_code[no_rotation ? Int_Register_Count * Int_Register_Count : index] };
+
+            offset += compileTemplate(code_buffer + offset, memory_code, imm);
+            offset += compileTemplate(code_buffer + offset, op_code, imm);
         }
 
-        const uint8_t src_register{ instr.src_register };
+        code_size = static_cast<int16_t>(offset);
+    }
 
-        if (const uint64_t imm{ instr.imm32 % 64 }; imm != 0) {
-            const uint64_t mov{ 0x48'00'c8'c1'48'c0'89'4c | imm << 48 | uint64_t(8 * src_register) << 16 };
-            std::memcpy(code_buffer + code_size, &mov, sizeof(mov));
-            const uint64_t and_{ 0xf0'86'54'ae'0f'03'e0'83 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            code_size += 16;
-        } else {
-            const uint64_t mov{ 0x0f'03'e0'83'48'c0'89'4c | uint64_t(8 * src_register) << 16 };
-            std::memcpy(code_buffer + code_size, &mov, sizeof(mov));
-            const uint32_t ldmxcsr{ 0xf0'86'54'ae };
-            std::memcpy(code_buffer + code_size + 8, &ldmxcsr, sizeof(ldmxcsr));
-            code_size += 12;
+    void BytecodeCompiler::imulrcp_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
+        const uint32_t imm{ instr.imm32 };
+        if (imm == 0 || std::has_single_bit(imm)) {
+            return;
         }
 
-        last_cfround_instr = idx;
+        const auto& tmpl{ Imul_Rcp_Code[instr.dst_register] };
+        const uint64_t rcp{ reciprocal(imm) };
+        std::memcpy(code_buffer + code_size, &tmpl, sizeof(tmpl));
+        std::memcpy(code_buffer + code_size + tmpl.imm_offset, &rcp, sizeof(rcp));
+        code_size += tmpl.size;
     }
 
-    void BytecodeCompiler::istore_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
+    void BytecodeCompiler::cbranch_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
         const uint8_t dst_register{ instr.dst_register };
-        const uint8_t src_register{ instr.src_register };
-        const uint32_t imm{ instr.imm32 };
-        constexpr uint32_t L3_Store_Condition{ 14 };
 
-        auto mem_mask{ instr.modMask() ? Scratchpad_L1_Mask : Scratchpad_L2_Mask };
-        if (instr.modCond() >= L3_Store_Condition) {
-            mem_mask = Scratchpad_L3_Mask;
+        constexpr uint32_t Condition_Mask{ (1 << Rx_Jump_Bits) - 1 };
+        const auto shift{ instr.modCond() + Rx_Jump_Offset };
+        const uint32_t mem_mask{ Condition_Mask << shift };
+
+        static_assert(Rx_Jump_Offset > 0, "Below simplification requires this assertion");
+        uint32_t imm{ instr.imm32 | (1 << shift) };
+        imm &= ~(1ULL << (shift - 1)); // Clear the bit below the condition mask - this limits the number of successive jumps to 2.
+
+        // add (7 bytes) is followed by test (7 bytes) macro-fused with jz (2 or 6 bytes).
+        constexpr uint32_t Add_Size{ 7 };
+        constexpr uint32_t Test_Size{ 7 };
+        constexpr uint32_t Short_Size{ Add_Size + Test_Size + 2 };
+        constexpr uint32_t Near_Size{ Add_Size + Test_Size + 6 };
+
+        const int32_t target_offset{ instr_offset[branch_target[idx]] };
+        uint32_t padding{ layout.jumpPadding(code_size + Add_Size, Test_Size + 2) };
+        int32_t jmp_offset{ target_offset - int32_t(code_size + padding + Short_Size) };
+
+        const bool short_jump{ jmp_offset >= -128 };
+        if (!short_jump) {
+            padding = layout.jumpPadding(code_size + Add_Size, Test_Size + 6);
+            padding = Near_Size + padding > Max_Instruction_Size ? 0 : padding; // Rare 13-byte padding is skipped.
+            jmp_offset = target_offset - int32_t(code_size + padding + Near_Size);
         }
 
-        if (dst_register != Sib_Reg_Idx) {
-            const uint64_t lea{ 0x48'00'00'00'00'80'8d'49 | uint64_t(dst_register) << 16 | uint64_t(imm) << 24 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0x04'89'4c'00'00'00'00'25 | uint64_t(mem_mask) << 8 | uint64_t(8 * src_register) << 56 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint8_t mov{ static_cast<uint8_t>(0x06) };
-            std::memcpy(code_buffer + code_size + 16, &mov, 1);
-            code_size += 17;
+        emitNops(padding);
+
+        char* const code{ code_buffer + code_size };
+        code_size += compileTemplate(code, Cbranch_Code[2 * dst_register + !short_jump], imm);
+        std::memcpy(code + Cbranch_Mask_Offset, &mem_mask, sizeof(mem_mask));
+
+        if (short_jump) {
+            const int8_t short_offset{ static_cast<int8_t>(jmp_offset) };
+            std::memcpy(code + Cbranch_Short_Jump_Offset, &short_offset, sizeof(short_offset));
         } else {
-            const uint64_t lea{ 0x00'00'00'00'24'80'8d'49 | uint64_t(dst_register) << 16 | uint64_t(imm) << 32 };
-            std::memcpy(code_buffer + code_size, &lea, sizeof(lea));
-            const uint64_t and_{ 0x89'4c'00'00'00'00'25'48 | uint64_t(mem_mask) << 16 };
-            std::memcpy(code_buffer + code_size + 8, &and_, sizeof(and_));
-            const uint16_t mov{ static_cast<uint16_t>(0x06'04 | uint16_t(8 * src_register)) };
-            std::memcpy(code_buffer + code_size + 16, &mov, 2);
-            code_size += 18;
+            std::memcpy(code + Cbranch_Near_Jump_Offset, &jmp_offset, sizeof(jmp_offset));
         }
     }
+
+    // Rounding mode is taken from integer register value, so it is known only at runtime and MXCSR has to be written.
+    // EVEX embedded rounding ({rn-sae}, ...) is static per instruction and could replace ldmxcsr only with separate copy of code for every rounding mode
+    // and jump between copies at every CFROUND. Mode is random on every iteration, so the jump is mispredicted: measured 4-way dispatch alone costs
+    // ~4% of program execution, ldmxcsr ~1-2.5% (programs with CFROUND only). Only redundant writes are removed instead (see analyze).
+    void BytecodeCompiler::cfround_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept {
+        if (dead_cfround[idx]) {
+            return;
+        }
+
+        code_size += compileTemplate(code_buffer + code_size, Cfround_Code[2 * instr.src_register + (instr.imm32 % 64 != 0)], instr.imm32);
+    }
+
 }
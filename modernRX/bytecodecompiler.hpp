@@ -5,10 +5,9 @@
 * Defines code generation functions for all RandomX instructions.
 */
 
-#include <print>
+#include <bitset>
 
 #include "bytecode.hpp"
-#include "exception.hpp"
 
 namespace modernRX {
     inline constexpr uint32_t Float_Register_Count{ 4 };
@@ -50,180 +49,51 @@ namespace modernRX {
     static_assert(sizeof(RxProgram) == Rx_Program_Bytes_Size); // Size of random program is also used in different context. Make sure both values match.
     static_assert(offsetof(RxProgram, entropy) == 0);
 
-    template<typename Tout, typename Tin>
-    inline Tout ForceCast(const Tin in)
-    {
-        union
-        {
-            Tin in;
-            Tout out;
-        } u = { in };
+    // Code layout rules applied on top of instruction encoding. Depend only on CPU microarchitecture, not on RandomX program.
+    // Code buffer is expected to be at least 32-byte aligned, so offsets in code buffer have the same alignment as addresses.
+    struct CodeLayoutPolicy {
+        bool jcc_erratum_padding{ false }; // Pad jumps (with their macro-fused instruction) to not cross or end on 32-byte boundary.
 
-        return u.out;
+        // Returns layout policy for CPU the process runs on.
+        [[nodiscard]] static CodeLayoutPolicy detect() noexcept;
+
+        // Returns number of padding bytes needed before jump of given size (including macro-fused instruction) placed at given offset.
+        [[nodiscard]] uint32_t jumpPadding(const uint32_t offset, const uint32_t size) const noexcept;
     };
 
     struct alignas(64) BytecodeCompiler {
         std::array<int16_t, Rx_Program_Size> instr_offset{};
-        std::array<int16_t, Int_Register_Count> reg_usage{ -1, -1, -1, -1, -1, -1, -1, -1 };
-        const int64_t Base_Cmpl_Addr{ ForceCast<int64_t>(&BytecodeCompiler::irorr_cmpl) };
+        std::array<int16_t, Rx_Program_Size> branch_target{}; // For CBRANCH instructions: index of instruction to jump to. Filled by analyze.
+        alignas(64) std::array<Bytecode, Rx_Program_Size> bytecodes{}; // Bytecode of every instruction. Filled by decode.
+        alignas(64) std::array<uint8_t, Rx_Program_Size> effects{}; // Effects of every instruction tracked by analyze. Filled by decode.
+        std::bitset<Rx_Program_Size> dead_cfround{}; // CFROUND instructions whose rounding mode is never used. Filled by analyze.
         char* code_buffer{ nullptr };
-        RxProgram* program{ nullptr };
         int16_t code_size{ 0 };
-        int16_t last_fp_instr{ -1 };
-        int16_t last_cfround_instr{ -1 };
+        CodeLayoutPolicy layout{ CodeLayoutPolicy::detect() };
 
         void reset() noexcept {
             code_size = 0;
-            reg_usage.fill(-1);
-            last_fp_instr = -1;
-            last_cfround_instr = -1;
             // instr_offset will be overwritten during compilation
         }
 
-        void iaddrs_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void iaddm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void isubr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void isubm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void imulr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void imulm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void imulhr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void imulhm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void ismulhr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void ismulhm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void inegr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void ixorr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void ixorm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void irorr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void irolr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
+        // Decodes opcodes of all instructions at once. Has to be done before analysis.
+        void decode(const RxProgram& program) noexcept;
+
+        // Whole-program pass that has to be done before compilation of any instruction.
+        // Gathers information about relations between instructions, so single instruction can be compiled without looking at others.
+        void analyze(const RxProgram& program) noexcept;
+
+        // Compiles all instructions of decoded and analyzed program.
+        void compile(const RxProgram& program) noexcept;
+
+        // Writes given number of padding bytes as the fewest possible multi-byte NOP instructions.
+        void emitNops(uint32_t size) noexcept;
+
+        // Instructions that need more than template lookup and immediate patching.
         void imulrcp_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void iswapr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
         void cbranch_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fswapr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void faddr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void faddm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fsubr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fsubm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fscalr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fmulr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fdivm_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void fsqrtr_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
         void cfround_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
-        void istore_cmpl(const RxInstruction& instr, const uint32_t idx) noexcept;
     };
 
     using InstrCmpl = void(BytecodeCompiler::*)(const RxInstruction&, const uint32_t);
-
-    inline int16_t bcCmplDiff(InstrCmpl base, InstrCmpl func) {
-        const auto dist{ ForceCast<int32_t>(func) - ForceCast<int32_t>(base) };
-        if (dist > std::numeric_limits<int16_t>::max() || dist < std::numeric_limits<int16_t>::min()) {
-            throw Exception(std::format("Distance between functions out of bounds; should be true {} <= {} <= {}", 
-                std::numeric_limits<int16_t>::min(), dist, std::numeric_limits<int16_t>::max()));
-        }
-
-        return static_cast<int16_t>(dist);
-    }
-
-    inline const alignas(64) std::array<int16_t, LUT_Opcode.size()> LUT_Instr_Cmpl_Offsets = []() {
-        std::array<int16_t, LUT_Opcode.size()> LUT_Instr_Cmpl_Offsets_{};
-        const auto Base_Cmpl_Func{ ForceCast<InstrCmpl>(&BytecodeCompiler::irorr_cmpl) };
-
-        try {
-            for (uint32_t i = 0; i < LUT_Instr_Cmpl_Offsets_.size(); ++i) {
-                switch (LUT_Opcode[i]) { using enum Bytecode;
-                case IADD_RS:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::iaddrs_cmpl);
-                    break;
-                case IADD_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::iaddm_cmpl);
-                    break;
-                case ISUB_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::isubr_cmpl);
-                    break;
-                case ISUB_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::isubm_cmpl);
-                    break;
-                case IMUL_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::imulr_cmpl);
-                    break;
-                case IMUL_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::imulm_cmpl);
-                    break;
-                case IMULH_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::imulhr_cmpl);
-                    break;
-                case IMULH_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::imulhm_cmpl);
-                    break;
-                case ISMULH_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::ismulhr_cmpl);
-                    break;
-                case ISMULH_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::ismulhm_cmpl);
-                    break;
-                case IMUL_RCP:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::imulrcp_cmpl);
-                    break;
-                case INEG_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::inegr_cmpl);
-                    break;
-                case IXOR_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::ixorr_cmpl);
-                    break;
-                case IXOR_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::ixorm_cmpl);
-                    break;
-                case IROR_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::irorr_cmpl);
-                    break;
-                case IROL_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::irolr_cmpl);
-                    break;
-                case ISWAP_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::iswapr_cmpl);
-                    break;
-                case CBRANCH:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::cbranch_cmpl);
-                    break;
-                case FSWAP_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fswapr_cmpl);
-                    break;
-                case FADD_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::faddr_cmpl);
-                    break;
-                case FADD_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::faddm_cmpl);
-                    break;
-                case FSUB_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fsubr_cmpl);
-                    break;
-                case FSUB_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fsubm_cmpl);
-                    break;
-                case FSCAL_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fscalr_cmpl);
-                    break;
-                case FMUL_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fmulr_cmpl);
-                    break;
-                case FDIV_M:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fdivm_cmpl);
-                    break;
-                case FSQRT_R:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::fsqrtr_cmpl);
-                    break;
-                case CFROUND:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::cfround_cmpl);
-                    break;
-                case ISTORE:
-                    LUT_Instr_Cmpl_Offsets_[i] = bcCmplDiff(Base_Cmpl_Func, &BytecodeCompiler::istore_cmpl);
-                    break;
-                }
-            }
-        } catch (const std::exception& ex) {
-            std::println("Failed to initialize LUT_Instr_Cmpl_Offsets: {}", ex.what());
-            std::terminate();
-        }
-
-        return LUT_Instr_Cmpl_Offsets_;
-    }();
 }
@@ -1,12 +1,21 @@
 #pragma once
 
 /*
-* Wrapper over cpuid intrinsics for detecting CPU capabilities.
+* Wrapper over cpuid intrinsics for detecting CPU capabilities, cache hierarchy and topology.
 * Not a part of RandomX algorithm.
 */
 
+#include <algorithm>
+#include <array>
 #include <bitset>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
 #include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
 
 // Based on: https://github.com/cklutz/mcoreinfo/blob/master/sysinfo/CpuCapabilities.cs
 // and https://learn.microsoft.com/pl-pl/cpp/intrinsics/cpuid-cpuidex?view=msvc-170
@@ -16,6 +25,41 @@ class CPUInfo
 class CPUInfo_Internal;
 
 public:
+    enum class CacheType : uint8_t {
+        Data = 1,
+        Instruction = 2,
+        Unified = 3,
+    };
+
+    // Single cache described by cpuid leaf 0x4 (Intel) or 0x8000001D (AMD).
+    struct Cache {
+        uint32_t level{ 0 };
+        CacheType type{ CacheType::Unified };
+        uint32_t size{ 0 }; // In bytes.
+        uint32_t line_size{ 0 };
+        uint32_t ways{ 0 };
+        uint32_t sets{ 0 };
+        uint32_t shared_by{ 1 }; // Maximum number of logical processors sharing this cache (eg. single CCX for L3 on AMD).
+    };
+
+    // Topology of a package (socket) and its cache hierarchy, described by cpuid leaf 0x1F or 0xB.
+    struct Topology {
+        uint32_t logical_processors{ 1 }; // Per package.
+        uint32_t physical_cores{ 1 }; // Per package.
+        uint32_t threads_per_core{ 1 };
+        bool hybrid{ false }; // True if package mixes performance and efficiency cores; then per-core values above are only estimates.
+        std::vector<Cache> caches{};
+
+        // Returns data (or unified) cache of given level or nullptr if it was not reported.
+        [[nodiscard]] const Cache* dataCache(const uint32_t level) const noexcept {
+            const auto it{ std::ranges::find_if(caches, [level](const Cache& cache) { return cache.level == level && cache.type != CacheType::Instruction; }) };
+            return it != caches.end() ? &*it : nullptr;
+        }
+    };
+
+    // Returns true if CPU supports AVX2 instructions.
+    [[nodiscard]] static bool AVX2() { return cpuinfo().f_7_EBX_[5]; };
+
     // Returns true if CPU supports AVX512F instructions.
 	 [[nodiscard]] static bool AVX512F() { return cpuinfo().f_7_EBX_[16]; };
 
@@ -25,12 +69,41 @@ public:
     // Returns true if CPU supports AVX512DQ instructions.
 	 [[nodiscard]] static bool AVX512DQ() { return cpuinfo().f_7_EBX_[17]; };
 
+    // Returns true if CPU supports AVX512BW instructions.
+    [[nodiscard]] static bool AVX512BW() { return cpuinfo().f_7_EBX_[30]; };
+
+    // Returns true if CPU supports AVX512VBMI instructions.
+    [[nodiscard]] static bool AVX512VBMI() { return cpuinfo().f_7_ECX_[1]; };
+
     // Returns true if CPU supports AES instructions.
     [[nodiscard]] static bool AES() { return cpuinfo().f_1_ECX_[25]; };
 
+    // Returns true if CPU supports VAES instructions (AES on 256/512-bit vectors).
+    [[nodiscard]] static bool VAES() { return cpuinfo().f_7_ECX_[9]; };
+
     // Returns true if CPU supports hyperthreading.
+    // This flag is set by most modern CPUs regardless of SMT being enabled; use topology() to know real number of threads per core.
     [[nodiscard]] static bool HTT() { return cpuinfo().f_1_EDX_[28]; };
 
+    // Returns true if CPU is a hybrid part (eg. Alder Lake) with more than one core type.
+    [[nodiscard]] static bool Hybrid() { return cpuinfo().f_7_EDX_[15]; };
+
+    // Returns topology and cache hierarchy of the package.
+    [[nodiscard]] static Topology topology() { return cpuinfo().topology_; };
+
+    // Returns true if CPU is Skylake-derived Intel core affected by JCC erratum.
+    // With erratum microcode update jumps that cross or end on 32-byte boundary are not cached in decoded ICache: https://www.intel.com/content/dam/support/us/en/documents/processors/mitigations-jump-conditional-code-erratum.pdf
+    [[nodiscard]] static bool JCCErratum() {
+        const auto info{ cpuinfo() };
+        if (!info.intel_ || info.family_ != 6) {
+            return false;
+        }
+
+        // Skylake, Skylake-X/Cascade Lake/Cooper Lake, Kaby Lake, Coffee Lake, Whiskey Lake, Amber Lake, Comet Lake.
+        constexpr std::array<uint32_t, 7> Affected_Models{ 0x4e, 0x5e, 0x55, 0x8e, 0x9e, 0xa5, 0xa6 };
+        return std::ranges::find(Affected_Models, info.model_) != Affected_Models.end();
+    };
+
 private:
     static const CPUInfo_Internal CPU_Rep;
 
@@ -43,51 +116,154 @@ private:
     class CPUInfo_Internal {
     public:
         [[nodiscard]] explicit CPUInfo_Internal() {
-            std::array<int, 4> cpui{};
-
-            // Calling __cpuid with 0x0 as the function_id argument
+            // Calling cpuid with 0x0 as the function_id argument
             // gets the number of the highest valid function ID.
-            __cpuid(cpui.data(), 0);
+            auto cpui{ cpuid(0) };
             auto nIds_{ cpui[0] };
 
             for (int i = 0; i <= nIds_; ++i) {
-                __cpuidex(cpui.data(), i, 0);
-                data_.push_back(cpui);
+                data_.push_back(cpuid(i));
             }
 
+            // Vendor string is stored in EBX, EDX, ECX of function 0x00000000.
+            intel_ = data_[0][1] == 0x756e6547 && data_[0][3] == 0x49656e69 && data_[0][2] == 0x6c65746e; // "GenuineIntel"
+
             // Load bitset with flags for function 0x00000001.
             if (nIds_ >= 1) {
                 f_1_ECX_ = data_[1][2];
                 f_1_EDX_ = data_[1][3];
+
+                // Display family and model, as described in Intel SDM vol. 2A, CPUID instruction.
+                const uint32_t eax{ static_cast<uint32_t>(data_[1][0]) };
+                const uint32_t base_family{ (eax >> 8) & 0xf };
+                const uint32_t base_model{ (eax >> 4) & 0xf };
+                family_ = base_family == 0xf ? base_family + ((eax >> 20) & 0xff) : base_family;
+                model_ = base_family == 0x6 || base_family == 0xf ? (((eax >> 16) & 0xf) << 4) + base_model : base_model;
             }
 
             // Load bitset with flags for function 0x00000007.
             if (nIds_ >= 7) {
                 f_7_EBX_ = data_[7][1];
+                f_7_ECX_ = data_[7][2];
+                f_7_EDX_ = data_[7][3];
             }
 
-            // Calling __cpuid with 0x80000000 as the function_id argument
+            // Calling cpuid with 0x80000000 as the function_id argument
             // gets the number of the highest valid extended ID.
-            cpui.fill(0);
-            __cpuid(cpui.data(), 0x80000000);
-            nIds_ = cpui[0];
+            cpui = cpuid(0x80000000);
+            const auto nExIds_{ static_cast<uint32_t>(cpui[0]) };
 
-            for (int i = 0x80000000; i <= nIds_; ++i) {
-                __cpuidex(cpui.data(), i, 0);
-                extdata_.push_back(cpui);
+            for (uint32_t i = 0x80000000; i <= nExIds_ && i - 0x80000000 < 0x100; ++i) {
+                extdata_.push_back(cpuid(i));
             }
 
+            // Topology extensions (AMD) are reported in ECX of function 0x80000001.
+            const bool topology_extensions{ extdata_.size() > 1 && (extdata_[1][2] & (1 << 22)) };
+            loadCaches(intel_ || !topology_extensions ? 0x4 : 0x8000001D);
+            loadTopology(static_cast<uint32_t>(nIds_));
+
             initialized = true;
         };
 
         std::bitset<32> f_1_EDX_{ 0 };
         std::bitset<32> f_1_ECX_{ 0 };
         std::bitset<32> f_7_EBX_{ 0 };
+        std::bitset<32> f_7_ECX_{ 0 };
+        std::bitset<32> f_7_EDX_{ 0 };
         std::vector<std::array<int, 4>> data_{};
         std::vector<std::array<int, 4>> extdata_{};
+        uint32_t family_{ 0 };
+        uint32_t model_{ 0 };
+        bool intel_{ false };
+        Topology topology_{};
         bool initialized{ false };
+
+    private:
+        [[nodiscard]] static std::array<int, 4> cpuid(const uint32_t leaf, const uint32_t subleaf = 0) noexcept {
+            std::array<int, 4> regs{};
+#if defined(_MSC_VER)
+            __cpuidex(regs.data(), static_cast<int>(leaf), static_cast<int>(subleaf));
+#else
+            unsigned int eax{ 0 }, ebx{ 0 }, ecx{ 0 }, edx{ 0 };
+            __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+            regs = { static_cast<int>(eax), static_cast<int>(ebx), static_cast<int>(ecx), static_cast<int>(edx) };
+#endif
+            return regs;
+        }
+
+        // Enumerates deterministic cache parameters. Leaf 0x4 (Intel) and 0x8000001D (AMD) share the same layout.
+        void loadCaches(const uint32_t leaf) {
+            if (leaf == 0x4 && data_.size() <= 0x4) {
+                return;
+            }
+
+            for (uint32_t subleaf = 0; subleaf < 16; ++subleaf) {
+                const auto regs{ cpuid(leaf, subleaf) };
+                const auto eax{ static_cast<uint32_t>(regs[0]) };
+                const auto ebx{ static_cast<uint32_t>(regs[1]) };
+                const auto ecx{ static_cast<uint32_t>(regs[2]) };
+
+                const auto type{ eax & 0x1f };
+                if (type == 0) {
+                    break; // No more caches.
+                }
+
+                Cache cache{
+                    .level = (eax >> 5) & 0x7,
+                    .type = static_cast<CacheType>(type),
+                    .line_size = (ebx & 0xfff) + 1,
+                    .ways = ((ebx >> 22) & 0x3ff) + 1,
+                    .sets = ecx + 1,
+                    .shared_by = ((eax >> 14) & 0xfff) + 1,
+                };
+                const auto partitions{ ((ebx >> 12) & 0x3ff) + 1 };
+                cache.size = cache.ways * partitions * cache.line_size * cache.sets;
+                topology_.caches.push_back(cache);
+            }
+        }
+
+        // Enumerates SMT and core levels of V2 (0x1F) or V1 (0xB) extended topology leaf.
+        // Falls back to legacy leaf 0x1 logical processor count if none of them is available.
+        void loadTopology(const uint32_t max_leaf) {
+            topology_.hybrid = f_7_EDX_[15];
+
+            for (const uint32_t leaf : { 0x1Fu, 0xBu }) {
+                if (max_leaf < leaf) {
+                    continue;
+                }
+
+                uint32_t logical_processors{ 0 };
+                uint32_t threads_per_core{ 1 };
+                for (uint32_t subleaf = 0; subleaf < 8; ++subleaf) {
+                    const auto regs{ cpuid(leaf, subleaf) };
+                    const auto level_type{ (static_cast<uint32_t>(regs[2]) >> 8) & 0xff };
+                    if (level_type == 0) {
+                        break; // No more levels.
+                    }
+
+                    const auto count{ static_cast<uint32_t>(regs[1]) & 0xffff };
+                    if (level_type == 1) {
+                        threads_per_core = std::max(count, 1u); // SMT level.
+                    }
+
+                    logical_processors = count; // Last valid level describes whole package.
+                }
+
+                if (logical_processors > 0) {
+                    topology_.logical_processors = logical_processors;
+                    topology_.threads_per_core = threads_per_core;
+                    topology_.physical_cores = std::max(logical_processors / threads_per_core, 1u);
+                    return;
+                }
+            }
+
+            if (data_.size() > 1 && f_1_EDX_[28]) {
+                topology_.logical_processors = std::max((static_cast<uint32_t>(data_[1][1]) >> 16) & 0xff, 1u);
+                topology_.physical_cores = topology_.logical_processors;
+            }
+        }
     };
 };
 
 // Initialization.
-const CPUInfo::CPUInfo_Internal CPUInfo::CPU_Rep{};
+inline const CPUInfo::CPUInfo_Internal CPUInfo::CPU_Rep{};
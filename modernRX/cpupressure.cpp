@@ -0,0 +1,120 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <string>
+#endif
+
+#include <algorithm>
+#include <thread>
+
+#include "cpupressure.hpp"
+
+namespace modernRX {
+    namespace {
+#ifdef _WIN32
+        [[nodiscard]] uint64_t toUint64(const FILETIME& time) noexcept;
+#endif
+    }
+
+    CpuPressure::CpuPressure() noexcept {
+        valid = read(counters);
+    }
+
+    std::optional<double> CpuPressure::sample() noexcept {
+        std::array<uint64_t, 4> current;
+        if (!read(current)) {
+            valid = false;
+            return std::nullopt;
+        }
+
+        const auto previous{ counters };
+        const bool had_previous{ valid };
+        counters = current;
+        valid = true;
+
+        if (!had_previous) {
+            return std::nullopt;
+        }
+
+#ifdef _WIN32
+        // Counters: idle, kernel (includes idle) and user time of all processors, kernel and user time of this process. In 100ns units.
+        const auto idle{ current[0] - previous[0] };
+        const auto total{ current[1] - previous[1] };
+        const auto own{ current[2] - previous[2] };
+        if (total == 0 || total < idle) {
+            return 0.0;
+        }
+
+        // Some processor was idle for the whole interval, so no process had to wait.
+        const uint32_t processors{ std::max(1u, std::thread::hardware_concurrency()) };
+        if (idle > total / processors) {
+            return 0.0;
+        }
+
+        const auto busy{ total - idle };
+        const auto others{ busy > own ? busy - own : 0 };
+        return std::clamp(static_cast<double>(others) / total, 0.0, 1.0);
+#else
+        // Counters: total stall time from PSI and monotonic time. In microseconds.
+        const auto stalled{ current[0] - previous[0] };
+        const auto elapsed{ current[1] - previous[1] };
+        if (elapsed == 0) {
+            return 0.0;
+        }
+
+        return std::clamp(static_cast<double>(stalled) / elapsed, 0.0, 1.0);
+#endif
+    }
+
+    bool CpuPressure::read(std::array<uint64_t, 4>& output) const noexcept {
+#ifdef _WIN32
+        FILETIME idle, kernel, user;
+        FILETIME creation, exit, process_kernel, process_user;
+        if (!GetSystemTimes(&idle, &kernel, &user) || !GetProcessTimes(GetCurrentProcess(), &creation, &exit, &process_kernel, &process_user)) {
+            return false;
+        }
+
+        output = { toUint64(idle), toUint64(kernel) + toUint64(user), toUint64(process_kernel) + toUint64(process_user), 0 };
+        return true;
+#else
+        // Line format: "some avg10=0.00 avg60=0.00 avg300=0.00 total=0", where total is cumulative stall time in microseconds.
+        try {
+            std::ifstream file{ "/proc/pressure/cpu" };
+            std::string line;
+            while (std::getline(file, line)) {
+                constexpr std::string_view Total_Field{ "total=" };
+                const auto total_pos{ line.find(Total_Field) };
+                if (!line.starts_with("some") || total_pos == std::string::npos) {
+                    continue;
+                }
+
+                const auto first{ line.data() + total_pos + Total_Field.size() };
+                uint64_t stalled{ 0 };
+                if (std::from_chars(first, line.data() + line.size(), stalled).ec != std::errc{}) {
+                    return false;
+                }
+
+                const auto now{ std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()) };
+                output = { stalled, static_cast<uint64_t>(now.count()), 0, 0 };
+                return true;
+            }
+        } catch (...) {
+        }
+
+        return false;
+#endif
+    }
+
+    namespace {
+#ifdef _WIN32
+        uint64_t toUint64(const FILETIME& time) noexcept {
+            return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        }
+#endif
+    }
+}
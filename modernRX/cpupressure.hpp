@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+* Sampler of host CPU pressure, i.e. how much other work on the host has to wait for processors.
+* On Linux it is read from PSI (/proc/pressure/cpu, "some" line): fraction of time in which at least one runnable task was waiting for a processor.
+* Windows has no PSI equivalent, so there it is approximated with GetSystemTimes/GetProcessTimes: share of processor time used by other processes,
+* counted only in intervals when no processor was idle (that is when other processes had to compete with this one).
+* Used by Hasher to park VirtualMachines when latency-sensitive services running on the same host get busy.
+* Not a part of RandomX algorithm.
+*/
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace modernRX {
+    class CpuPressure {
+    public:
+        // Takes initial sample, so the first call to sample returns pressure since construction.
+        [[nodiscard]] explicit CpuPressure() noexcept;
+
+        // Returns pressure in range [0, 1] since previous call (or construction).
+        // Returns std::nullopt if pressure cannot be read (e.g. kernel built without PSI support).
+        [[nodiscard]] std::optional<double> sample() noexcept;
+
+    private:
+        std::array<uint64_t, 4> counters{}; // Platform specific cumulative counters read by previous sample.
+        bool valid{ false }; // True if previous sample succeeded.
+
+        // Reads current platform specific counters. Returns false on failure.
+        [[nodiscard]] bool read(std::array<uint64_t, 4>& output) const noexcept;
+    };
+}
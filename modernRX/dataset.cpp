@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "argon2d.hpp"
 #include "assertume.hpp"
+#include "blake2brandom.hpp"
 #include "dataset.hpp"
+#include "exception.hpp"
 #include "superscalar.hpp"
+#include "threadpool.hpp"
 
 namespace modernRX {
     namespace {
@@ -11,61 +17,295 @@ namespace modernRX {
         static_assert(std::has_single_bit(Cache_Item_Count)); // Vectorized code assumes that Cache_Item_Count is a power of 2.
 
         constexpr uint32_t Cache_Item_Mask{ Cache_Item_Count - 1 }; // Mask used to get cache item for dataset item calculation.
-    }
+        constexpr uint32_t Page_Size{ 4096 };
 
-    HeapArray<DatasetItem, 4096> generateDataset(const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs) {
-        // Compile superscalar programs into single function.
-        const auto jit{ compile(programs) };
+        // Touches every page of freshly allocated memory, so page faults are not taken later during dataset generation.
+        void prefault(std::span<std::byte> memory, ThreadPool& pool) {
+            const size_t bytes_per_task{ (memory.size() / pool.size() + Page_Size - 1) & ~static_cast<size_t>(Page_Size - 1) };
+            const auto task_count{ static_cast<uint32_t>((memory.size() + bytes_per_task - 1) / bytes_per_task) };
+
+            pool.parallelFor(task_count, [memory, bytes_per_task](const uint32_t task_id) {
+                const auto offset{ task_id * bytes_per_task };
+                const auto submemory{ memory.subspan(offset, std::min(bytes_per_task, memory.size() - offset)) };
+                for (size_t i = 0; i < submemory.size(); i += Page_Size) {
+                    submemory[i] = std::byte{ 0 };
+                }
+            });
+        }
+    }
 
-        // Dataset padding size adds additional memory to dataset to make it divisible by thread count * batch_size(4) without remainder.
+    uint32_t datasetItemsCount() noexcept {
+        // Dataset padding size adds additional memory to dataset to make it divisible by thread count * Dataset_Range_Alignment without remainder.
         // This is needed to make sure that each thread will have the same amount of work and no additional function for handling remainders is needed.
         // Additional data will be ignored during hash calculation, its purpose is to simplify dataset generation.
         const uint32_t thread_count{ std::thread::hardware_concurrency() };
-        const uint32_t dataset_alignment{ thread_count * 4 * sizeof(DatasetItem) };
+        const uint32_t dataset_alignment{ thread_count * Dataset_Range_Alignment * sizeof(DatasetItem) };
         const uint32_t dataset_padding_size{ dataset_alignment - ((Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size) % dataset_alignment) };
-        const uint32_t dataset_items_count{ (Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size + dataset_padding_size) / sizeof(DatasetItem) };
-        const uint32_t items_per_thread{ dataset_items_count / thread_count };
+        return (Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size + dataset_padding_size) / sizeof(DatasetItem);
+    }
 
+    HeapArray<DatasetItem, 4096> generateDataset(const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs, const DatasetCompilerMode mode) {
         // Allocate memory for dataset.
-        HeapArray<DatasetItem, 4096> memory{ dataset_items_count };
+        HeapArray<DatasetItem, 4096> memory{ datasetItemsCount() };
+        generateDataset(memory.buffer(), cache, programs, {}, nullptr, mode);
+
+        return memory;
+    }
+
+    bool generateDataset(std::span<DatasetItem> memory, const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs,
+        std::stop_token stop_token, DatasetProgress* progress, const DatasetCompilerMode mode) {
+        const uint32_t dataset_items_count{ datasetItemsCount() };
+        if (memory.size() < dataset_items_count) {
+            throw Exception{ "Dataset memory is too small to hold all dataset items" };
+        }
+
+        return generateDatasetRange(memory.first(dataset_items_count), 0, cache, programs, stop_token, progress, mode);
+    }
+
+    bool generateDatasetRange(std::span<DatasetItem> memory, const uint64_t start_item, const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs,
+        std::stop_token stop_token, DatasetProgress* progress, const DatasetCompilerMode mode) {
+        if (start_item % Dataset_Range_Alignment != 0 || memory.size() % Dataset_Range_Alignment != 0) {
+            throw Exception{ "Dataset range start and size have to be multiples of Dataset_Range_Alignment" };
+        }
+
+        if (start_item + memory.size() > datasetItemsCount()) {
+            throw Exception{ "Dataset range exceeds dataset size" };
+        }
+
+        if (mode == DatasetCompilerMode::ZMM && reinterpret_cast<uintptr_t>(memory.data()) % sizeof(DatasetItem) != 0) {
+            throw Exception{ "Dataset memory has to be aligned to 64 bytes in ZMM mode" };
+        }
 
-        // Split each thread task into smaller jobs. This is for reducing potential variances in execution.
-        constexpr uint32_t Min_Items_Per_Job{ 32'768 }; // Value was chosen empirically.
-        uint32_t task_divisor{ 1 };
-        uint32_t new_dataset_padding_size = dataset_padding_size;
-        while (items_per_thread / task_divisor > Min_Items_Per_Job && new_dataset_padding_size == dataset_padding_size) {
-            task_divisor *= 2;
-            const uint32_t new_dataset_alignment{ dataset_alignment * task_divisor };
-            new_dataset_padding_size = new_dataset_alignment - ((Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size) % new_dataset_alignment);
+        if (memory.empty()) {
+            return !stop_token.stop_requested();
         }
-        task_divisor = std::max<uint32_t>(1, task_divisor / 2); // Prevents task_divisor from being 0.
 
-        const uint32_t items_per_job{ items_per_thread / task_divisor };
-        const uint32_t max_jobs{ dataset_items_count / items_per_job };
+        // Compile superscalar programs into single function.
+        const auto jit{ compile(programs, mode) };
+
+        // Split range into jobs of equal size (except last one), so that each thread gets a few of them. This is for reducing potential variances in execution.
+        // Each job size is a multiple of batch size, so no additional function for handling remainders is needed.
+        constexpr uint64_t Min_Items_Per_Job{ 32'768 }; // Value was chosen empirically.
+        const uint32_t thread_count{ std::thread::hardware_concurrency() };
+        const uint64_t items_per_thread{ (memory.size() + thread_count - 1) / thread_count };
+        const uint64_t jobs_per_thread{ std::max<uint64_t>(1, items_per_thread / Min_Items_Per_Job) };
+        const uint64_t items_per_job_unaligned{ (items_per_thread + jobs_per_thread - 1) / jobs_per_thread };
+        const uint64_t items_per_job{ (items_per_job_unaligned + Dataset_Range_Alignment - 1) / Dataset_Range_Alignment * Dataset_Range_Alignment };
+        const auto max_jobs{ static_cast<uint32_t>((memory.size() + items_per_job - 1) / items_per_job) };
         std::atomic<uint32_t> job_counter{ 0 };
 
-        // Task that will be executed by each thread.
-        const auto task = [max_jobs, items_per_job, &job_counter, jit_program{ reinterpret_cast<JITDatasetItemProgram>(jit.get()) }, cache_ptr{cache.data()}](std::span<DatasetItem> memory) {
+        // Task that will be executed by each pool worker.
+        // Cancellation is checked between jobs.
+        const auto task = [max_jobs, items_per_job, start_item, &job_counter, &stop_token, progress, jit_program{ reinterpret_cast<JITDatasetItemProgram>(jit.get()) }, cache_ptr{cache.data()}, memory](uint32_t) {
             auto job_id{ job_counter.fetch_add(1, std::memory_order_relaxed) };
-            while (job_id < max_jobs) {
-                const auto start_item{ job_id * items_per_job };
-                jit_program(memory.subspan(start_item, items_per_job), reinterpret_cast<uintptr_t>(cache_ptr), Cache_Item_Mask, start_item);
+            while (job_id < max_jobs && !stop_token.stop_requested()) {
+                const auto offset{ job_id * items_per_job };
+                jit_program(memory.subspan(offset, std::min(items_per_job, memory.size() - offset)), reinterpret_cast<uintptr_t>(cache_ptr), Cache_Item_Mask, start_item + offset);
+
+                if (progress != nullptr) {
+                    progress->finished_jobs.fetch_add(1, std::memory_order_relaxed);
+                }
+
                 job_id = job_counter.fetch_add(1, std::memory_order_relaxed);
             }
         };
 
-        // Start threads.
-        std::vector<std::thread> threads{ thread_count };
+        if (progress != nullptr) {
+            progress->finished_jobs.store(0, std::memory_order_relaxed);
+            progress->jobs_count.store(max_jobs, std::memory_order_relaxed);
+        }
+
+        // Run task on shared thread pool and wait for it to finish.
+        ThreadPool::global().parallelFor(std::min(thread_count, max_jobs), task);
+
+        return !stop_token.stop_requested();
+    }
+
+    Dataset::~Dataset() {
+        cancel();
 
-        for (uint32_t tid = 0; tid < thread_count; ++tid) {
-            threads[tid] = std::thread{ task, memory.buffer() };
+        // Generation thread references this object, so it has to finish before memory is released.
+        std::lock_guard lock{ mutex };
+        if (generation_thread.joinable()) {
+            generation_thread.join();
         }
+    }
 
-        // Wait for threads to finish.
-        for (uint64_t tid = 0; tid < thread_count; ++tid) {
-            threads[tid].join();
+    void Dataset::start(const_span<std::byte> key) {
+        std::lock_guard lock{ mutex };
+        startLocked(key);
+    }
+
+    bool Dataset::reset(const_span<std::byte> key) {
+        std::unique_lock lock{ mutex };
+        const auto state{ current_state.load(std::memory_order_acquire) };
+        const bool same_key{ std::ranges::equal(key, current_key) };
+        if (!same_key || (state != DatasetState::Ready && state != DatasetState::Generating)) {
+            startLocked(key);
         }
 
-        return memory;
+        // Waiting does not require lock, so other users can query state in the meantime.
+        const auto latest_result{ result };
+        lock.unlock();
+
+        return latest_result.get();
+    }
+
+    void Dataset::startLocked(const_span<std::byte> key) {
+        if (generation_thread.joinable()) {
+            stop_source.request_stop();
+            generation_thread.join();
+        }
+
+        stop_source = std::stop_source{};
+        dataset_progress.finished_jobs.store(0, std::memory_order_relaxed);
+        dataset_progress.jobs_count.store(0, std::memory_order_relaxed);
+        current_key.assign(key.begin(), key.end());
+        current_state.store(DatasetState::Generating, std::memory_order_release);
+
+        // Key is copied, because caller's buffer may not outlive generation.
+        auto promise{ std::make_shared<std::promise<bool>>() };
+        result = promise->get_future().share();
+
+        // Generation is not submitted to thread pool, as all of its workers may be busy with tasks that never finish (e.g. mining loops).
+        generation_thread = std::thread{ [this, promise, key{ current_key }, stop_token{ stop_source.get_token() }]() {
+            // Content is overwritten only when readers of previous one are released. State is not Ready anymore, so no new reader is created.
+            std::unique_lock content_lock{ content_mutex };
+            ++content_epoch;
+
+            try {
+                content_key = key;
+                const bool generated{ generate(key, stop_token) };
+                content_lock.unlock();
+                current_state.store(generated ? DatasetState::Ready : DatasetState::Cancelled, std::memory_order_release);
+                promise->set_value(generated);
+            } catch (...) {
+                if (content_lock.owns_lock()) {
+                    content_lock.unlock();
+                }
+
+                current_state.store(DatasetState::Failed, std::memory_order_release);
+                promise->set_exception(std::current_exception());
+            }
+        } };
+    }
+
+    void Dataset::cancel() noexcept {
+        std::lock_guard lock{ mutex };
+        stop_source.request_stop();
+    }
+
+    bool Dataset::wait() {
+        std::unique_lock lock{ mutex };
+        if (!result.valid()) {
+            return false;
+        }
+
+        const auto latest_result{ result };
+        lock.unlock();
+
+        return latest_result.get();
+    }
+
+    DatasetState Dataset::state() const noexcept {
+        return current_state.load(std::memory_order_acquire);
+    }
+
+    bool Dataset::ready(const_span<std::byte> key) const {
+        std::lock_guard lock{ mutex };
+        return state() == DatasetState::Ready && std::ranges::equal(key, current_key);
+    }
+
+    std::vector<std::byte> Dataset::key() const {
+        std::lock_guard lock{ mutex };
+        return current_key;
+    }
+
+    double Dataset::progress() const noexcept {
+        const auto jobs_count{ dataset_progress.jobs_count.load(std::memory_order_relaxed) };
+        if (jobs_count == 0) {
+            return 0.0;
+        }
+
+        return static_cast<double>(dataset_progress.finished_jobs.load(std::memory_order_relaxed)) / jobs_count;
+    }
+
+    std::optional<Dataset::Reader> Dataset::read() const noexcept {
+        if (state() != DatasetState::Ready) {
+            return std::nullopt;
+        }
+
+        // State is checked again under lock, as generation may have been started in the meantime.
+        std::shared_lock lock{ content_mutex, std::try_to_lock };
+        if (!lock.owns_lock() || state() != DatasetState::Ready) {
+            return std::nullopt;
+        }
+
+        return Reader{ *this, std::move(lock) };
+    }
+
+    Dataset::Reader::Reader(const Dataset& dataset, std::shared_lock<std::shared_mutex> lock) noexcept
+        : dataset(&dataset), lock(std::move(lock)) {
+    }
+
+    const_span<DatasetItem> Dataset::Reader::view() const noexcept {
+        return dataset->view();
+    }
+
+    const_span<std::byte> Dataset::Reader::key() const noexcept {
+        return dataset->content_key;
+    }
+
+    uint64_t Dataset::Reader::epoch() const noexcept {
+        return dataset->content_epoch;
+    }
+
+    const_span<DatasetItem> Dataset::view() const noexcept {
+        return dataset_memory.view();
+    }
+
+    const_span<argon2d::Block> Dataset::cache() const noexcept {
+        return cache_memory.view();
+    }
+
+    const_span<SuperscalarProgram, Rx_Cache_Accesses> Dataset::programs() const noexcept {
+        return superscalar_programs;
+    }
+
+    bool Dataset::generate(const_span<std::byte> key, std::stop_token stop_token) {
+        // Memory is allocated only once and reused for every following key.
+        const bool first_generation{ dataset_memory.data() == nullptr };
+        cache_memory.reserve(Rx_Argon2d_Memory_Blocks);
+        dataset_memory.reserve(datasetItemsCount());
+
+        if (stop_token.stop_requested()) {
+            return false;
+        }
+
+        // Argon2d fill is sequential, so fresh dataset memory is faulted in on separate thread (helped by free pool workers) in the meantime.
+        std::future<void> prefault_done;
+        if (first_generation) {
+            prefault_done = std::async(std::launch::async, [memory{ std::as_writable_bytes(dataset_memory.buffer()) }]() {
+                prefault(memory, ThreadPool::global());
+            });
+        }
+
+        argon2d::fillMemory(cache_memory.buffer(), key);
+        if (prefault_done.valid()) {
+            prefault_done.get();
+        }
+
+        if (stop_token.stop_requested()) {
+            return false;
+        }
+
+        blake2b::Random blakeRNG{ key, 0 };
+        Superscalar superscalar{ blakeRNG };
+
+        for (auto& program : superscalar_programs) {
+            program = superscalar.generate();
+        }
+
+        return generateDataset(dataset_memory.buffer(), cache_memory.view(), superscalar_programs, stop_token, &dataset_progress);
     }
 }
@@ -6,6 +6,16 @@
 * This is used as read-only memory by RandomX programs to calculate hashes.
 */
 
+#include <array>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
 #include "argon2d.hpp"
 #include "datasetcompiler.hpp"
 #include "heaparray.hpp"
@@ -15,6 +25,155 @@
 namespace modernRX {
     // Compiles superscalar programs and fills read-only memory used by RandomX programs to calculate hashes according to https://github.com/tevador/RandomX/blob/master/doc/specs.md#7-dataset.
     // Needs cache as an Argon2d filled memory buffer and 8 superscalar programs.
+    // Superscalar programs are compiled in given mode; both modes produce the same dataset.
     // May throw.
-    [[nodiscard]] HeapArray<DatasetItem, 4096> generateDataset(const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs);
+    [[nodiscard]] HeapArray<DatasetItem, 4096> generateDataset(const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs,
+        const DatasetCompilerMode mode = bestDatasetCompilerMode());
+
+    // Progress of in-place dataset generation. Can be read from other threads while generation is running.
+    struct DatasetProgress {
+        std::atomic<uint32_t> finished_jobs{ 0 }; // Number of dataset jobs already computed.
+        std::atomic<uint32_t> jobs_count{ 0 }; // Number of all dataset jobs; 0 until generation starts.
+    };
+
+    // Same as above, but fills caller-provided memory in place instead of allocating new one.
+    // Memory has to hold at least datasetItemsCount() items and be aligned to 64 bytes in ZMM mode; it can be reused between key changes.
+    // Generation can be cancelled through stop_token; this is checked between jobs, so cancellation is not immediate.
+    // Returns false if generation was cancelled, dataset content is incomplete then.
+    // May throw.
+    bool generateDataset(std::span<DatasetItem> memory, const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs,
+        std::stop_token stop_token = {}, DatasetProgress* progress = nullptr, const DatasetCompilerMode mode = bestDatasetCompilerMode());
+
+    // Granularity of dataset ranges accepted by generateDatasetRange. Equals the widest JIT batch, so it is valid for every DatasetCompilerMode.
+    inline constexpr uint32_t Dataset_Range_Alignment{ datasetBatchSize(DatasetCompilerMode::ZMM) };
+
+    // Fills caller-provided memory with dataset items [start_item, start_item + memory.size()). Meant for generating only a part of dataset
+    // (e.g. by cooperating processes, or to fill ranges missing in partially persisted dataset); memory[0] becomes dataset item start_item.
+    // Padding rules:
+    //   * start_item and memory.size() have to be multiples of Dataset_Range_Alignment; a range that does not follow this has to be widened by caller.
+    //   * range has to lie within [0, datasetItemsCount()); items at and beyond (Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size) / sizeof(DatasetItem)
+    //     are padding, they are computed the same way as other items, but are never read during hash calculation.
+    //   * memory has to be aligned to 64 bytes in ZMM mode.
+    // Generating all ranges of a partition of [0, datasetItemsCount()) gives the same items as generateDataset.
+    // Cancellation and progress work the same as in generateDataset. Returns false if generation was cancelled.
+    // May throw.
+    bool generateDatasetRange(std::span<DatasetItem> memory, const uint64_t start_item, const_span<argon2d::Block> cache, const_span<SuperscalarProgram, Rx_Cache_Accesses> programs,
+        std::stop_token stop_token = {}, DatasetProgress* progress = nullptr, const DatasetCompilerMode mode = bestDatasetCompilerMode());
+
+    // Returns number of items (including padding) that dataset memory has to hold. Same for every DatasetCompilerMode.
+    [[nodiscard]] uint32_t datasetItemsCount() noexcept;
+
+    // State of Dataset's latest generation.
+    enum class DatasetState : uint8_t {
+        Empty,      // Generation was never started.
+        Generating, // Generation is running.
+        Ready,      // Dataset was fully generated for key().
+        Cancelled,  // Generation was cancelled; content is incomplete.
+        Failed,     // Generation threw an exception; content is incomplete.
+    };
+
+    // Asynchronously generated dataset (Argon2d cache fill, superscalar programs generation and dataset items calculation).
+    // Owns cache, superscalar programs and dataset memory, which are allocated once and reused for every following key.
+    // Meant to be shared (through std::shared_ptr) by any number of hashers and standalone VirtualMachines, so 2GB of memory is not duplicated.
+    // Generation is driven by its own thread and is parallelized on shared thread pool with that thread taking part, so it makes progress
+    // even if all pool workers are busy (e.g. with Hasher's mining loops). All methods are thread-safe. Key of shared dataset may be changed
+    // while other users calculate hashes, as long as they read it through read(): generation does not overwrite content used by any Reader.
+    class Dataset {
+    public:
+        // Shared access to generated dataset content. Content (and key it was generated for) does not change while any Reader exists:
+        // next generation waits until all readers are released, and no new reader is created once it was requested.
+        class Reader {
+        public:
+            // Returns generated dataset.
+            [[nodiscard]] const_span<DatasetItem> view() const noexcept;
+
+            // Returns key that dataset was generated for.
+            [[nodiscard]] const_span<std::byte> key() const noexcept;
+
+            // Returns number of generation that content comes from. Differs for every generation, even with the same key.
+            [[nodiscard]] uint64_t epoch() const noexcept;
+
+        private:
+            friend class Dataset;
+
+            [[nodiscard]] explicit Reader(const Dataset& dataset, std::shared_lock<std::shared_mutex> lock) noexcept;
+
+            const Dataset* dataset;
+            std::shared_lock<std::shared_mutex> lock;
+        };
+
+        [[nodiscard]] explicit Dataset() = default;
+
+        // Cancels generation in progress and waits for it to stop.
+        ~Dataset();
+
+        Dataset(const Dataset&) = delete;
+        Dataset& operator=(const Dataset&) = delete;
+        Dataset(Dataset&&) = delete;
+        Dataset& operator=(Dataset&&) = delete;
+
+        // Starts generating dataset for given key in background and returns immediately.
+        // If previous generation is still running, it is cancelled first; buffers are reused.
+        void start(const_span<std::byte> key);
+
+        // Generates dataset for given key and waits for it, unless it is already generated or being generated for that key
+        // (e.g. by other user of shared dataset), then only waits. Returns the same as wait.
+        // Generation starts when all readers are released, so it must not be called by thread holding a Reader.
+        bool reset(const_span<std::byte> key);
+
+        // Requests cancellation of generation in progress. Cache fill is not interruptible, dataset items calculation is stopped between jobs.
+        void cancel() noexcept;
+
+        // Waits for latest generation to stop. Returns true if dataset was fully generated, false if it was cancelled or never started.
+        // Rethrows exception thrown during generation.
+        bool wait();
+
+        // Returns state of latest generation.
+        [[nodiscard]] DatasetState state() const noexcept;
+
+        // Returns true if dataset is fully generated for given key.
+        [[nodiscard]] bool ready(const_span<std::byte> key) const;
+
+        // Returns key of latest generation (empty if generation was never started).
+        [[nodiscard]] std::vector<std::byte> key() const;
+
+        // Returns fraction of dataset items calculation that is already done, in range [0, 1].
+        [[nodiscard]] double progress() const noexcept;
+
+        // Returns reader of generated dataset, or std::nullopt if dataset is not Ready (e.g. it is being generated for a new key).
+        // Does not block, so it can be called between hashes. Reader delays next generation, so it should be held only for a short time (e.g. a few hashes).
+        [[nodiscard]] std::optional<Reader> read() const noexcept;
+
+        // Returns generated dataset. Content is valid only if state() is Ready; use read() to keep it from being regenerated in the meantime.
+        [[nodiscard]] const_span<DatasetItem> view() const noexcept;
+
+        // Returns Argon2d filled memory that dataset was generated from. Content is valid only if state() is Ready.
+        [[nodiscard]] const_span<argon2d::Block> cache() const noexcept;
+
+        // Returns superscalar programs that dataset was generated with. Content is valid only if state() is Ready.
+        [[nodiscard]] const_span<SuperscalarProgram, Rx_Cache_Accesses> programs() const noexcept;
+
+    private:
+        HeapArray<argon2d::Block, 4096> cache_memory; // Argon2d filled memory. Retained between keys.
+        HeapArray<DatasetItem, 4096> dataset_memory; // Dataset memory. Retained between keys and refilled in place.
+        std::array<SuperscalarProgram, Rx_Cache_Accesses> superscalar_programs; // Programs used for dataset items calculation.
+        DatasetProgress dataset_progress; // Progress of latest generation.
+        std::atomic<DatasetState> current_state{ DatasetState::Empty }; // State of latest generation.
+
+        mutable std::shared_mutex content_mutex; // Held shared by readers and exclusively by generation while it overwrites content.
+        uint64_t content_epoch{ 0 }; // Generation that content comes from. Changed only with content_mutex held exclusively.
+        std::vector<std::byte> content_key; // Key that content was generated for. Changed only with content_mutex held exclusively.
+
+        mutable std::mutex mutex; // Guards all fields below.
+        std::vector<std::byte> current_key; // Key of latest generation.
+        std::stop_source stop_source; // Cancellation source for latest generation.
+        std::shared_future<bool> result; // Result of latest generation.
+        std::thread generation_thread; // Thread running latest generation. Joined before next generation starts.
+
+        // Starts generation. Requires locked mutex.
+        void startLocked(const_span<std::byte> key);
+
+        // Fills cache for given key, generates superscalar programs and calculates dataset items.
+        bool generate(const_span<std::byte> key, std::stop_token stop_token);
+    };
 }
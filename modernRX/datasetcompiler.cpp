@@ -5,245 +5,494 @@
 
 namespace modernRX {
     namespace {
-        [[nodiscard]] void emitAVX2Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr);
+        // ZMM code addresses data section with compressed disp8 (disp8*8) of broadcasted quadwords, so data pointer in RBX covers 2048 bytes of data.
+        constexpr int32_t Data_Window{ 1024 };
+
+        [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compileYMM(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs, const bool avx512vl);
+        [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compileZMM(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs);
+        [[nodiscard]] void emitAVX2Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr, const bool avx512vl);
+        [[nodiscard]] void emitAVX512Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr);
+        void transpose8x8(assembler::Context& asmb, const std::array<assembler::Register, 8>& rows);
+
+        // Registers that hold arguments following submemory span at JIT-compiled function entry.
+        struct Arguments {
+            assembler::Register cache_ptr;
+            assembler::Register cache_item_mask;
+            assembler::Register start_item;
+        };
+
+        [[nodiscard]] Arguments loadArguments(assembler::Context& asmb, const assembler::Register data_reg, const assembler::Register size_reg);
     }
 
-    [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compile(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs) {
-        using namespace assembler::registers;
-        using namespace assembler;
-        assembler::Context asmb(64 * 1024, 32 * 1024);
-
-        // I. Prolog
-        // 1) Push registers to stack and align it to 64 bytes boundary.
-        asmb.push(RBX, RSI, RDI, R13, R14, R15, XMM6, XMM7, XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15);
-        asmb.alignStack();
-        // 2) Declare local variable (in order: cache_indexes, cache_item_mask, v4q_add_consts, v4q_item_numbers_step).
-        asmb.sub(RSP, 0x80); // 4x ymm registers
-        // 3) Move data ptr to RBX.
-        asmb.movDataPtr(RBX);
-        // 4) Prepare const values used in step 1 of: https://github.com/tevador/RandomX/blob/master/doc/specs.md#73-dataset-block-generation
-        const auto v4q_item_numbers_add{ asmb.storeVector4q<uint64_t, RBX>(1, 2, 3, 4) }; // item_number adder - RBX[0]
-        const auto v4q_mul_consts{ asmb.storeImmediate<uint64_t, Register::YMM(0).size(), RBX>(6364136223846793005ULL) }; // mul_consts - RBX[32]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9298411001130361340ULL); // RBX[64]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(12065312585734608966ULL); // RBX[96]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9306329213124626780ULL); // RBX[128]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(5281919268842080866ULL); // RBX[160]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(10536153434571861004ULL); // RBX[192]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(3398623926847679864ULL); // RBX[224]
-        asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9549104520008361294ULL); // RBX[256]
-
-        // 5) Set buffer ptr in R10. [RCX] + 128 - pointer in span. Move pointer by 128 bytes to reduce total code size when storing dataset items.
-        asmb.mov(R10, RCX[0]);
-        asmb.add(R10, 128);
-        // 6) Set buffer size in R13. [RCX + 8] - size of submemory span.
-        //    Divide size by batch size (4) - this register is loop counter.
-        asmb.mov(R13, RCX[8]);
-        asmb.shr(R13, 2);
-        // 7) Move cache ptr to YMM6. This register will never be used for anything else.
-        asmb.vpbroadcastq(YMM6, RDX);
-        const auto& cache_ptr_reg{ YMM6 };
-
-        // 9) Initialize local variables
-        const auto cache_item_mask{ asmb.put4qVectorOnStack(R08, 32) };
-        const auto v4q_add_consts{ asmb.put4qVectorOnStack(7009800821677620404ULL, 64) }; // This value is v4q_mul_consts multiplied by 4.
-        const auto v4q_item_numbers_step{ asmb.put4qVectorOnStack(4, 96) };
-        asmb.vpbroadcastq(YMM5, R09);
-        asmb.vonereg(YMM4);
-        asmb.vpaddq(YMM5, YMM5, v4q_item_numbers_add);
-        asmb.vpsubq(YMM3, YMM5, YMM4);
-        asmb.vmovdqa(RSP[0], YMM3);
-        const auto& cache_indexes_stack{ RSP[0] };
-        const auto& cache_indexes_reg{ YMM3 };
-
-        // 10) Set initial ymmitem0 in YMM7. ymmitem0 = (v4q(start_item) + v4q_item_numbers_add) * v4q_mul_consts
-        // YMM7 will never be used for anything else.
-        asmb.vpmullq(YMM7, YMM5, v4q_mul_consts);
-
-        // II. Main loop
-        // 11) Start loop over all elements.
-        constexpr int Loop_Label{ 0 };
-        asmb.label(Loop_Label);
-
-        // 12) Set data pointer to proper offset.
-        asmb.movDataPtr(RBX, 192);
-
-        // 13) Set initial dataset item values.
-        // Uses "register-wise" layout:
-        // A0 B0 C0 D0
-        // A1 B1 C1 D1
-        // ...
-        // A7 B7 C7 D7
-        asmb.vmovdqa(YMM8, YMM7);
-        asmb.vpxor(YMM9, YMM7, RBX[-128]);
-        asmb.vpxor(YMM10, YMM7, RBX[-96]);
-        asmb.vpxor(YMM11, YMM7, RBX[-64]);
-        asmb.vpxor(YMM12, YMM7, RBX[-32]);
-        asmb.vpxor(YMM13, YMM7, RBX[0]);
-        asmb.vpxor(YMM14, YMM7, RBX[32]);
-        asmb.vpxor(YMM15, YMM7, RBX[64]);
-        int32_t data_offset{ 96 };
-
-        // 14) Execute all programs.
-        for (uint32_t i = 0; i < 8; ++i) {
-            const auto& program{ programs[i] };
-
-            // 15) Prepare registers for program execution.
-            asmb.vzeroreg(YMM5); // Zero out YMM5.
-            asmb.vmaxreg(YMM4);
-            asmb.vpsrlq(YMM4, YMM4, 32);
-
-            // 16) Set cache item indexes.
-            if (i == 0) {
-                asmb.vpand(YMM0, cache_indexes_reg, cache_item_mask);
+    [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compile(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs, const DatasetCompilerMode mode) {
+        if (mode == DatasetCompilerMode::ZMM) {
+            return compileZMM(programs);
+        }
+
+        return compileYMM(programs, mode == DatasetCompilerMode::YMM);
+    }
+
+    namespace {
+        // Compiles 4-batch code on YMM registers. If avx512vl is false, 64-bit multiplication and rotation are emulated with AVX2 instructions.
+        [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compileYMM(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs, const bool avx512vl) {
+            using namespace assembler::registers;
+            using namespace assembler;
+            // Emulated instructions take more space, so code buffer has to be larger.
+            assembler::Context asmb((avx512vl ? 64 : 128) * 1024, 32 * 1024);
+
+            // I. Prolog
+            // 1) Push registers to stack and align it to 64 bytes boundary.
+            asmb.pushCalleeSaved(RBX, RSI, RDI, R13, R14, R15, XMM6, XMM7, XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15);
+            asmb.alignStack();
+            // 2) Declare local variable (in order: cache_indexes, cache_item_mask, v4q_add_consts, v4q_item_numbers_step).
+            asmb.sub(RSP, 0x80); // 4x ymm registers
+            // 3) Move data ptr to RBX.
+            asmb.movDataPtr(RBX);
+            // 4) Prepare const values used in step 1 of: https://github.com/tevador/RandomX/blob/master/doc/specs.md#73-dataset-block-generation
+            const auto v4q_item_numbers_add{ asmb.storeVector4q<uint64_t, RBX>(1, 2, 3, 4) }; // item_number adder - RBX[0]
+            const auto v4q_mul_consts{ asmb.storeImmediate<uint64_t, Register::YMM(0).size(), RBX>(6364136223846793005ULL) }; // mul_consts - RBX[32]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9298411001130361340ULL); // RBX[64]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(12065312585734608966ULL); // RBX[96]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9306329213124626780ULL); // RBX[128]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(5281919268842080866ULL); // RBX[160]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(10536153434571861004ULL); // RBX[192]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(3398623926847679864ULL); // RBX[224]
+            asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(9549104520008361294ULL); // RBX[256]
+
+            // 5) Set buffer ptr in R10 and buffer size in R13.
+            const auto args{ loadArguments(asmb, R10, R13) };
+            //    Move pointer by 128 bytes to reduce total code size when storing dataset items.
+            asmb.add(R10, 128);
+            // 6) Divide size by batch size (4) - this register is loop counter.
+            asmb.shr(R13, 2);
+            // 7) Move cache ptr to YMM6. This register will never be used for anything else.
+            asmb.vpbroadcastq(YMM6, args.cache_ptr);
+            const auto& cache_ptr_reg{ YMM6 };
+
+            // 9) Initialize local variables
+            const auto cache_item_mask{ asmb.put4qVectorOnStack(args.cache_item_mask, 32) };
+            const auto v4q_add_consts{ asmb.put4qVectorOnStack(7009800821677620404ULL, 64) }; // This value is v4q_mul_consts multiplied by 4.
+            const auto v4q_item_numbers_step{ asmb.put4qVectorOnStack(4, 96) };
+            asmb.vpbroadcastq(YMM5, args.start_item);
+            asmb.vonereg(YMM4);
+            asmb.vpaddq(YMM5, YMM5, v4q_item_numbers_add);
+            asmb.vpsubq(YMM3, YMM5, YMM4);
+            asmb.vmovdqa(RSP[0], YMM3);
+            const auto& cache_indexes_stack{ RSP[0] };
+            const auto& cache_indexes_reg{ YMM3 };
+
+            // 10) Set initial ymmitem0 in YMM7. ymmitem0 = (v4q(start_item) + v4q_item_numbers_add) * v4q_mul_consts
+            // YMM7 will never be used for anything else.
+            if (avx512vl) {
+                asmb.vpmullq(YMM7, YMM5, v4q_mul_consts);
             } else {
-                // For programs 1-7 address register of the previous program is used.
-                const auto cache_indexes_reg_tmp{ Register::YMM(8 | programs[i - 1].address_register) };
-                asmb.vpand(YMM0, cache_indexes_reg_tmp, cache_item_mask);
+                asmb.vpmullqAvx2(YMM7, YMM5, v4q_mul_consts);
             }
 
-            // 17) Set cache item pointers.
-            static_assert(sizeof(DatasetItem) == 64);
-            asmb.vpsllq(YMM0, YMM0, static_cast<int>(std::log2(sizeof(DatasetItem)))); // Shift by 6.
-            asmb.vpaddq(YMM0, YMM0, cache_ptr_reg);
-
-            // 18) Prefetch cache items.
-            asmb.vextracti128(XMM1, YMM0, 1);
-            asmb.vpextrq(R14, XMM0, 1);
-            asmb.prefetchnta(R14[0]);
-            asmb.vmovq(RSI, XMM0);
-            asmb.prefetchnta(RSI[0]);
-            asmb.vmovq(RDI, XMM1);
-            asmb.prefetchnta(RDI[0]);
-            asmb.vpextrq(R15, XMM1, 1);
-            asmb.prefetchnta(R15[0]);
-
-            // 19) Execute every single instruction of program.
-            for (uint32_t j = 0; j < program.size; ++j) {
-                const SuperscalarInstruction& instr{ program.instructions[j] };
-                emitAVX2Instruction(asmb, data_offset, instr);
+            // II. Main loop
+            // 11) Start loop over all elements.
+            constexpr int Loop_Label{ 0 };
+            asmb.label(Loop_Label);
+
+            // 12) Set data pointer to proper offset.
+            asmb.movDataPtr(RBX, 192);
+
+            // 13) Set initial dataset item values.
+            // Uses "register-wise" layout:
+            // A0 B0 C0 D0
+            // A1 B1 C1 D1
+            // ...
+            // A7 B7 C7 D7
+            asmb.vmovdqa(YMM8, YMM7);
+            asmb.vpxor(YMM9, YMM7, RBX[-128]);
+            asmb.vpxor(YMM10, YMM7, RBX[-96]);
+            asmb.vpxor(YMM11, YMM7, RBX[-64]);
+            asmb.vpxor(YMM12, YMM7, RBX[-32]);
+            asmb.vpxor(YMM13, YMM7, RBX[0]);
+            asmb.vpxor(YMM14, YMM7, RBX[32]);
+            asmb.vpxor(YMM15, YMM7, RBX[64]);
+            int32_t data_offset{ 96 };
+
+            // 14) Execute all programs.
+            for (uint32_t i = 0; i < 8; ++i) {
+                const auto& program{ programs[i] };
+
+                // 15) Prepare registers for program execution.
+                asmb.vzeroreg(YMM5); // Zero out YMM5.
+                asmb.vmaxreg(YMM4);
+                asmb.vpsrlq(YMM4, YMM4, 32);
+
+                // 16) Set cache item indexes.
+                if (i == 0) {
+                    asmb.vpand(YMM0, cache_indexes_reg, cache_item_mask);
+                } else {
+                    // For programs 1-7 address register of the previous program is used.
+                    const auto cache_indexes_reg_tmp{ Register::YMM(8 | programs[i - 1].address_register) };
+                    asmb.vpand(YMM0, cache_indexes_reg_tmp, cache_item_mask);
+                }
+
+                // 17) Set cache item pointers.
+                static_assert(sizeof(DatasetItem) == 64);
+                asmb.vpsllq(YMM0, YMM0, static_cast<int>(std::log2(sizeof(DatasetItem)))); // Shift by 6.
+                asmb.vpaddq(YMM0, YMM0, cache_ptr_reg);
+
+                // 18) Prefetch cache items.
+                asmb.vextracti128(XMM1, YMM0, 1);
+                asmb.vpextrq(R14, XMM0, 1);
+                asmb.prefetchnta(R14[0]);
+                asmb.vmovq(RSI, XMM0);
+                asmb.prefetchnta(RSI[0]);
+                asmb.vmovq(RDI, XMM1);
+                asmb.prefetchnta(RDI[0]);
+                asmb.vpextrq(R15, XMM1, 1);
+                asmb.prefetchnta(R15[0]);
+
+                // 19) Execute every single instruction of program.
+                for (uint32_t j = 0; j < program.size; ++j) {
+                    const SuperscalarInstruction& instr{ program.instructions[j] };
+                    emitAVX2Instruction(asmb, data_offset, instr, avx512vl);
+                }
+
+                // 20) Transpose forth and back registers 0-3 and perform XOR with cache items.
+                asmb.vpunpcklqdq(YMM0, YMM8, YMM9);         // A0 A1 C0 C1
+                asmb.vpunpcklqdq(YMM1, YMM10, YMM11);       // A2 A3 C2 C3
+                asmb.vperm2i128(YMM2, YMM0, YMM1, 0x20);    // A0 A1 A2 A3
+                asmb.vperm2i128(YMM3, YMM0, YMM1, 0x31);    // C0 C1 C2 C3
+
+                asmb.vpunpckhqdq(YMM0, YMM8, YMM9);         // B0 B1 D0 D1
+                asmb.vpunpckhqdq(YMM1, YMM10, YMM11);       // B2 B3 D2 D3
+                asmb.vperm2i128(YMM4, YMM0, YMM1, 0x20);    // B0 B1 B2 B3
+                asmb.vperm2i128(YMM5, YMM0, YMM1, 0x31);    // D0 D1 D2 D3
+
+                // 21) If this is the last program do not transpose registers.
+                if (i == programs.size() - 1) {
+                    asmb.vpxor(YMM8, YMM2, RSI[0]);
+                    asmb.vpxor(YMM10, YMM3, RDI[0]);
+                    asmb.vpxor(YMM9, YMM4, R14[0]);
+                    asmb.vpxor(YMM11, YMM5, R15[0]);
+                } else {
+                    asmb.vpxor(YMM2, YMM2, RSI[0]);
+                    asmb.vpxor(YMM3, YMM3, RDI[0]);
+                    asmb.vpxor(YMM4, YMM4, R14[0]);
+                    asmb.vpxor(YMM5, YMM5, R15[0]);
+
+                    asmb.vpunpcklqdq(YMM0, YMM2, YMM4);         // A0 B0 A2 B2
+                    asmb.vpunpcklqdq(YMM1, YMM3, YMM5);         // C0 D0 C2 D2
+                    asmb.vperm2i128(YMM8, YMM0, YMM1, 0x20);    // A0 B0 C0 D0
+                    asmb.vperm2i128(YMM10, YMM0, YMM1, 0x31);   // A2 B2 C2 D2
+
+                    asmb.vpunpckhqdq(YMM0, YMM2, YMM4);         // A1 B1 A3 B3
+                    asmb.vpunpckhqdq(YMM1, YMM3, YMM5);         // C1 D1 C3 D3
+                    asmb.vperm2i128(YMM9, YMM0, YMM1, 0x20);    // A1 B1 C1 D1
+                    asmb.vperm2i128(YMM11, YMM0, YMM1, 0x31);   // A3 B3 C3 D3
+                }
+
+                // 22) Transpose forth and back registers 4-7 and perform XOR with cache items.
+                asmb.vpunpcklqdq(YMM0, YMM12, YMM13);        // A4 A5 C4 C5
+                asmb.vpunpcklqdq(YMM1, YMM14, YMM15);        // A6 A7 C6 C7
+                asmb.vperm2i128(YMM2, YMM0, YMM1, 0x20);     // A4 A5 A6 A7
+                asmb.vperm2i128(YMM3, YMM0, YMM1, 0x31);     // C4 C5 C6 C7
+
+                asmb.vpunpckhqdq(YMM0, YMM12, YMM13);        // B4 B5 D4 D5
+                asmb.vpunpckhqdq(YMM1, YMM14, YMM15);        // B6 B7 D6 D7
+                asmb.vperm2i128(YMM4, YMM0, YMM1, 0x20);     // B4 B5 B6 B7
+                asmb.vperm2i128(YMM5, YMM0, YMM1, 0x31);     // D4 D5 D6 D7
+
+
+                // 23) If this is the last program do not transpose registers.
+                if (i == programs.size() - 1) {
+                    asmb.vpxor(YMM12, YMM2, RSI[32]);
+                    asmb.vpxor(YMM14, YMM3, RDI[32]);
+                    asmb.vpxor(YMM13, YMM4, R14[32]);
+                    asmb.vpxor(YMM15, YMM5, R15[32]);
+                } else {
+                    asmb.vpxor(YMM2, YMM2, RSI[32]);
+                    asmb.vpxor(YMM3, YMM3, RDI[32]);
+                    asmb.vpxor(YMM4, YMM4, R14[32]);
+                    asmb.vpxor(YMM5, YMM5, R15[32]);
+
+                    asmb.vpunpcklqdq(YMM0, YMM2, YMM4);        // A4 B4 A6 B6    
+                    asmb.vpunpcklqdq(YMM1, YMM3, YMM5);        // C4 D4 C6 D6
+                    asmb.vperm2i128(YMM12, YMM0, YMM1, 0x20);  // A4 B4 C4 D4
+                    asmb.vperm2i128(YMM14, YMM0, YMM1, 0x31);  // A6 B6 C6 D6
+
+                    asmb.vpunpckhqdq(YMM0, YMM2, YMM4);        // A5 B5 A7 B7
+                    asmb.vpunpckhqdq(YMM1, YMM3, YMM5);        // C5 D5 C7 D7
+                    asmb.vperm2i128(YMM13, YMM0, YMM1, 0x20);  // A5 B5 C5 D5
+                    asmb.vperm2i128(YMM15, YMM0, YMM1, 0x31);  // A7 B7 C7 D7
+                }
             }
 
-            // 20) Transpose forth and back registers 0-3 and perform XOR with cache items.
-            asmb.vpunpcklqdq(YMM0, YMM8, YMM9);         // A0 A1 C0 C1
-            asmb.vpunpcklqdq(YMM1, YMM10, YMM11);       // A2 A3 C2 C3
-            asmb.vperm2i128(YMM2, YMM0, YMM1, 0x20);    // A0 A1 A2 A3
-            asmb.vperm2i128(YMM3, YMM0, YMM1, 0x31);    // C0 C1 C2 C3
-
-            asmb.vpunpckhqdq(YMM0, YMM8, YMM9);         // B0 B1 D0 D1
-            asmb.vpunpckhqdq(YMM1, YMM10, YMM11);       // B2 B3 D2 D3
-            asmb.vperm2i128(YMM4, YMM0, YMM1, 0x20);    // B0 B1 B2 B3
-            asmb.vperm2i128(YMM5, YMM0, YMM1, 0x31);    // D0 D1 D2 D3
-
-            // 21) If this is the last program do not transpose registers.
-            if (i == programs.size() - 1) {
-                asmb.vpxor(YMM8, YMM2, RSI[0]);
-                asmb.vpxor(YMM10, YMM3, RDI[0]);
-                asmb.vpxor(YMM9, YMM4, R14[0]);
-                asmb.vpxor(YMM11, YMM5, R15[0]);
-            } else {
-                asmb.vpxor(YMM2, YMM2, RSI[0]);
-                asmb.vpxor(YMM3, YMM3, RDI[0]);
-                asmb.vpxor(YMM4, YMM4, R14[0]);
-                asmb.vpxor(YMM5, YMM5, R15[0]);
-
-                asmb.vpunpcklqdq(YMM0, YMM2, YMM4);         // A0 B0 A2 B2
-                asmb.vpunpcklqdq(YMM1, YMM3, YMM5);         // C0 D0 C2 D2
-                asmb.vperm2i128(YMM8, YMM0, YMM1, 0x20);    // A0 B0 C0 D0
-                asmb.vperm2i128(YMM10, YMM0, YMM1, 0x31);   // A2 B2 C2 D2
-
-                asmb.vpunpckhqdq(YMM0, YMM2, YMM4);         // A1 B1 A3 B3
-                asmb.vpunpckhqdq(YMM1, YMM3, YMM5);         // C1 D1 C3 D3
-                asmb.vperm2i128(YMM9, YMM0, YMM1, 0x20);    // A1 B1 C1 D1
-                asmb.vperm2i128(YMM11, YMM0, YMM1, 0x31);   // A3 B3 C3 D3
+            // 24) Prepare ymmitem0 for next iteration. ymmitem0 = ymmitem0 + v4q_add_consts
+            asmb.vpaddq(YMM7, YMM7, v4q_add_consts);
+
+            // 25) Prepare cache_indexes for next iteration. cache_indexes = cache_indexes + v4q_item_numbers_step
+            asmb.vmovdqa(cache_indexes_reg, cache_indexes_stack);
+            asmb.vpaddq(cache_indexes_reg, cache_indexes_reg, v4q_item_numbers_step);
+            asmb.vmovdqa(cache_indexes_stack, cache_indexes_reg);
+
+            // 26) Store dataset items to memory.
+            asmb.vmovntdq(R10[-128], YMM8);
+            asmb.vmovntdq(R10[-96], YMM12);
+            asmb.vmovntdq(R10[-64], YMM9);
+            asmb.vmovntdq(R10[-32], YMM13);
+            asmb.vmovntdq(R10[0], YMM10);
+            asmb.vmovntdq(R10[32], YMM14);
+            asmb.vmovntdq(R10[64], YMM11);
+            asmb.vmovntdq(R10[96], YMM15);
+
+            // III. End of loop.
+            // 27) Update dataset pointer.
+            asmb.add(R10, 256);
+
+            // 28) Decrease loop counter.
+            asmb.sub(R13, 1);
+            asmb.jne(Loop_Label);
+
+            // IV. Epilogue
+            // 29) Destroy local variable (cache_indexes, cache_item_mask, v4q_add_consts, v4q_item_numbers_step).
+            asmb.add(RSP, 0x80);
+
+            // 30) Unalign stack.
+            asmb.unalignStack();
+
+            // 31) Pop registers from stack.
+            asmb.popCalleeSaved(XMM15, XMM14, XMM13, XMM12, XMM11, XMM10, XMM9, XMM8, XMM7, XMM6, R15, R14, R13, RDI, RSI, RBX);
+
+            // 32) Zero out upper 128 bits of all YMM registers.
+            asmb.vzeroupper();
+
+            // 33) Return.
+            asmb.ret();
+
+            // Make the compiled code executable and store a pointer to it in the program.
+            // Give away ownership of the code and data to the program.
+            // Data has to be flushed first, because it patches data pointers into code (argument evaluation order is unspecified).
+            auto data{ asmb.flushData() };
+            return makeExecutable<JITDatasetItemProgram>(asmb.flushCode(), std::move(data));
+        }
+
+        [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compileZMM(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs) {
+            using namespace assembler::registers;
+            using namespace assembler;
+            assembler::Context asmb(64 * 1024, 32 * 1024);
+
+            // Registers used for cache item pointers of a single batch.
+            constexpr std::array<Register, 8> cache_item_ptrs{ RSI, RDI, R11, R12, R14, R15, RAX, RCX };
+
+            // I. Prolog
+            // 1) Push registers to stack and align it to 64 bytes boundary.
+            asmb.pushCalleeSaved(RBX, RSI, RDI, R12, R13, R14, R15, XMM6, XMM7, XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15);
+            asmb.alignStack();
+            // 2) Declare local variable (cache item pointers).
+            asmb.sub(RSP, 0x40); // 1x zmm register
+            // 3) Move data ptr to RBX.
+            asmb.movDataPtr(RBX);
+            // 4) Prepare const values used in step 1 of: https://github.com/tevador/RandomX/blob/master/doc/specs.md#73-dataset-block-generation
+            const auto v8q_item_numbers_add{ asmb.storeImmediate<uint64_t, sizeof(uint64_t), RBX>(1) }; // item_number adder - RBX[0]
+            for (uint64_t i = 2; i <= 8; ++i) {
+                asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(i);
             }
+            const auto mul_const{ asmb.storeImmediate<uint64_t, sizeof(uint64_t), RBX>(6364136223846793005ULL) }; // mul_consts - RBX[64]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(9298411001130361340ULL); // RBX[72]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(12065312585734608966ULL); // RBX[80]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(9306329213124626780ULL); // RBX[88]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(5281919268842080866ULL); // RBX[96]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(10536153434571861004ULL); // RBX[104]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(3398623926847679864ULL); // RBX[112]
+            asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(9549104520008361294ULL); // RBX[120]
+
+            // 5) Set buffer ptr in R10 and buffer size in R13.
+            const auto args{ loadArguments(asmb, R10, R13) };
+            // 6) Divide size by batch size (8) - this register is loop counter.
+            asmb.shr(R13, 3);
+
+            // 7) Initialize registers that live through the whole loop:
+            //    ZMM16 - cache_ptr, ZMM17 - zmmitem0, ZMM18 - cache_indexes, ZMM19 - cache_item_mask, ZMM20 - v8q_add_consts, ZMM21 - v8q_item_numbers_step.
+            const auto& cache_ptr_reg{ ZMM16 };
+            const auto& item0_reg{ ZMM17 };
+            const auto& cache_indexes_reg{ ZMM18 };
+            const auto& cache_item_mask_reg{ ZMM19 };
+            const auto& add_consts_reg{ ZMM20 };
+            const auto& item_numbers_step_reg{ ZMM21 };
+
+            asmb.vpbroadcastq(cache_ptr_reg, args.cache_ptr);
+            asmb.vpbroadcastq(cache_item_mask_reg, args.cache_item_mask);
+            asmb.vpbroadcastq(add_consts_reg, 14019601643355240808ULL); // This value is mul_consts[0] multiplied by 8.
+            asmb.vpbroadcastq(item_numbers_step_reg, 8);
+
+            // 8) Set initial cache_indexes and zmmitem0 = (v8q(start_item) + v8q_item_numbers_add) * mul_consts[0].
+            asmb.vpbroadcastq(cache_indexes_reg, args.start_item);
+            asmb.vpaddq(item0_reg, cache_indexes_reg, v8q_item_numbers_add);
+            asmb.vpsubq(cache_indexes_reg, item0_reg, Memory::BCST(v8q_item_numbers_add)); // First item_number adder is 1.
+            asmb.vpmullq(item0_reg, item0_reg, Memory::BCST(mul_const));
+
+            // II. Main loop
+            // 9) Start loop over all elements.
+            constexpr int Loop_Label{ 0 };
+            asmb.label(Loop_Label);
+
+            // 10) Set data pointer to proper offset. mul_consts are at RBX[-Data_Window].
+            asmb.movDataPtr(RBX, mul_const.offset + Data_Window);
+
+            // 11) Set initial dataset item values.
+            // Uses "register-wise" layout (ZMM24-ZMM31 hold registers r0-r7 of 8 dataset items A-H):
+            // A0 B0 C0 D0 E0 F0 G0 H0
+            // A1 B1 C1 D1 E1 F1 G1 H1
+            // ...
+            // A7 B7 C7 D7 E7 F7 G7 H7
+            asmb.vmovdqa(ZMM24, item0_reg);
+            for (reg_idx_t i = 1; i < 8; ++i) {
+                asmb.vpxor(Register::ZMM(24 | i), item0_reg, Memory::BCST(RBX[-Data_Window + i * static_cast<int32_t>(sizeof(uint64_t))]));
+            }
+            int32_t data_offset{ -Data_Window + 8 * static_cast<int32_t>(sizeof(uint64_t)) };
+
+            // 12) Execute all programs.
+            for (uint32_t i = 0; i < 8; ++i) {
+                const auto& program{ programs[i] };
+
+                // 13) Prepare registers for program execution. 0x00000000ffffffff mask is needed by vpmulhuq emulation.
+                asmb.vmaxreg(ZMM4);
+                asmb.vpsrlq(ZMM4, ZMM4, 32);
+
+                // 14) Set cache item indexes.
+                if (i == 0) {
+                    asmb.vpand(ZMM0, cache_indexes_reg, cache_item_mask_reg);
+                } else {
+                    // For programs 1-7 address register of the previous program is used.
+                    const auto cache_indexes_reg_tmp{ Register::ZMM(24 | programs[i - 1].address_register) };
+                    asmb.vpand(ZMM0, cache_indexes_reg_tmp, cache_item_mask_reg);
+                }
 
-            // 22) Transpose forth and back registers 4-7 and perform XOR with cache items.
-            asmb.vpunpcklqdq(YMM0, YMM12, YMM13);        // A4 A5 C4 C5
-            asmb.vpunpcklqdq(YMM1, YMM14, YMM15);        // A6 A7 C6 C7
-            asmb.vperm2i128(YMM2, YMM0, YMM1, 0x20);     // A4 A5 A6 A7
-            asmb.vperm2i128(YMM3, YMM0, YMM1, 0x31);     // C4 C5 C6 C7
+                // 15) Set cache item pointers.
+                static_assert(sizeof(DatasetItem) == 64);
+                asmb.vpsllq(ZMM0, ZMM0, static_cast<int>(std::log2(sizeof(DatasetItem)))); // Shift by 6.
+                asmb.vpaddq(ZMM0, ZMM0, cache_ptr_reg);
 
-            asmb.vpunpckhqdq(YMM0, YMM12, YMM13);        // B4 B5 D4 D5
-            asmb.vpunpckhqdq(YMM1, YMM14, YMM15);        // B6 B7 D6 D7
-            asmb.vperm2i128(YMM4, YMM0, YMM1, 0x20);     // B4 B5 B6 B7
-            asmb.vperm2i128(YMM5, YMM0, YMM1, 0x31);     // D4 D5 D6 D7
+                // 16) Move cache item pointers to general purpose registers (through stack) and prefetch cache items.
+                asmb.vmovdqa(RSP[0], ZMM0);
+                for (int32_t j = 0; j < 8; ++j) {
+                    asmb.mov(cache_item_ptrs[j], RSP[j * static_cast<int32_t>(sizeof(uint64_t))]);
+                    asmb.prefetchnta(cache_item_ptrs[j][0]);
+                }
 
+                // 17) Execute every single instruction of program.
+                for (uint32_t j = 0; j < program.size; ++j) {
+                    const SuperscalarInstruction& instr{ program.instructions[j] };
+                    emitAVX512Instruction(asmb, data_offset, instr);
+                }
 
-            // 23) If this is the last program do not transpose registers.
-            if (i == programs.size() - 1) {
-                asmb.vpxor(YMM12, YMM2, RSI[32]);
-                asmb.vpxor(YMM14, YMM3, RDI[32]);
-                asmb.vpxor(YMM13, YMM4, R14[32]);
-                asmb.vpxor(YMM15, YMM5, R15[32]);
-            } else {
-                asmb.vpxor(YMM2, YMM2, RSI[32]);
-                asmb.vpxor(YMM3, YMM3, RDI[32]);
-                asmb.vpxor(YMM4, YMM4, R14[32]);
-                asmb.vpxor(YMM5, YMM5, R15[32]);
-
-                asmb.vpunpcklqdq(YMM0, YMM2, YMM4);        // A4 B4 A6 B6    
-                asmb.vpunpcklqdq(YMM1, YMM3, YMM5);        // C4 D4 C6 D6
-                asmb.vperm2i128(YMM12, YMM0, YMM1, 0x20);  // A4 B4 C4 D4
-                asmb.vperm2i128(YMM14, YMM0, YMM1, 0x31);  // A6 B6 C6 D6
-
-                asmb.vpunpckhqdq(YMM0, YMM2, YMM4);        // A5 B5 A7 B7
-                asmb.vpunpckhqdq(YMM1, YMM3, YMM5);        // C5 D5 C7 D7
-                asmb.vperm2i128(YMM13, YMM0, YMM1, 0x20);  // A5 B5 C5 D5
-                asmb.vperm2i128(YMM15, YMM0, YMM1, 0x31);  // A7 B7 C7 D7
+                // 18) Load cache items (one per row), transpose them into register-wise layout and perform XOR.
+                for (reg_idx_t j = 0; j < 8; ++j) {
+                    asmb.vmovdqu(Register::ZMM(j), cache_item_ptrs[j][0]);
+                }
+
+                transpose8x8(asmb, { ZMM0, ZMM1, ZMM2, ZMM3, ZMM4, ZMM5, ZMM6, ZMM7 });
+
+                for (reg_idx_t j = 0; j < 8; ++j) {
+                    asmb.vpxor(Register::ZMM(24 | j), Register::ZMM(24 | j), Register::ZMM(8 | j));
+                }
             }
-        }
 
-        // 24) Prepare ymmitem0 for next iteration. ymmitem0 = ymmitem0 + v4q_add_consts
-        asmb.vpaddq(YMM7, YMM7, v4q_add_consts);
+            // 19) Prepare zmmitem0 and cache_indexes for next iteration.
+            asmb.vpaddq(item0_reg, item0_reg, add_consts_reg);
+            asmb.vpaddq(cache_indexes_reg, cache_indexes_reg, item_numbers_step_reg);
+
+            // 20) Transpose dataset items back into "item-wise" layout and store them to memory.
+            //     Non-temporal stores are used, because dataset is written once and is too big to benefit from caching.
+            transpose8x8(asmb, { ZMM24, ZMM25, ZMM26, ZMM27, ZMM28, ZMM29, ZMM30, ZMM31 });
+            for (reg_idx_t j = 0; j < 8; ++j) {
+                asmb.vmovntdq(R10[j * static_cast<int32_t>(sizeof(DatasetItem))], Register::ZMM(8 | j));
+            }
 
-        // 25) Prepare cache_indexes for next iteration. cache_indexes = cache_indexes + v4q_item_numbers_step
-        asmb.vmovdqa(cache_indexes_reg, cache_indexes_stack);
-        asmb.vpaddq(cache_indexes_reg, cache_indexes_reg, v4q_item_numbers_step);
-        asmb.vmovdqa(cache_indexes_stack, cache_indexes_reg);
+            // III. End of loop.
+            // 21) Update dataset pointer.
+            asmb.add(R10, 512);
 
-        // 26) Store dataset items to memory.
-        asmb.vmovntdq(R10[-128], YMM8);
-        asmb.vmovntdq(R10[-96], YMM12);
-        asmb.vmovntdq(R10[-64], YMM9);
-        asmb.vmovntdq(R10[-32], YMM13);
-        asmb.vmovntdq(R10[0], YMM10);
-        asmb.vmovntdq(R10[32], YMM14);
-        asmb.vmovntdq(R10[64], YMM11);
-        asmb.vmovntdq(R10[96], YMM15);
+            // 22) Decrease loop counter.
+            asmb.sub(R13, 1);
+            asmb.jne(Loop_Label);
 
-        // III. End of loop.
-        // 27) Update dataset pointer.
-        asmb.add(R10, 256);
+            // IV. Epilogue
+            // 23) Destroy local variable (cache item pointers).
+            asmb.add(RSP, 0x40);
 
-        // 28) Decrease loop counter.
-        asmb.sub(R13, 1);
-        asmb.jne(Loop_Label);
+            // 24) Unalign stack.
+            asmb.unalignStack();
 
-        // IV. Epilogue
-        // 29) Destroy local variable (cache_indexes, cache_item_mask, v4q_add_consts, v4q_item_numbers_step).
-        asmb.add(RSP, 0x80);
+            // 25) Pop registers from stack.
+            asmb.popCalleeSaved(XMM15, XMM14, XMM13, XMM12, XMM11, XMM10, XMM9, XMM8, XMM7, XMM6, R15, R14, R13, R12, RDI, RSI, RBX);
 
-        // 30) Unalign stack.
-        asmb.unalignStack();
+            // 26) Zero out upper bits of all YMM/ZMM registers.
+            asmb.vzeroupper();
 
-        // 31) Pop registers from stack.
-        asmb.pop(XMM15, XMM14, XMM13, XMM12, XMM11, XMM10, XMM9, XMM8, XMM7, XMM6, R15, R14, R13, RDI, RSI, RBX);
+            // 27) Return.
+            asmb.ret();
 
-        // 32) Zero out upper 128 bits of all YMM registers.
-        asmb.vzeroupper();
+            // Make the compiled code executable and store a pointer to it in the program.
+            // Give away ownership of the code and data to the program.
+            // Data has to be flushed first, because it patches data pointers into code (argument evaluation order is unspecified).
+            auto data{ asmb.flushData() };
+            return makeExecutable<JITDatasetItemProgram>(asmb.flushCode(), std::move(data));
+        }
 
-        // 33) Return.
-        asmb.ret();
+        // Moves submemory span pointer into data_reg and its size into size_reg. Returns registers holding remaining arguments.
+        // Win64 passes span as a pointer to caller's copy, System V passes it by value in two registers.
+        // Must be called before any argument register is overwritten.
+        Arguments loadArguments(assembler::Context& asmb, const assembler::Register data_reg, const assembler::Register size_reg) {
+            if (asmb.callingConvention() == assembler::CallingConvention::Win64) {
+                const auto span_reg{ asmb.argument(0) };
+                asmb.mov(data_reg, span_reg[0]);
+                asmb.mov(size_reg, span_reg[8]);
+                return Arguments{ asmb.argument(1), asmb.argument(2), asmb.argument(3) };
+            }
 
-        // Make the compiled code executable and store a pointer to it in the program.
-        // Give away ownership of the code and data to the program.
-        return makeExecutable<JITDatasetItemProgram>(asmb.flushCode(), asmb.flushData());
-    }
+            asmb.mov(data_reg, asmb.argument(0));
+            asmb.mov(size_reg, asmb.argument(1));
+            return Arguments{ asmb.argument(2), asmb.argument(3), asmb.argument(4) };
+        }
+
+        // Transposes 8x8 quadword matrix held in rows registers into ZMM8-ZMM15 (ZMM8 holds first column).
+        // Uses ZMM0-ZMM15 registers; rows registers may be ZMM0-ZMM7 or ZMM16-ZMM31.
+        void transpose8x8(assembler::Context& asmb, const std::array<assembler::Register, 8>& rows) {
+            using namespace assembler::registers;
+
+            // Rows: A, B, C, D, E, F, G, H. Columns: 0-7.
+            // 1) Interleave quadwords of adjacent rows.
+            asmb.vpunpcklqdq(ZMM8, rows[0], rows[1]);       // A0 B0 A2 B2 A4 B4 A6 B6
+            asmb.vpunpckhqdq(ZMM9, rows[0], rows[1]);       // A1 B1 A3 B3 A5 B5 A7 B7
+            asmb.vpunpcklqdq(ZMM10, rows[2], rows[3]);      // C0 D0 C2 D2 C4 D4 C6 D6
+            asmb.vpunpckhqdq(ZMM11, rows[2], rows[3]);      // C1 D1 C3 D3 C5 D5 C7 D7
+            asmb.vpunpcklqdq(ZMM12, rows[4], rows[5]);      // E0 F0 E2 F2 E4 F4 E6 F6
+            asmb.vpunpckhqdq(ZMM13, rows[4], rows[5]);      // E1 F1 E3 F3 E5 F5 E7 F7
+            asmb.vpunpcklqdq(ZMM14, rows[6], rows[7]);      // G0 H0 G2 H2 G4 H4 G6 H6
+            asmb.vpunpckhqdq(ZMM15, rows[6], rows[7]);      // G1 H1 G3 H3 G5 H5 G7 H7
+
+            // 2) Gather even and odd 128-bit lanes of row pairs.
+            asmb.vshufi64x2(ZMM0, ZMM8, ZMM10, 0x88);       // A0 B0 A4 B4 C0 D0 C4 D4
+            asmb.vshufi64x2(ZMM1, ZMM9, ZMM11, 0x88);       // A1 B1 A5 B5 C1 D1 C5 D5
+            asmb.vshufi64x2(ZMM2, ZMM8, ZMM10, 0xdd);       // A2 B2 A6 B6 C2 D2 C6 D6
+            asmb.vshufi64x2(ZMM3, ZMM9, ZMM11, 0xdd);       // A3 B3 A7 B7 C3 D3 C7 D7
+            asmb.vshufi64x2(ZMM4, ZMM12, ZMM14, 0x88);      // E0 F0 E4 F4 G0 H0 G4 H4
+            asmb.vshufi64x2(ZMM5, ZMM13, ZMM15, 0x88);      // E1 F1 E5 F5 G1 H1 G5 H5
+            asmb.vshufi64x2(ZMM6, ZMM12, ZMM14, 0xdd);      // E2 F2 E6 F6 G2 H2 G6 H6
+            asmb.vshufi64x2(ZMM7, ZMM13, ZMM15, 0xdd);      // E3 F3 E7 F7 G3 H3 G7 H7
+
+            // 3) Gather even and odd 128-bit lanes again to get full columns.
+            asmb.vshufi64x2(ZMM8, ZMM0, ZMM4, 0x88);        // A0 B0 C0 D0 E0 F0 G0 H0
+            asmb.vshufi64x2(ZMM9, ZMM1, ZMM5, 0x88);        // A1 B1 C1 D1 E1 F1 G1 H1
+            asmb.vshufi64x2(ZMM10, ZMM2, ZMM6, 0x88);       // A2 B2 C2 D2 E2 F2 G2 H2
+            asmb.vshufi64x2(ZMM11, ZMM3, ZMM7, 0x88);       // A3 B3 C3 D3 E3 F3 G3 H3
+            asmb.vshufi64x2(ZMM12, ZMM0, ZMM4, 0xdd);       // A4 B4 C4 D4 E4 F4 G4 H4
+            asmb.vshufi64x2(ZMM13, ZMM1, ZMM5, 0xdd);       // A5 B5 C5 D5 E5 F5 G5 H5
+            asmb.vshufi64x2(ZMM14, ZMM2, ZMM6, 0xdd);       // A6 B6 C6 D6 E6 F6 G6 H6
+            asmb.vshufi64x2(ZMM15, ZMM3, ZMM7, 0xdd);       // A7 B7 C7 D7 E7 F7 G7 H7
+        }
 
-    namespace {
         // Translates every single superscalar instruction into native code using AVX2.
         // data_offset is used to track data section offset. If 256 bytes of data section is used, data pointer in RBX is moved to next 256 bytes. This is for reducing total code size.
-        void emitAVX2Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr) {
+        // avx512vl selects native AVX512VL/DQ instructions for 64-bit multiplication and rotation; otherwise they are emulated.
+        void emitAVX2Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr, const bool avx512vl) {
             using namespace assembler::registers;
             using namespace assembler;
 
@@ -284,10 +533,18 @@ namespace modernRX {
                 asmb.vpxor(dst, dst, src);
                 break;
             case SuperscalarInstructionType::IROR_C:
-                asmb.vprorq(dst, dst, instr.imm32);
+                if (avx512vl) {
+                    asmb.vprorq(dst, dst, instr.imm32);
+                } else {
+                    asmb.vprorqAvx2(dst, dst, instr.imm32);
+                }
                 break;
             case SuperscalarInstructionType::IMUL_R:
-                asmb.vpmullq(dst, dst, src);
+                if (avx512vl) {
+                    asmb.vpmullq(dst, dst, src);
+                } else {
+                    asmb.vpmullqAvx2(dst, dst, src);
+                }
                 break;
             case SuperscalarInstructionType::ISMULH_R:
                 asmb.vpmulhq(dst, src);
@@ -298,7 +555,11 @@ namespace modernRX {
             case SuperscalarInstructionType::IMUL_RCP:
             {
                 asmb.storeImmediate<uint64_t, Register::YMM(0).size()>(instr.reciprocal);
-                asmb.vpmullq(dst, dst, RBX[data_offset]);
+                if (avx512vl) {
+                    asmb.vpmullq(dst, dst, RBX[data_offset]);
+                } else {
+                    asmb.vpmullqAvx2(dst, dst, RBX[data_offset]);
+                }
                 data_offset += 32;
                 break;
             }
@@ -311,5 +572,77 @@ namespace modernRX {
                 asmb.add(RBX, 256);
             }
         }
+
+        // Translates every single superscalar instruction into native code using AVX512 on ZMM registers.
+        // Immediate values are stored as single quadwords and broadcasted to all elements with embedded broadcast.
+        // data_offset is used to track data section offset. If whole data window is used, data pointer in RBX is moved to the next one. This is for reducing total code size.
+        void emitAVX512Instruction(assembler::Context& asmb, int32_t& data_offset, const SuperscalarInstruction& instr) {
+            using namespace assembler::registers;
+            using namespace assembler;
+
+            const Register dst{ Register::ZMM(instr.dst_register | 24) };
+            Register src{ Register::ZMM(instr.src_register.has_value() ? instr.src_register.value() | 24 : static_cast<reg_idx_t>(0)) };
+
+            switch (instr.type()) {
+            case SuperscalarInstructionType::IADD_C7: [[fallthrough]];
+            case SuperscalarInstructionType::IADD_C8: [[fallthrough]];
+            case SuperscalarInstructionType::IADD_C9:
+            {
+                asmb.storeImmediate<int64_t, sizeof(int64_t)>(static_cast<int64_t>(static_cast<int32_t>(instr.imm32))); // Store 2's complement of immediate value.
+                asmb.vpaddq(dst, dst, Memory::BCST(RBX[data_offset]));
+                data_offset += sizeof(int64_t);
+                break;
+            }
+            case SuperscalarInstructionType::IXOR_C7: [[fallthrough]];
+            case SuperscalarInstructionType::IXOR_C8: [[fallthrough]];
+            case SuperscalarInstructionType::IXOR_C9:
+            {
+                asmb.storeImmediate<int64_t, sizeof(int64_t)>(static_cast<int64_t>(static_cast<int32_t>(instr.imm32))); // Store 2's complement of immediate value.
+                asmb.vpxor(dst, dst, Memory::BCST(RBX[data_offset]));
+                data_offset += sizeof(int64_t);
+                break;
+            }
+            case SuperscalarInstructionType::IADD_RS:
+                if (instr.modShift() > 0) {
+                    asmb.vpsllq(ZMM0, src, instr.modShift());
+                    src = ZMM0;
+                }
+
+                asmb.vpaddq(dst, dst, src);
+                break;
+            case SuperscalarInstructionType::ISUB_R:
+                asmb.vpsubq(dst, dst, src);
+                break;
+            case SuperscalarInstructionType::IXOR_R:
+                asmb.vpxor(dst, dst, src);
+                break;
+            case SuperscalarInstructionType::IROR_C:
+                asmb.vprorq(dst, dst, instr.imm32);
+                break;
+            case SuperscalarInstructionType::IMUL_R:
+                asmb.vpmullq(dst, dst, src);
+                break;
+            case SuperscalarInstructionType::ISMULH_R:
+                asmb.vpmulhq(dst, src);
+                break;
+            case SuperscalarInstructionType::IMULH_R:
+                asmb.vpmulhuq(dst, dst, src);
+                break;
+            case SuperscalarInstructionType::IMUL_RCP:
+            {
+                asmb.storeImmediate<uint64_t, sizeof(uint64_t)>(instr.reciprocal);
+                asmb.vpmullq(dst, dst, Memory::BCST(RBX[data_offset]));
+                data_offset += sizeof(uint64_t);
+                break;
+            }
+            default:
+                std::unreachable();
+            }
+
+            if (data_offset == Data_Window) {
+                data_offset = -Data_Window;
+                asmb.add(RBX, 2 * Data_Window);
+            }
+        }
     }
 }
@@ -2,12 +2,14 @@
 
 /*
 * JIT Compiler for RandomX's Superscalar programs.
-* Compiler uses AVX2 instructions. 
+* Compiler uses AVX2 instructions (with AVX512VL/DQ extensions) on YMM registers or AVX512 instructions on ZMM registers.
+* On CPUs without AVX512 support, AVX2 mode emulates 64-bit multiplication and rotation.
 */
 
 #include <span>
 #include <vector>
 
+#include "isa.hpp"
 #include "randomxparams.hpp"
 #include "virtualmem.hpp"
 
@@ -18,16 +20,35 @@ namespace modernRX {
     using DatasetItem = std::array<uint64_t, 8>;
     static_assert(sizeof(DatasetItem) == 64);
 
+    // Selects registers width of JIT-compiled code.
+    enum class DatasetCompilerMode : uint8_t {
+        YMM, // 4-batch of dataset items per loop iteration.
+        ZMM, // 8-batch of dataset items per loop iteration; uses opmask registers and 64-byte non-temporal stores.
+        AVX2, // 4-batch of dataset items per loop iteration; like YMM, but without AVX512VL/DQ extensions.
+    };
+
+    // Returns the fastest mode supported by selected instruction set.
+    [[nodiscard]] inline DatasetCompilerMode bestDatasetCompilerMode() noexcept {
+        return selectedIsa() == Isa::AVX512 ? DatasetCompilerMode::ZMM : DatasetCompilerMode::AVX2;
+    }
+
+    // Returns number of dataset items computed in single loop iteration of code compiled in given mode.
+    // Submemory passed to JIT-compiled function has to hold a multiple of this number of items.
+    [[nodiscard]] constexpr uint32_t datasetBatchSize(const DatasetCompilerMode mode) noexcept {
+        return mode == DatasetCompilerMode::ZMM ? 8 : 4;
+    }
+
     // RCX - submemory span, RDX - cache_ptr, R8 - cache_item_mask, R9 - start_item
     using JITDatasetItemProgram = void(*)(std::span<DatasetItem> submemory, const uint64_t cache_ptr, const uint64_t cache_item_mask, const uint64_t start_item);
 
-    // JIT-compile superscalar programs into a 4-batch DatasetItem generation function.
+    // JIT-compile superscalar programs into a 4-batch (YMM, AVX2) or 8-batch (ZMM) DatasetItem generation function.
     // Important to note: 
     //   * prologue includes pushing registers following the x64 Windows calling convention.
     //   * prologue includes aligning stack to 64 bytes.
     //   * prologue initializes some variables on stack and puts immediate values into data section.
     //   * epilogue includes popping registers, unaligning stack, zeroing upper AVX registers bits and returning.
     //   * compilation does apply to dataset item initialization and finalization; it JIT-compiles superscalar programs into whole function.
+    //   * in ZMM mode submemory has to be aligned to 64 bytes, because dataset items are written with non-temporal stores.
     //   * expects arguments passed to function: RCX - submemory span, RDX - cache_ptr, R8 - cache_item_mask, R9 - start_item
     // Whole program will look like this:
     // JitProgram(submemory, cache_ptr, cache_item_mask, start_item):  
@@ -37,11 +58,12 @@ namespace modernRX {
     //   store immediate values and initialize stack variables
     //   set dataset pointer and loop counter
     //   start loop over whole submemory:
-    //     initialize 4-batch of dataset items
+    //     initialize 4-batch (8-batch) of dataset items
     //     JIT-compile 1st program  (prefetch cache items -> execute all program instructions -> tranpose dataset items to xor with cache_items -> transpose back)
     //     JIT-compile 2nd program
     //     ...
     //     JIT-compile last program ( ... -> ... -> ... -> instead of transposing back, store dataset items to submemory)
+    //     (ZMM mode: cache items are transposed instead of dataset items and dataset items are transposed only once before storing)
     //     update some variables for next iteration
     //     decrease loop counter
     //   destroy stack variables
@@ -53,5 +75,5 @@ namespace modernRX {
     // After compilation, sets the code buffer as executable and returns a function pointer.
     // May throw.
 
-    [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compile(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs);
+    [[nodiscard]] jit_function_ptr<JITDatasetItemProgram> compile(const_span<SuperscalarProgram, Rx_Cache_Accesses> programs, const DatasetCompilerMode mode = bestDatasetCompilerMode());
 }
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "blake2b.hpp"
+#include "exception.hpp"
+#include "hashcache.hpp"
+
+namespace modernRX {
+    HashCache::HashCache(const size_t capacity)
+        : shards(std::make_unique<Shard[]>(Shards_Count)) {
+        if (capacity == 0) {
+            throw Exception{ "HashCache capacity has to be greater than 0" };
+        }
+
+        const size_t entries_per_shard{ (capacity + Shards_Count - 1) / Shards_Count };
+        for (uint32_t i = 0; i < Shards_Count; ++i) {
+            shards[i].entries.resize(entries_per_shard);
+        }
+    }
+
+    HashCache::Digest HashCache::digest(const_span<std::byte> data) noexcept {
+        Digest output;
+        blake2b::hashAny(output, data);
+        return output;
+    }
+
+    std::optional<RxHash> HashCache::find(const Digest& key, const Digest& input) noexcept {
+        auto [shard, entry] { slot(input) };
+
+        std::lock_guard lock{ shard.mutex };
+        if (entry.valid && entry.input == input && entry.key == key) {
+            ++shard.stats.hits;
+            return entry.hash;
+        }
+
+        ++shard.stats.misses;
+        return std::nullopt;
+    }
+
+    void HashCache::insert(const Digest& key, const Digest& input, const RxHash& hash) noexcept {
+        auto [shard, entry] { slot(input) };
+
+        std::lock_guard lock{ shard.mutex };
+        entry = Entry{ key, input, hash, true };
+    }
+
+    HashCacheStats HashCache::stats() const noexcept {
+        HashCacheStats total;
+        for (uint32_t i = 0; i < Shards_Count; ++i) {
+            std::lock_guard lock{ shards[i].mutex };
+            total.hits += shards[i].stats.hits;
+            total.misses += shards[i].stats.misses;
+        }
+
+        return total;
+    }
+
+    void HashCache::clear() noexcept {
+        for (uint32_t i = 0; i < Shards_Count; ++i) {
+            std::lock_guard lock{ shards[i].mutex };
+            std::ranges::fill(shards[i].entries, Entry{});
+            shards[i].stats = HashCacheStats{};
+        }
+    }
+
+    std::pair<HashCache::Shard&, HashCache::Entry&> HashCache::slot(const Digest& input) const noexcept {
+        // Digest bytes are uniformly distributed, so first byte selects shard and next eight select entry within shard.
+        auto& shard{ shards[std::to_integer<uint32_t>(input[0]) % Shards_Count] };
+
+        uint64_t index;
+        std::memcpy(&index, input.data() + 1, sizeof(index));
+        return { shard, shard.entries[index % shard.entries.size()] };
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+* Bounded cache of already calculated RandomX hashes, meant for verification of inputs that are often checked more than once
+* (resubmitted shares, blocks relayed by multiple peers). Consulting it costs a single Blake2b hash of the input instead of full RandomX hash.
+* Entries are keyed by digests of key (seed) and input, so hashes calculated with different keys may live in the same cache.
+* Table is split into independently locked shards and preallocated at construction; colliding entries simply overwrite each other.
+* Not a part of RandomX algorithm.
+*/
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "aliases.hpp"
+#include "hash.hpp"
+
+namespace modernRX {
+    // Hit and miss counters of HashCache.
+    struct HashCacheStats {
+        uint64_t hits{ 0 };
+        uint64_t misses{ 0 };
+
+        // Returns fraction of lookups that were served from cache, in range [0, 1].
+        [[nodiscard]] double hitRate() const noexcept {
+            const auto lookups{ hits + misses };
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+        }
+    };
+
+    class HashCache {
+    public:
+        using Digest = std::array<std::byte, 32>;
+
+        // Allocates cache able to hold given number of entries (rounded up to multiple of shards count). Throws if capacity is 0.
+        [[nodiscard]] explicit HashCache(const size_t capacity);
+
+        HashCache(const HashCache&) = delete;
+        HashCache& operator=(const HashCache&) = delete;
+        HashCache(HashCache&&) = delete;
+        HashCache& operator=(HashCache&&) = delete;
+
+        // Returns Blake2b digest of given data (key or input of any size) that identifies it in cache.
+        [[nodiscard]] static Digest digest(const_span<std::byte> data) noexcept;
+
+        // Returns hash stored for given key and input digests, if there is any. Updates hit/miss counters.
+        [[nodiscard]] std::optional<RxHash> find(const Digest& key, const Digest& input) noexcept;
+
+        // Stores hash calculated for given key and input digests, replacing entry that occupied the same slot.
+        void insert(const Digest& key, const Digest& input, const RxHash& hash) noexcept;
+
+        // Returns hit/miss counters collected since construction or last clear.
+        [[nodiscard]] HashCacheStats stats() const noexcept;
+
+        // Removes all entries and resets counters.
+        void clear() noexcept;
+
+    private:
+        struct Entry {
+            Digest key;
+            Digest input;
+            RxHash hash;
+            bool valid{ false };
+        };
+
+        // Each shard is aligned to cache line, so locking one shard does not invalidate its neighbours.
+        // Counters are kept per shard, so lookups do not contend on single shared counter.
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            std::vector<Entry> entries;
+            HashCacheStats stats;
+        };
+
+        static constexpr uint32_t Shards_Count{ 16 };
+
+        std::unique_ptr<Shard[]> shards;
+
+        // Returns entry slot for given input digest. Input digest is uniformly distributed, so its bytes are used directly.
+        [[nodiscard]] std::pair<Shard&, Entry&> slot(const Digest& input) const noexcept;
+    };
+}
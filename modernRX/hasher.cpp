@@ -1,26 +1,36 @@
 #include <algorithm>
-#include <iterator>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 #include "argon2d.hpp"
+#include "blake2b.hpp"
 #include "cpuinfo.hpp"
+#include "cpupressure.hpp"
 #include "datasetcompiler.hpp"
 #include "exception.hpp"
 #include "hasher.hpp"
 #include "randomxparams.hpp"
 #include "superscalar.hpp"
 #include "thread.hpp"
-
-#include "virtualmachineprogram.cpp"
+#include "threadpool.hpp"
 
 namespace modernRX {
-    Hasher::Hasher() {
+    Hasher::Hasher() :
+        Hasher(std::make_shared<Dataset>()) {
+    }
+
+    Hasher::Hasher(std::shared_ptr<Dataset> dataset) :
+        dataset(std::move(dataset)) {
+        if (this->dataset == nullptr) {
+            throw Exception{ "Dataset cannot be null" };
+        }
+
         checkCPU();
 
-        // If hyper-threading is enabled, use half of available threads.
-        // Possibly it would be better to use L3 cache size to calculate number of threads.
-        const auto threads{ CPUInfo::HTT() ? std::thread::hardware_concurrency() / 2 : std::thread::hardware_concurrency() };
+        // Use one thread per physical core, but no more than L3 caches can hold scratchpads for.
+        const auto threads{ optimalThreads() };
         vms.reserve(threads);
-        vm_workers.reserve(vms.size());
 
         // Allocate memory for VMs.
         constexpr auto Vm_Required_Memory{ VirtualMachine::requiredMemory() };
@@ -28,13 +38,16 @@ namespace modernRX {
         constexpr auto Total_Vm_Memory{ Vm_Required_Memory + Offset };
         scratchpads.reserve(threads * Total_Vm_Memory);
 
-        jit = makeExecutable<JITRxProgram>(threads * sizeof(Code_Buffer));
+        constexpr auto Vm_Required_Code_Memory{ VirtualMachine::requiredCodeMemory() };
+        jit = DualMappedMemory(threads * Vm_Required_Code_Memory);
 
         for (uint32_t i = 0; i < threads; ++i) {
             const auto vm_scratchpad{ scratchpads.buffer<Vm_Required_Memory>(i * Total_Vm_Memory, Vm_Required_Memory) };
-            const auto vm_jit_buffer{ reinterpret_cast<JITRxProgram>(reinterpret_cast<char*>(jit.get()) + i * sizeof(Code_Buffer)) };
+            const JITRxBuffer vm_jit_buffer{ jit.writable(i * Vm_Required_Code_Memory), jit.executable<JITRxProgram>(i * Vm_Required_Code_Memory) };
             vms.emplace_back(vm_scratchpad, vm_jit_buffer, i);
         }
+
+        active_vms.store(threads, std::memory_order_relaxed);
     }
 
     Hasher::Hasher(const_span<std::byte> key) :
@@ -44,72 +57,337 @@ namespace modernRX {
     }
 
     Hasher::~Hasher() {
+        stopElastic();
         stop();
     }
 
     uint64_t Hasher::hashes() const noexcept {
-        uint64_t hashes{ 0 };
-        for (const auto& vm : vms) {
-            hashes += vm.getPData().hashes;
-        }
+        return total_hashes.load(std::memory_order_relaxed);
+    }
 
-        return hashes;
+    uint64_t Hasher::hashes(const JobId job_id) const {
+        std::lock_guard lock{ jobs_mutex };
+        const auto it{ std::ranges::find(jobs, job_id, [](const auto& job) { return job->id; }) };
+        return it != jobs.end() ? (*it)->hashes.load(std::memory_order_relaxed) : 0;
     }
 
-    void Hasher::run(std::function<void(const RxHash&)> callback) {
+    void Hasher::run(Callback callback) {
         bool expected{ false };
-        if (!vm_workers.empty() || !running.compare_exchange_strong(expected, true)) {
+        if (active_vm_workers.load(std::memory_order_acquire) != 0 || !running.compare_exchange_strong(expected, true)) {
             // Already running.
             return;
         }
 
-        std::atomic<size_t> vm_init{ 0 };
+        // Pool workers are pinned to physical cores first, so VM with given id is placed on its own core.
+        auto& pool{ ThreadPool::global() };
+        if (!pool.pinned() || pool.size() < vms.size()) {
+            running.store(false);
+            throw modernRX::Exception("Failed to initialize VirtualMachine worker threads");
+        }
+
+        this->callback = std::move(callback);
+        active_vm_workers.store(static_cast<uint32_t>(vms.size()), std::memory_order_release);
 
         for (uint32_t vm_id = 0; vm_id < vms.size(); ++vm_id) {
-            vm_workers.emplace_back([&vm_init, callback, vm_id, this]() {
-                vm_init.fetch_add(1, std::memory_order_relaxed);
+            pool.submitTo(vm_id, [vm_id, this]() {
+                work(vm_id);
 
-                if (!setThreadAffinity(vm_id)) {
-                    vm_init.fetch_add(vms.size(), std::memory_order_relaxed);
-                    return;
+                if (active_vm_workers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    active_vm_workers.notify_all();
                 }
+            });
+        }
+    }
 
-                auto& vm{ vms[vm_id] };
-                while (this->running) {
-                    vm.execute(callback);
+    void Hasher::work(const uint32_t vm_id) {
+        // Number of hashes calculated for a job before VM is scheduled again. Switching job costs scratchpad initialization
+        // (and discards scratchpad already filled for the next nonce), which is about 1% of a slice of this length.
+        constexpr uint32_t Slice_Hashes{ 16 };
+
+        // Time to wait before next scheduling attempt if no job has generated dataset.
+        constexpr auto Idle_Wait{ std::chrono::milliseconds(10) };
+
+        auto& vm{ vms[vm_id] };
+        std::shared_ptr<Job> job;
+        uint32_t revision{ 0 };
+        uint64_t epoch{ 0 }; // Dataset generation that VM was reset with.
+        bool idle{ false };
+
+        while (waitUnparked(vm_id)) {
+            // Priority is changed only by the worker itself, as pool threads are not owned by Hasher.
+            if (const bool want_idle{ idle_priority.load(std::memory_order_relaxed) }; want_idle != idle) {
+                idle = want_idle ? setThreadIdlePriority() : !setThreadNormalPriority();
+            }
+
+            auto slice{ nextSlice(vm_id, job.get()) };
+            if (slice.job == nullptr) {
+                job.reset();
+                std::this_thread::sleep_for(Idle_Wait);
+                continue;
+            }
+
+            // Dataset is shared and may be regenerated by other user. Reader is held for the whole slice, so regeneration waits until slice ends
+            // and no hash is calculated from partially rewritten dataset. If regeneration has just started, job is skipped by next scheduling.
+            const auto reader{ slice.job->dataset->read() };
+            if (!reader.has_value()) {
+                continue;
+            }
+
+            // VM continues where it stopped if the same job, block template and dataset is picked, so no reinitialization is needed.
+            if (slice.job != job || slice.revision != revision || reader->epoch() != epoch) {
+                job = std::move(slice.job);
+                revision = slice.revision;
+                epoch = reader->epoch();
+
+                if (slice.cursor.seeded) {
+                    vm.reset(slice.cursor.block_template, reader->view(), slice.cursor.seed);
+                } else {
+                    vm.reset(slice.cursor.block_template, reader->view());
                 }
-            });
+
+                vm.execute(nullptr); // First 'execute' after reset does only initialization.
+            }
+
+            const auto& job_callback{ job->callback ? job->callback : callback };
+            for (uint32_t i = 0; i < Slice_Hashes; ++i) {
+                vm.execute(job_callback);
+            }
+
+            job->hashes.fetch_add(Slice_Hashes, std::memory_order_relaxed);
+            total_hashes.fetch_add(Slice_Hashes, std::memory_order_relaxed);
+
+            // Cursor is moved past hashed nonces, unless block template changed in the meantime.
+            std::lock_guard lock{ jobs_mutex };
+            if (job->revision == revision) {
+                auto& cursor{ job->cursors[vm_id] };
+                cursor.block_template.next(Slice_Hashes);
+                cursor.seeded = false;
+            }
         }
 
-        // Wait for worker threads to initialize.
-        while (vm_init.load(std::memory_order_relaxed) < vms.size()) {
-            std::this_thread::yield();
+        // Pool thread is reused by other tasks, so its priority is restored.
+        if (idle) {
+            setThreadNormalPriority();
         }
+    }
 
-        // If any thread failed to initialize, stop and throw exception.
-        if (vm_init.load(std::memory_order_relaxed) > vms.size()) {   
-            stop();
-            throw modernRX::Exception("Failed to initialize VirtualMachine worker threads");
+    bool Hasher::waitUnparked(const uint32_t vm_id) noexcept {
+        bool parked{ false };
+        bool unparked{ false };
+        while (running.load(std::memory_order_relaxed)) {
+            // Epoch is read before state is checked, so wake up between check and wait is not lost.
+            const auto epoch{ park_epoch.load(std::memory_order_acquire) };
+            if (vm_id < active_vms.load(std::memory_order_acquire)) {
+                unparked = true;
+                break;
+            }
+
+            if (!parked) {
+                parked = true;
+                parked_vms.fetch_add(1, std::memory_order_release);
+            }
+
+            park_epoch.wait(epoch, std::memory_order_acquire);
+        }
+
+        if (parked) {
+            parked_vms.fetch_sub(1, std::memory_order_release);
+        }
+
+        return unparked;
+    }
+
+    void Hasher::wakeParked() noexcept {
+        park_epoch.fetch_add(1, std::memory_order_acq_rel);
+        park_epoch.notify_all();
+    }
+
+    void Hasher::setActiveVMs(const uint32_t count) noexcept {
+        active_vms.store(std::min(count, maxVMs()), std::memory_order_release);
+        wakeParked();
+    }
+
+    uint32_t Hasher::activeVMs() const noexcept {
+        return active_vms.load(std::memory_order_acquire);
+    }
+
+    uint32_t Hasher::parkedVMs() const noexcept {
+        return parked_vms.load(std::memory_order_acquire);
+    }
+
+    uint32_t Hasher::maxVMs() const noexcept {
+        return static_cast<uint32_t>(vms.size());
+    }
+
+    void Hasher::startElastic(const ElasticOptions& options) {
+        if (options.park_pressure < 0.0 || options.park_pressure > 1.0 || options.unpark_pressure < 0.0 || options.unpark_pressure > options.park_pressure) {
+            throw Exception{ "Invalid pressure thresholds" };
+        }
+
+        stopElastic();
+        idle_priority.store(options.idle_priority, std::memory_order_relaxed);
+
+        elastic_thread = std::jthread{ [this, options](std::stop_token stop_token) {
+            CpuPressure pressure;
+            const auto sample = [&options, &pressure]() {
+                return options.pressure_source ? options.pressure_source() : pressure.sample();
+            };
+
+            std::mutex mutex;
+            std::condition_variable_any cv;
+
+            // One VirtualMachine is parked or unparked per interval, so hash rate follows spare capacity without oscillating.
+            std::unique_lock lock{ mutex };
+            while (!cv.wait_for(lock, stop_token, options.interval, [&stop_token]() { return stop_token.stop_requested(); })) {
+                const auto current{ sample() };
+                if (!current.has_value()) {
+                    continue;
+                }
+
+                const auto active{ activeVMs() };
+                const auto min_vms{ std::min(options.min_vms, maxVMs()) };
+                if (*current > options.park_pressure && active > min_vms) {
+                    setActiveVMs(active - 1);
+                } else if (*current < options.unpark_pressure && active < maxVMs()) {
+                    setActiveVMs(active + 1);
+                }
+            }
+        } };
+    }
+
+    void Hasher::stopElastic() {
+        if (elastic_thread.joinable()) {
+            elastic_thread.request_stop();
+            elastic_thread.join();
+        }
+
+        idle_priority.store(false, std::memory_order_relaxed);
+    }
+
+    Hasher::Slice Hasher::nextSlice(const uint32_t vm_id, const Job* current_job) {
+        // Stride of job with weight 1. Jobs with higher weight advance their pass slower, so they are picked more often.
+        constexpr uint64_t Base_Stride{ 1 << 20 };
+        static_assert(Base_Stride / Max_Job_Weight >= 1, "Job with max weight must advance its pass");
+
+        std::lock_guard lock{ jobs_mutex };
+
+        // Job with the lowest pass is picked; on ties the current one, so VM is not reinitialized needlessly.
+        // Jobs that cannot be hashed do not bank time, otherwise they would monopolize VMs once their dataset is generated.
+        Job* picked{ nullptr };
+        for (const auto& job : jobs) {
+            if (job->dataset->state() != DatasetState::Ready) {
+                job->pass = std::max(job->pass, virtual_time);
+                continue;
+            }
+
+            if (picked == nullptr || job->pass < picked->pass || (job->pass == picked->pass && job.get() == current_job)) {
+                picked = job.get();
+            }
+        }
+
+        if (picked == nullptr) {
+            return {};
+        }
+
+        // Job is charged at pick, so VMs scheduled at the same time are spread over jobs.
+        virtual_time = picked->pass;
+        picked->pass += Base_Stride / picked->weight;
+
+        const auto it{ std::ranges::find(jobs, picked, &std::shared_ptr<Job>::get) };
+        return Slice{ *it, picked->revision, picked->cursors[vm_id] };
+    }
+
+    Hasher::JobId Hasher::addJob(BlockTemplate block, std::shared_ptr<Dataset> dataset, const uint32_t weight, Callback callback) {
+        std::lock_guard lock{ jobs_mutex };
+        return addJobLocked(block, std::move(dataset), weight, std::move(callback));
+    }
+
+    Hasher::JobId Hasher::addJobLocked(BlockTemplate block, std::shared_ptr<Dataset> dataset, const uint32_t weight, Callback callback) {
+        if (dataset == nullptr) {
+            throw Exception{ "Dataset cannot be null" };
+        }
+
+        if (weight == 0) {
+            throw Exception{ "Job weight has to be greater than 0" };
+        }
+
+        auto job{ std::make_shared<Job>() };
+        job->dataset = std::move(dataset);
+        job->callback = std::move(callback);
+        job->weight = std::min(weight, Max_Job_Weight);
+        job->cursors.resize(vms.size());
+        job->id = next_job_id++;
+        seedJob(*job, block);
+
+        // New job starts at current virtual time, so it neither starves other jobs nor is starved by them.
+        job->pass = virtual_time;
+
+        jobs.push_back(std::move(job));
+        return jobs.back()->id;
+    }
+
+    void Hasher::updateJob(const JobId job_id, BlockTemplate block) {
+        std::lock_guard lock{ jobs_mutex };
+        const auto it{ std::ranges::find(jobs, job_id, [](const auto& job) { return job->id; }) };
+        if (it != jobs.end()) {
+            seedJob(**it, block);
+        }
+    }
+
+    void Hasher::setJobWeight(const JobId job_id, const uint32_t weight) {
+        if (weight == 0) {
+            throw Exception{ "Job weight has to be greater than 0" };
+        }
+
+        std::lock_guard lock{ jobs_mutex };
+        const auto it{ std::ranges::find(jobs, job_id, [](const auto& job) { return job->id; }) };
+        if (it != jobs.end()) {
+            (*it)->weight = std::min(weight, Max_Job_Weight);
+        }
+    }
+
+    void Hasher::removeJob(const JobId job_id) {
+        std::lock_guard lock{ jobs_mutex };
+        std::erase_if(jobs, [job_id](const auto& job) { return job->id == job_id; });
+        if (job_id == default_job_id) {
+            default_job_id = 0;
         }
     }
 
     void Hasher::stop() {
         bool expected{ true };
-        if (vm_workers.size() < vms.size() || !running.compare_exchange_strong(expected, false)) {
+        if (!running.compare_exchange_strong(expected, false)) {
             // Not running or stopping.
             return;
         }
 
-        for (auto& worker : vm_workers) {
-            worker.join();
+        wakeParked();
+
+        for (auto workers = active_vm_workers.load(std::memory_order_acquire); workers != 0; workers = active_vm_workers.load(std::memory_order_acquire)) {
+            active_vm_workers.wait(workers, std::memory_order_acquire);
+        }
+    }
+
+    uint32_t Hasher::optimalThreads() noexcept {
+        const auto topology{ CPUInfo::topology() };
+        const uint32_t processors{ std::max(1u, std::thread::hardware_concurrency()) };
+        const uint32_t cores{ std::max(1u, processors / topology.threads_per_core) };
+
+        const auto l3{ topology.dataCache(3) };
+        if (l3 == nullptr) {
+            return cores;
         }
 
-        vm_workers.clear();
+        // Every L3 cache (eg. one per CCX) is shared by l3->shared_by logical processors at most.
+        const uint32_t l3_caches{ std::max(1u, processors / l3->shared_by) };
+        const uint32_t scratchpads{ l3_caches * (l3->size / Rx_Scratchpad_L3_Size) };
+        return std::clamp(scratchpads, 1u, cores);
     }
 
-    void Hasher::checkCPU() const {
-        if (!CPUInfo::AVX512F() || !CPUInfo::AVX512VL() || !CPUInfo::AVX512DQ()) {
-            throw Exception{ "AVX512 instructions required but not supported on current CPU" };
+    void Hasher::checkCPU() {
+        // AVX512 kernels are used if supported; otherwise AVX2 fallback is selected (see isa.hpp).
+        if (!CPUInfo::AVX2()) {
+            throw Exception{ "AVX2 instructions required but not supported on current CPU" };
         }
 
         if (!CPUInfo::AES()) {
@@ -118,36 +396,46 @@ namespace modernRX {
     }
 
     void Hasher::reset(const_span<std::byte> key) {
-        constexpr uint32_t Programs_Count{ Rx_Cache_Accesses }; // Number of superscalar programs should be equal to number of cache accesses.
-
-        if (!this->key.empty() && std::equal(key.begin(), key.end(), this->key.begin())) {
-            return;
-        }
-
-        this->key.clear();
-        this->key.reserve(key.size());
-        std::copy(key.begin(), key.end(), std::back_inserter(this->key));
-
-        HeapArray<argon2d::Block, 4096> cache(Rx_Argon2d_Memory_Blocks);
-        argon2d::fillMemory(cache.buffer(), key);
+        dataset->reset(key);
+    }
 
-        blake2b::Random blakeRNG{ key, 0 };
-        Superscalar superscalar{ blakeRNG };
+    std::shared_ptr<Dataset> Hasher::getDataset() const noexcept {
+        return dataset;
+    }
 
-        std::array<SuperscalarProgram, Programs_Count> programs;
-        for (auto& program : programs) {
-            program = superscalar.generate();
+    void Hasher::resetVM(BlockTemplate block_template) {
+        // Lookup and addition are done under single lock, so concurrent first calls do not add two default jobs.
+        std::lock_guard lock{ jobs_mutex };
+        const auto it{ std::ranges::find(jobs, default_job_id, [](const auto& job) { return job->id; }) };
+        if (it != jobs.end()) {
+            seedJob(**it, block_template);
+            return;
         }
 
-        dataset = generateDataset(cache.view(), programs);
+        default_job_id = addJobLocked(block_template, dataset, 1, nullptr);
     }
 
-    void Hasher::resetVM(BlockTemplate block_template) {
+    void Hasher::seedJob(Job& job, BlockTemplate block_template) const noexcept {
         const uint32_t offset{ static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() / vms.size()) };
 
-        for (auto& vm : vms) {
-            vm.reset(block_template, dataset.view());
-            block_template.next(offset);
+        // Seeds are calculated for batches of VMs with multi-buffer Blake2b.
+        std::array<std::span<const std::byte>, blake2b::Multi_Buffer_Lanes> inputs;
+        std::array<std::span<std::byte>, blake2b::Multi_Buffer_Lanes> outputs;
+
+        for (size_t first = 0; first < vms.size(); first += blake2b::Multi_Buffer_Lanes) {
+            const size_t batch_size{ std::min<size_t>(blake2b::Multi_Buffer_Lanes, vms.size() - first) };
+            for (size_t i = 0; i < batch_size; ++i) {
+                auto& cursor{ job.cursors[first + i] };
+                cursor.block_template = block_template;
+                cursor.seeded = true;
+                inputs[i] = cursor.block_template.view();
+                outputs[i] = cursor.seed;
+                block_template.next(offset);
+            }
+
+            blake2b::hashMany(std::span(outputs).first(batch_size), std::span(inputs).first(batch_size));
         }
+
+        ++job.revision;
     }
 }
@@ -2,25 +2,57 @@
 
 /*
 * Multi-threaded RandomX hash generator.
+* Can hash several jobs (e.g. block templates of different pools or merge-mined chains, possibly with different keys) at once.
+* VirtualMachines are time-sliced between jobs at hash boundaries, proportionally to job weights (stride scheduling).
+* VirtualMachines can be parked and unparked at runtime, manually or automatically from host CPU pressure (see cpupressure.hpp).
 */
 
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 
 #include "dataset.hpp"
 #include "heaparray.hpp"
 #include "virtualmachine.hpp"
+#include "virtualmem.hpp"
 
 namespace modernRX {
+    // Options of automatic VirtualMachine parking driven by host CPU pressure.
+    struct ElasticOptions {
+        uint32_t min_vms{ 0 }; // Number of VirtualMachines that are never parked.
+        double park_pressure{ 0.10 }; // Pressure above which one VirtualMachine is parked per interval.
+        double unpark_pressure{ 0.02 }; // Pressure below which one VirtualMachine is unparked per interval.
+        std::chrono::milliseconds interval{ 1000 }; // Time between pressure samples.
+        // Run VirtualMachine workers with idle priority (SCHED_IDLE on Linux) while automatic parking is enabled.
+        // On Linux unprivileged process may not be allowed to restore normal priority (see RLIMIT_NICE), then pool workers keep idle priority.
+        bool idle_priority{ false };
+        // Source of pressure samples in range [0, 1] (std::nullopt if not available), called once per interval on parking thread.
+        // If empty, host CPU pressure is sampled with CpuPressure. Allows driving parking with other signal (e.g. latency of co-located service).
+        std::function<std::optional<double>()> pressure_source;
+    };
+
     class Hasher {
     public:
+        using Callback = std::function<void(const RxHash&)>;
+        using JobId = uint32_t;
+
+        // Higher job weights are clamped to this value, so scheduler's stride never drops to 0.
+        static constexpr uint32_t Max_Job_Weight{ 1 << 16 };
+
         // Initialize with empty key (for later reset).
         [[nodiscard]] explicit Hasher();
         
         // Initialize with key to generate Dataset at creation
         [[nodiscard]] explicit Hasher(const_span<std::byte> key);
 
+        // Initialize with Dataset shared with other hashers or VirtualMachines (e.g. verification engine). Throws if dataset is null.
+        [[nodiscard]] explicit Hasher(std::shared_ptr<Dataset> dataset);
+
         ~Hasher();
 
         Hasher(const Hasher&) = delete;
@@ -29,27 +61,133 @@ namespace modernRX {
         Hasher& operator=(Hasher&&) = delete;
 
         // Resets VirtualMachine's states with given block template.
+        // Same as updateJob for default job, that uses Hasher's Dataset and weight 1. Default job is added at first call.
         void resetVM(BlockTemplate block);
 
-        // Resets Dataset with new key. Does nothing if key is equal to previous one.
+        // Adds job that is hashed concurrently with other jobs; VirtualMachines pick it up at next slice boundary. Returns job's identifier.
+        // Nonce space of block template is split evenly between VirtualMachines. Jobs with not generated dataset are skipped.
+        // Hashes are passed to job's callback, or to callback given to run if job's one is empty. Throws if dataset is null or weight is 0. Weight is clamped to Max_Job_Weight.
+        JobId addJob(BlockTemplate block, std::shared_ptr<Dataset> dataset, const uint32_t weight = 1, Callback callback = nullptr);
+
+        // Replaces block template of given job (e.g. new block on its chain). Does nothing if job does not exist.
+        void updateJob(const JobId job_id, BlockTemplate block);
+
+        // Changes weight of given job. Does nothing if job does not exist. Throws if weight is 0. Weight is clamped to Max_Job_Weight.
+        void setJobWeight(const JobId job_id, const uint32_t weight);
+
+        // Removes given job. Slices already started for this job are finished. Does nothing if job does not exist.
+        void removeJob(const JobId job_id);
+
+        // Resets Dataset with new key. Does nothing if Dataset is already generated for given key (e.g. by other user of shared Dataset).
+        // Can be called while hashing: slices in progress are finished with previous dataset, jobs using it wait for new one.
+        // Must not be called from hash callback, as slice calling it holds Dataset reader.
         void reset(const_span<std::byte> key);
 
-        // Starts all VirtualMachine worker threads.
-        void run(std::function<void(const RxHash&)> callback = [](const RxHash&) noexcept {});
+        // Returns Dataset used by this hasher, so it can be shared.
+        [[nodiscard]] std::shared_ptr<Dataset> getDataset() const noexcept;
+
+        // Starts all VirtualMachine workers on shared thread pool.
+        void run(Callback callback = [](const RxHash&) noexcept {});
 
-        // Wait for all VirtualMachine worker threads to finish.
+        // Wait for all VirtualMachine workers to finish.
         void stop();
 
+        // Keeps only VirtualMachines with id lower than given count running; others are parked at next slice boundary.
+        // Parked VirtualMachine keeps its scratchpad and position in job's nonce space and does not use processor, so unparked one continues where it stopped.
+        // Count is clamped to number of VirtualMachines.
+        void setActiveVMs(const uint32_t count) noexcept;
+
+        // Returns number of VirtualMachines that are not parked.
+        [[nodiscard]] uint32_t activeVMs() const noexcept;
+
+        // Returns number of VirtualMachines that already stopped at slice boundary and wait to be unparked.
+        [[nodiscard]] uint32_t parkedVMs() const noexcept;
+
+        // Returns number of VirtualMachines.
+        [[nodiscard]] uint32_t maxVMs() const noexcept;
+
+        // Starts background thread that parks VirtualMachines when host CPU pressure rises and unparks them when it drops.
+        // Restarts it if already running. Throws if pressure thresholds are not in range [0, 1] or unpark_pressure is greater than park_pressure.
+        void startElastic(const ElasticOptions& options = {});
+
+        // Stops automatic parking. VirtualMachines parked at the time stay parked until setActiveVMs is called.
+        void stopElastic();
+
+        // Returns number of hashes calculated for all jobs. Updated at the end of each slice.
         uint64_t hashes() const noexcept;
+
+        // Returns number of hashes calculated for given job (0 if job does not exist). Updated at the end of each slice.
+        uint64_t hashes(const JobId job_id) const;
+
+        // Ensures CPU supports required features. Throws otherwise.
+        static void checkCPU();
+
+        // Returns number of VMs fitting in physical cores and L3 caches.
+        [[nodiscard]] static uint32_t optimalThreads() noexcept;
     private:
-        std::vector<std::thread> vm_workers; // Threads used for program execution.
+        // Position of single VirtualMachine in job's nonce space.
+        struct Cursor {
+            BlockTemplate block_template; // Block template with next nonce to hash.
+            std::array<std::byte, 64> seed; // Blake2b hash of block template; valid only if seeded is true.
+            bool seeded{ false };
+        };
+
+        struct Job {
+            JobId id{ 0 };
+            std::shared_ptr<Dataset> dataset;
+            Callback callback;
+            uint32_t weight{ 1 };
+            uint64_t pass{ 0 }; // Virtual time of stride scheduling; job with the lowest one gets next slice.
+            uint32_t revision{ 0 }; // Increased with every block template change.
+            std::vector<Cursor> cursors; // One per VirtualMachine.
+            std::atomic<uint64_t> hashes{ 0 };
+        };
+
+        // Job picked for next slice of single VirtualMachine.
+        struct Slice {
+            std::shared_ptr<Job> job;
+            uint32_t revision{ 0 };
+            Cursor cursor;
+        };
+
         std::vector<VirtualMachine> vms; // Virtual machines used for program execution.
-        std::vector<std::byte> key; // Latest key used for Dataset generation.
-        HeapArray<DatasetItem, 4096> dataset; // Dataset used for program execution.
+        std::shared_ptr<Dataset> dataset; // Dataset used for program execution. Its memory is retained between key changes and refilled in place.
         HeapArray<std::byte, 64 * Rx_Scratchpad_L3_Size> scratchpads; // Scratchpads used for program execution.
-        jit_function_ptr<JITRxProgram> jit; // JIT-compiled RandomX program buffer.
-        std::atomic<bool> running{ false }; // Stop signal for VM threads.
+        DualMappedMemory jit; // JIT-compiled RandomX program buffers. Written and executed through separate views (W^X).
+        std::atomic<bool> running{ false }; // Stop signal for VM workers.
+        std::atomic<uint32_t> active_vm_workers{ 0 }; // Number of VM loops still running on thread pool.
+        std::atomic<uint64_t> total_hashes{ 0 }; // Hashes calculated for all jobs, including removed ones.
+        std::atomic<uint32_t> active_vms{ 0 }; // VirtualMachines with lower id are not parked.
+        std::atomic<uint32_t> parked_vms{ 0 }; // VirtualMachines waiting in waitUnparked.
+        std::atomic<uint32_t> park_epoch{ 0 }; // Increased to wake parked VirtualMachines (on active_vms change or stop).
+        std::atomic<bool> idle_priority{ false }; // True if VirtualMachine workers should run with idle priority.
+        Callback callback; // Callback given to run. Not changed while workers are running.
+
+        mutable std::mutex jobs_mutex; // Guards all fields below and jobs' fields other than hashes.
+        std::vector<std::shared_ptr<Job>> jobs; // Jobs shared with workers, so removed job outlives its last slice.
+        JobId next_job_id{ 1 };
+        JobId default_job_id{ 0 }; // Job used by resetVM; 0 if not added yet.
+        uint64_t virtual_time{ 0 }; // Pass of the most recently picked job.
+
+        // Same as addJob. Requires locked jobs_mutex.
+        JobId addJobLocked(BlockTemplate block, std::shared_ptr<Dataset> dataset, const uint32_t weight, Callback callback);
+
+        // Sets block template for all VirtualMachines of given job, so that each of them hashes its own part of nonce space. Requires locked jobs_mutex.
+        void seedJob(Job& job, BlockTemplate block) const noexcept;
+
+        // Picks job for next slice of given VirtualMachine and charges it. Returns empty slice if there is no job with generated dataset.
+        [[nodiscard]] Slice nextSlice(const uint32_t vm_id, const Job* current_job);
+
+        // Runs scheduling loop of given VirtualMachine until stop is requested.
+        void work(const uint32_t vm_id);
+
+        // Blocks while given VirtualMachine is parked. Returns false if stop was requested.
+        [[nodiscard]] bool waitUnparked(const uint32_t vm_id) noexcept;
+
+        // Wakes parked VirtualMachines, so they recheck their state.
+        void wakeParked() noexcept;
 
-        void checkCPU() const; // Ensure CPU supports required features.
+        // Automatic parking thread. Declared last, so it is stopped before any other field is destroyed.
+        std::jthread elastic_thread;
     };
 }
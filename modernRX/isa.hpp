@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+* Runtime selection of instruction set for algorithm parts that have kernels specialized for more than one instruction set.
+* Best instruction set is selected once at startup from CPUInfo; every dispatched kernel checks selectedIsa() before running.
+* Not a part of RandomX algorithm.
+*/
+
+#include <cstdint>
+#include <format>
+#include <string_view>
+
+#include "cpuinfo.hpp"
+#include "exception.hpp"
+
+namespace modernRX {
+    // Instruction sets that kernels are specialized for, ordered from the least capable one.
+    enum class Isa : uint8_t {
+        AVX2,   // AVX2 and AES-NI; 64-bit multiplication and rotation are emulated.
+        AVX512, // AVX512F, AVX512VL and AVX512DQ.
+    };
+
+    // Returns the best instruction set supported by current CPU.
+    [[nodiscard]] inline Isa detectIsa() noexcept {
+        return CPUInfo::AVX512F() && CPUInfo::AVX512VL() && CPUInfo::AVX512DQ() ? Isa::AVX512 : Isa::AVX2;
+    }
+
+    // Returns true if current CPU is able to run kernels specialized for given instruction set.
+    [[nodiscard]] inline bool isaSupported(const Isa isa) noexcept {
+        return isa <= detectIsa();
+    }
+
+    [[nodiscard]] constexpr std::string_view isaName(const Isa isa) noexcept {
+        return isa == Isa::AVX512 ? "AVX512" : "AVX2";
+    }
+
+    namespace internal {
+        inline Isa selected_isa{ detectIsa() };
+    }
+
+    // Returns instruction set of kernels that are currently in use.
+    [[nodiscard]] inline Isa selectedIsa() noexcept {
+        return internal::selected_isa;
+    }
+
+    // Forces kernels specialized for given instruction set. Meant for tests and benchmarks of fallback kernels.
+    // Must not be called while any dispatched kernel is running.
+    // Throws if current CPU does not support given instruction set.
+    inline void selectIsa(const Isa isa) {
+        if (!isaSupported(isa)) {
+            throw Exception{ std::format("{:s} instructions required but not supported on current CPU", isaName(isa)) };
+        }
+
+        internal::selected_isa = isa;
+    }
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+
+#include "argon2d.hpp"
+#include "blake2brandom.hpp"
+#include "cpuinfo.hpp"
+#include "dataset.hpp"
+#include "heaparray.hpp"
+#include "randomx.h"
+#include "superscalar.hpp"
+#include "virtualmachine.hpp"
+#include "virtualmem.hpp"
+
+using namespace modernRX;
+
+namespace {
+    constexpr unsigned long Dataset_Item_Count{ (Rx_Dataset_Base_Size + Rx_Dataset_Extra_Size) / sizeof(DatasetItem) };
+
+    // Same CPU requirements as Hasher.
+    [[nodiscard]] bool cpuSupported() noexcept {
+        return CPUInfo::AVX2() && CPUInfo::AES();
+    }
+}
+
+struct randomx_cache {
+    HeapArray<argon2d::Block, 4096> memory; // Argon2d filled memory.
+    std::array<SuperscalarProgram, Rx_Cache_Accesses> programs; // Superscalar programs generated from the same key.
+};
+
+struct randomx_dataset {
+    HeapArray<DatasetItem, 4096> memory; // Holds datasetItemsCount() items, padding included.
+};
+
+struct randomx_vm {
+    HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad;
+    DualMappedMemory jit;
+    std::optional<VirtualMachine> vm; // Constructed after buffers are allocated.
+    const_span<DatasetItem> dataset;
+};
+
+extern "C" {
+    randomx_flags randomx_get_flags(void) {
+        randomx_flags flags{ RANDOMX_FLAG_JIT };
+        if (CPUInfo::AES()) {
+            flags |= RANDOMX_FLAG_HARD_AES;
+        }
+
+        if (CPUInfo::AVX2()) {
+            flags |= RANDOMX_FLAG_ARGON2_AVX2;
+        }
+
+        return flags;
+    }
+
+    randomx_cache* randomx_alloc_cache(randomx_flags) {
+        if (!cpuSupported()) {
+            return nullptr;
+        }
+
+        auto cache{ new(std::nothrow) randomx_cache{} };
+        if (cache == nullptr) {
+            return nullptr;
+        }
+
+        cache->memory.reserve(Rx_Argon2d_Memory_Blocks);
+        if (cache->memory.data() == nullptr) {
+            delete cache;
+            return nullptr;
+        }
+
+        return cache;
+    }
+
+    void randomx_init_cache(randomx_cache* cache, const void* key, size_t keySize) {
+        const auto key_view{ const_span<std::byte>(static_cast<const std::byte*>(key), keySize) };
+        argon2d::fillMemory(cache->memory.buffer(), key_view);
+
+        blake2b::Random blakeRNG{ key_view, 0 };
+        Superscalar superscalar{ blakeRNG };
+        for (auto& program : cache->programs) {
+            program = superscalar.generate();
+        }
+    }
+
+    void* randomx_get_cache_memory(randomx_cache* cache) {
+        return cache->memory.data();
+    }
+
+    void randomx_release_cache(randomx_cache* cache) {
+        delete cache;
+    }
+
+    randomx_dataset* randomx_alloc_dataset(randomx_flags) {
+        auto dataset{ new(std::nothrow) randomx_dataset{} };
+        if (dataset == nullptr) {
+            return nullptr;
+        }
+
+        dataset->memory.reserve(datasetItemsCount());
+        if (dataset->memory.data() == nullptr) {
+            delete dataset;
+            return nullptr;
+        }
+
+        return dataset;
+    }
+
+    unsigned long randomx_dataset_item_count(void) {
+        return Dataset_Item_Count;
+    }
+
+    void randomx_init_dataset(randomx_dataset* dataset, randomx_cache* cache, unsigned long startItem, unsigned long itemCount) {
+        const uint64_t begin{ std::min<uint64_t>(startItem, Dataset_Item_Count) };
+        const uint64_t end{ std::min<uint64_t>(begin + itemCount, Dataset_Item_Count) };
+        if (begin == end) {
+            return;
+        }
+
+        const auto memory{ dataset->memory.buffer().first(datasetItemsCount()) };
+
+        try {
+            // Aligned part is generated in place. Unaligned head and tail are generated into temporary buffer and only requested items are copied,
+            // so concurrent calls for adjacent ranges never write the same items.
+            const uint64_t aligned_begin{ (begin + Dataset_Range_Alignment - 1) / Dataset_Range_Alignment * Dataset_Range_Alignment };
+            const uint64_t aligned_end{ std::max(aligned_begin, end / Dataset_Range_Alignment * Dataset_Range_Alignment) };
+
+            const auto generatePartial = [&](const uint64_t first, const uint64_t last) {
+                alignas(64) std::array<DatasetItem, Dataset_Range_Alignment> items;
+                const uint64_t range_start{ first / Dataset_Range_Alignment * Dataset_Range_Alignment };
+                generateDatasetRange(items, range_start, cache->memory.view(), cache->programs);
+                std::copy(items.begin() + (first - range_start), items.begin() + (last - range_start), memory.begin() + first);
+            };
+
+            if (aligned_begin >= end) {
+                // Whole range lies within single aligned chunk.
+                generatePartial(begin, end);
+                return;
+            }
+
+            if (begin < aligned_begin) {
+                generatePartial(begin, aligned_begin);
+            }
+
+            if (aligned_begin < aligned_end) {
+                generateDatasetRange(memory.subspan(aligned_begin, aligned_end - aligned_begin), aligned_begin, cache->memory.view(), cache->programs);
+            }
+
+            if (aligned_end < end) {
+                generatePartial(aligned_end, end);
+            }
+        } catch (...) {
+            // C interface cannot report errors; dataset content is left incomplete.
+        }
+    }
+
+    void* randomx_get_dataset_memory(randomx_dataset* dataset) {
+        return dataset->memory.data();
+    }
+
+    void randomx_release_dataset(randomx_dataset* dataset) {
+        delete dataset;
+    }
+
+    randomx_vm* randomx_create_vm(randomx_flags, randomx_cache*, randomx_dataset* dataset) {
+        if (dataset == nullptr || !cpuSupported()) {
+            return nullptr;
+        }
+
+        try {
+            auto machine{ std::make_unique<randomx_vm>() };
+            machine->scratchpad.reserve(VirtualMachine::requiredMemory());
+            if (machine->scratchpad.data() == nullptr) {
+                return nullptr;
+            }
+
+            machine->jit = DualMappedMemory(VirtualMachine::requiredCodeMemory());
+            machine->vm.emplace(machine->scratchpad.buffer<VirtualMachine::requiredMemory()>(), JITRxBuffer{ machine->jit.writable(), machine->jit.executable<JITRxProgram>() });
+            machine->dataset = dataset->memory.view();
+
+            return machine.release();
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    void randomx_vm_set_cache(randomx_vm*, randomx_cache*) {
+        // VM works only in fast mode and never reads cache.
+    }
+
+    void randomx_vm_set_dataset(randomx_vm* machine, randomx_dataset* dataset) {
+        // VM works only in fast mode, so it keeps previous dataset instead of being left without any.
+        if (dataset == nullptr) {
+            return;
+        }
+
+        machine->dataset = dataset->memory.view();
+    }
+
+    void randomx_destroy_vm(randomx_vm* machine) {
+        delete machine;
+    }
+
+    void randomx_calculate_hash(randomx_vm* machine, const void* input, size_t inputSize, void* output) {
+        const auto hash{ machine->vm->hash(const_span<std::byte>(static_cast<const std::byte*>(input), inputSize), machine->dataset) };
+        std::memcpy(output, hash.data.data(), RANDOMX_HASH_SIZE);
+    }
+
+    void randomx_calculate_hash_first(randomx_vm* machine, const void* input, size_t inputSize) {
+        machine->vm->hashFirst(const_span<std::byte>(static_cast<const std::byte*>(input), inputSize), machine->dataset);
+    }
+
+    void randomx_calculate_hash_next(randomx_vm* machine, const void* nextInput, size_t nextInputSize, void* output) {
+        const auto hash{ machine->vm->hashNext(const_span<std::byte>(static_cast<const std::byte*>(nextInput), nextInputSize)) };
+        std::memcpy(output, hash.data.data(), RANDOMX_HASH_SIZE);
+    }
+
+    void randomx_calculate_hash_last(randomx_vm* machine, void* output) {
+        const auto hash{ machine->vm->hashLast() };
+        std::memcpy(output, hash.data.data(), RANDOMX_HASH_SIZE);
+    }
+}
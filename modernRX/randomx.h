@@ -0,0 +1,147 @@
+#ifndef RANDOMX_H
+#define RANDOMX_H
+
+/*
+* C interface compatible with reference RandomX library's randomx.h: https://github.com/tevador/RandomX/blob/master/src/randomx.h
+* Allows to use modernRX as a drop-in replacement (shared or static library) by software written against reference implementation,
+* and to compare both implementations by linking the same harness against either of them.
+* Not a part of RandomX algorithm.
+*
+* Differences to reference implementation:
+*   - Only fast mode is supported: randomx_create_vm requires dataset and fails (returns NULL) without it.
+*   - Cache memory is used only to initialize dataset; randomx_vm_set_cache has no effect on VM.
+*   - JIT compiler and hardware AES are always used; RANDOMX_FLAG_LARGE_PAGES, RANDOMX_FLAG_SECURE, RANDOMX_FLAG_JIT, RANDOMX_FLAG_HARD_AES
+*     and RANDOMX_FLAG_ARGON2* flags are accepted, but ignored (JIT code is never writable and executable at the same address anyway).
+*   - randomx_vm_set_dataset ignores NULL dataset, so VM keeps using previous one.
+*   - Functions never throw; allocation functions return NULL on failure.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RANDOMX_HASH_SIZE 32
+#define RANDOMX_DATASET_ITEM_SIZE 64
+
+/* Defined as __declspec(dllexport) by shared library project. */
+#ifndef RANDOMX_EXPORT
+#define RANDOMX_EXPORT
+#endif
+
+typedef enum {
+    RANDOMX_FLAG_DEFAULT = 0,
+    RANDOMX_FLAG_LARGE_PAGES = 1,
+    RANDOMX_FLAG_HARD_AES = 2,
+    RANDOMX_FLAG_FULL_MEM = 4,
+    RANDOMX_FLAG_JIT = 8,
+    RANDOMX_FLAG_SECURE = 16,
+    RANDOMX_FLAG_ARGON2_SSSE3 = 32,
+    RANDOMX_FLAG_ARGON2_AVX2 = 64,
+    RANDOMX_FLAG_ARGON2 = 96
+} randomx_flags;
+
+typedef struct randomx_dataset randomx_dataset;
+typedef struct randomx_cache randomx_cache;
+typedef struct randomx_vm randomx_vm;
+
+#if defined(__cplusplus)
+
+#ifdef __cpp_constexpr
+#define RANDOMX_CONSTEXPR constexpr
+#else
+#define RANDOMX_CONSTEXPR
+#endif
+
+inline RANDOMX_CONSTEXPR randomx_flags operator |(randomx_flags a, randomx_flags b) {
+    return static_cast<randomx_flags>(static_cast<int>(a) | static_cast<int>(b));
+}
+inline RANDOMX_CONSTEXPR randomx_flags operator &(randomx_flags a, randomx_flags b) {
+    return static_cast<randomx_flags>(static_cast<int>(a) & static_cast<int>(b));
+}
+inline randomx_flags& operator |=(randomx_flags& a, randomx_flags b) {
+    return a = a | b;
+}
+
+extern "C" {
+#endif
+
+/*
+* Returns flags recommended for current CPU.
+*/
+RANDOMX_EXPORT randomx_flags randomx_get_flags(void);
+
+/*
+* Allocates memory for cache (Argon2d filled memory and superscalar programs).
+* Returns NULL if CPU is not supported or memory allocation failed.
+*/
+RANDOMX_EXPORT randomx_cache *randomx_alloc_cache(randomx_flags flags);
+
+/*
+* Initializes cache with given key of any size (including 0).
+*/
+RANDOMX_EXPORT void randomx_init_cache(randomx_cache *cache, const void *key, size_t keySize);
+
+/*
+* Returns pointer to Argon2d filled memory of the cache.
+*/
+RANDOMX_EXPORT void *randomx_get_cache_memory(randomx_cache *cache);
+
+RANDOMX_EXPORT void randomx_release_cache(randomx_cache *cache);
+
+/*
+* Allocates memory for dataset. Returns NULL if memory allocation failed.
+*/
+RANDOMX_EXPORT randomx_dataset *randomx_alloc_dataset(randomx_flags flags);
+
+/*
+* Returns number of items in dataset (without padding used internally by modernRX).
+*/
+RANDOMX_EXPORT unsigned long randomx_dataset_item_count(void);
+
+/*
+* Initializes items [startItem, startItem + itemCount) of the dataset from initialized cache.
+* Can be called concurrently for disjoint ranges; every call is additionally parallelized on modernRX's thread pool.
+*/
+RANDOMX_EXPORT void randomx_init_dataset(randomx_dataset *dataset, randomx_cache *cache, unsigned long startItem, unsigned long itemCount);
+
+RANDOMX_EXPORT void *randomx_get_dataset_memory(randomx_dataset *dataset);
+
+RANDOMX_EXPORT void randomx_release_dataset(randomx_dataset *dataset);
+
+/*
+* Creates VM that calculates hashes with given dataset.
+* Returns NULL if dataset is NULL (light mode is not supported), CPU is not supported or memory allocation failed.
+* VM is single-threaded; use one VM per thread.
+*/
+RANDOMX_EXPORT randomx_vm *randomx_create_vm(randomx_flags flags, randomx_cache *cache, randomx_dataset *dataset);
+
+/*
+* Has no effect, as VM never reads cache.
+*/
+RANDOMX_EXPORT void randomx_vm_set_cache(randomx_vm *machine, randomx_cache *cache);
+
+/*
+* Replaces dataset used by VM (e.g. after key change). NULL dataset is ignored.
+*/
+RANDOMX_EXPORT void randomx_vm_set_dataset(randomx_vm *machine, randomx_dataset *dataset);
+
+RANDOMX_EXPORT void randomx_destroy_vm(randomx_vm *machine);
+
+/*
+* Calculates RandomX hash of given input and stores it in output (RANDOMX_HASH_SIZE bytes).
+*/
+RANDOMX_EXPORT void randomx_calculate_hash(randomx_vm *machine, const void *input, size_t inputSize, void *output);
+
+/*
+* Pipelined hashing of consecutive inputs: _first starts hashing of first input, every _next returns hash of previous input
+* and starts hashing of given one, _last returns hash of last input. Each hash is the same as randomx_calculate_hash would return,
+* but scratchpad for the next input is filled while finishing previous hash.
+*/
+RANDOMX_EXPORT void randomx_calculate_hash_first(randomx_vm *machine, const void *input, size_t inputSize);
+RANDOMX_EXPORT void randomx_calculate_hash_next(randomx_vm *machine, const void *nextInput, size_t nextInputSize, void *output);
+RANDOMX_EXPORT void randomx_calculate_hash_last(randomx_vm *machine, void *output);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
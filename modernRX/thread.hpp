@@ -1,13 +1,155 @@
 #pragma once
 
-#include <bitset>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
-#include <processthreadsapi.h>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sched.h>
 
+#include <charconv>
+#include <fstream>
+#include <string>
+#endif
+
+// Pins calling thread to a single logical processor. On Windows processor is identified as 64 * processor group + number within group,
+// so hosts with more than 64 logical processors are supported.
 // Returns true if the thread affinity was set successfully.
-bool setThreadAffinity(const uint32_t coreid) {
-    std::bitset<64> mask;
-    mask.set(2 * coreid);
+inline bool setThreadAffinity(const uint32_t processor) {
+#ifdef _WIN32
+    constexpr uint32_t Group_Size{ 64 }; // Number of bits in KAFFINITY.
+
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(processor / Group_Size);
+    affinity.Mask = static_cast<KAFFINITY>(1) << (processor % Group_Size);
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    if (processor >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(processor, &mask);
+
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#endif
+}
+
+// Returns logical processors (identified as in setThreadAffinity) ordered physical cores first: one logical processor of every core,
+// then their siblings, so threads pinned in this order do not share a core as long as possible. Sibling ids are read from the OS,
+// as their numbering differs between platforms (e.g. adjacent on Windows, i and i + N/2 on most x86 Linux hosts).
+// Returns empty vector if topology cannot be read.
+[[nodiscard]] inline std::vector<uint32_t> processorsByCore() {
+    std::vector<std::pair<uint32_t, uint32_t>> ranked; // Position of logical processor within its core and its id.
+
+#ifdef _WIN32
+    DWORD length{ 0 };
+    if (GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length) || GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+        return {};
+    }
+
+    std::vector<std::byte> buffer(length);
+    if (!GetLogicalProcessorInformationEx(RelationProcessorCore, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length)) {
+        return {};
+    }
+
+    for (DWORD offset = 0; offset < length;) {
+        const auto& info{ *reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset) };
+        uint32_t rank{ 0 };
+        for (WORD group = 0; group < info.Processor.GroupCount; ++group) {
+            const auto& group_mask{ info.Processor.GroupMask[group] };
+            for (uint32_t bit = 0; bit < 64; ++bit) {
+                if (group_mask.Mask & (static_cast<KAFFINITY>(1) << bit)) {
+                    ranked.emplace_back(rank++, 64 * group_mask.Group + bit);
+                }
+            }
+        }
+
+        offset += info.Size;
+    }
+#else
+    // Only processors that process is allowed to run on are used (e.g. restricted by taskset or cgroup).
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return {};
+    }
+
+    // List format: comma separated ids or ranges of ids, e.g. "0,8" or "0-1".
+    const auto readSiblings = [](const uint32_t processor) {
+        std::vector<uint32_t> siblings;
+        std::ifstream file{ "/sys/devices/system/cpu/cpu" + std::to_string(processor) + "/topology/thread_siblings_list" };
+        std::string item;
+        while (std::getline(file, item, ',')) {
+            const auto end{ item.data() + item.size() };
+            uint32_t first{ 0 };
+            const auto [next, error]{ std::from_chars(item.data(), end, first) };
+            uint32_t last{ first };
+            if (error != std::errc{} || (next != end && *next == '-' && std::from_chars(next + 1, end, last).ec != std::errc{})) {
+                return std::vector<uint32_t>{};
+            }
+
+            for (uint32_t sibling = first; sibling <= last; ++sibling) {
+                siblings.push_back(sibling);
+            }
+        }
+
+        return siblings;
+    };
+
+    for (uint32_t processor = 0; processor < CPU_SETSIZE; ++processor) {
+        if (!CPU_ISSET(processor, &allowed)) {
+            continue;
+        }
+
+        const auto siblings{ readSiblings(processor) };
+        if (std::ranges::find(siblings, processor) == siblings.end()) {
+            return {};
+        }
+
+        const auto rank{ std::ranges::count_if(siblings, [processor, &allowed](const uint32_t sibling) {
+            return sibling < processor && CPU_ISSET(sibling, &allowed);
+        }) };
+        ranked.emplace_back(static_cast<uint32_t>(rank), processor);
+    }
+#endif
+
+    // Stable sort keeps processors of the same rank in id order.
+    std::ranges::stable_sort(ranked, {}, &std::pair<uint32_t, uint32_t>::first);
+
+    std::vector<uint32_t> processors;
+    processors.reserve(ranked.size());
+    for (const auto& [rank, processor] : ranked) {
+        processors.push_back(processor);
+    }
+
+    return processors;
+}
+
+// Lowers priority of calling thread, so it runs only on processors that other threads do not need (SCHED_IDLE on Linux).
+// Returns true if the thread priority was set successfully.
+inline bool setThreadIdlePriority() {
+#ifdef _WIN32
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE) != 0;
+#else
+    const sched_param param{};
+    return sched_setscheduler(0, SCHED_IDLE, &param) == 0;
+#endif
+}
 
-    return SetThreadAffinityMask(GetCurrentThread(), mask.to_ulong());
-}
\ No newline at end of file
+// Restores default priority of calling thread.
+// Returns true if the thread priority was set successfully.
+inline bool setThreadNormalPriority() {
+#ifdef _WIN32
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL) != 0;
+#else
+    const sched_param param{};
+    return sched_setscheduler(0, SCHED_OTHER, &param) == 0;
+#endif
+}
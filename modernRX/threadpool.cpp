@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <exception>
+#include <latch>
+
+#include "thread.hpp"
+#include "threadpool.hpp"
+
+namespace modernRX {
+    ThreadPool& ThreadPool::global() {
+        static ThreadPool pool{};
+        return pool;
+    }
+
+    ThreadPool::ThreadPool(const uint32_t worker_count) :
+        processors(processorsByCore()) {
+        const uint32_t count{ std::max(1u, worker_count) };
+        workers.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+
+        // Wait for all workers to be pinned, so pinned() is meaningful right after construction.
+        std::latch workers_ready{ count };
+        for (uint32_t worker_id = 0; worker_id < count; ++worker_id) {
+            workers[worker_id]->thread = std::thread{ [this, worker_id, &workers_ready]() {
+                if (setThreadAffinity(processorOf(worker_id))) {
+                    pinned_workers.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                workers_ready.count_down();
+                work(worker_id);
+            } };
+        }
+
+        workers_ready.wait();
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock{ sleep_mutex };
+            stopping = true;
+        }
+        sleep_cv.notify_all();
+
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    uint32_t ThreadPool::size() const noexcept {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+    bool ThreadPool::pinned() const noexcept {
+        return pinned_workers.load(std::memory_order_relaxed) == workers.size();
+    }
+
+    void ThreadPool::submit(Task task) {
+        auto& worker{ *workers[next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size()] };
+        {
+            std::lock_guard lock{ worker.mutex };
+            worker.tasks.push_back(std::move(task));
+            stealable_tasks_count.fetch_add(1, std::memory_order_release);
+        }
+
+        // Lock is needed to not lose wake up of worker that is just going to sleep.
+        { std::lock_guard lock{ sleep_mutex }; }
+        sleep_cv.notify_one();
+    }
+
+    void ThreadPool::submitTo(const uint32_t worker_id, Task task) {
+        auto& worker{ *workers[worker_id % workers.size()] };
+        {
+            std::lock_guard lock{ worker.mutex };
+            worker.own_tasks.push_back(std::move(task));
+            worker.own_tasks_count.fetch_add(1, std::memory_order_release);
+        }
+
+        // Only one specific worker can take this task, but there is no way to notify exactly that one.
+        { std::lock_guard lock{ sleep_mutex }; }
+        sleep_cv.notify_all();
+    }
+
+    void ThreadPool::parallelFor(const uint32_t task_count, const std::function<void(uint32_t)>& fn) {
+        if (task_count == 0) {
+            return;
+        }
+
+        // State is shared with runners, because runners that start after all tasks were claimed may outlive this call.
+        struct State {
+            std::function<void(uint32_t)> fn;
+            uint32_t task_count;
+            std::atomic<uint32_t> next_task{ 0 };
+            std::atomic<uint32_t> remaining;
+            std::mutex exception_mutex;
+            std::exception_ptr exception;
+        };
+
+        auto state{ std::make_shared<State>() };
+        state->fn = fn;
+        state->task_count = task_count;
+        state->remaining = task_count;
+
+        const auto runner = [state]() {
+            auto task_id{ state->next_task.fetch_add(1, std::memory_order_relaxed) };
+            while (task_id < state->task_count) {
+                try {
+                    state->fn(task_id);
+                } catch (...) {
+                    std::lock_guard lock{ state->exception_mutex };
+                    if (!state->exception) {
+                        state->exception = std::current_exception();
+                    }
+                }
+
+                if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    state->remaining.notify_all();
+                }
+
+                task_id = state->next_task.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        const uint32_t runners_count{ std::min(task_count, size()) };
+        for (uint32_t i = 1; i < runners_count; ++i) {
+            submit(runner);
+        }
+
+        runner();
+
+        // All tasks are claimed at this point, wait for those still being executed by workers.
+        for (auto remaining = state->remaining.load(std::memory_order_acquire); remaining != 0; remaining = state->remaining.load(std::memory_order_acquire)) {
+            state->remaining.wait(remaining, std::memory_order_acquire);
+        }
+
+        if (state->exception) {
+            std::rethrow_exception(state->exception);
+        }
+    }
+
+    void ThreadPool::work(const uint32_t worker_id) {
+        auto& worker{ *workers[worker_id] };
+
+        while (true) {
+            if (tryRun(worker_id)) {
+                continue;
+            }
+
+            std::unique_lock lock{ sleep_mutex };
+            sleep_cv.wait(lock, [this, &worker]() {
+                return stopping || stealable_tasks_count.load(std::memory_order_acquire) > 0 || worker.own_tasks_count.load(std::memory_order_acquire) > 0;
+            });
+
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::tryRun(const uint32_t worker_id) {
+        auto& worker{ *workers[worker_id] };
+
+        Task task;
+        {
+            std::lock_guard lock{ worker.mutex };
+            if (!worker.own_tasks.empty()) {
+                task = std::move(worker.own_tasks.front());
+                worker.own_tasks.pop_front();
+                worker.own_tasks_count.fetch_sub(1, std::memory_order_relaxed);
+            } else if (!worker.tasks.empty()) {
+                // Own stealable queue is processed in LIFO order to stay cache friendly, thieves take oldest tasks.
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+                stealable_tasks_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (task) {
+            task();
+            return true;
+        }
+
+        return trySteal(worker_id + 1);
+    }
+
+    bool ThreadPool::trySteal(const uint32_t start_worker_id) {
+        for (uint32_t i = 0; i < workers.size(); ++i) {
+            auto& victim{ *workers[(start_worker_id + i) % workers.size()] };
+
+            Task task;
+            {
+                std::lock_guard lock{ victim.mutex };
+                if (victim.tasks.empty()) {
+                    continue;
+                }
+
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                stealable_tasks_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            task();
+            return true;
+        }
+
+        return false;
+    }
+
+    uint32_t ThreadPool::processorOf(const uint32_t worker_id) const noexcept {
+        if (!processors.empty()) {
+            return processors[worker_id % processors.size()];
+        }
+
+        // Topology is unknown, so workers are spread over processors in id order.
+        return worker_id % std::max(1u, std::thread::hardware_concurrency());
+    }
+}
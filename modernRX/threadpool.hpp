@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+* Persistent, pinned and work-stealing thread pool shared by all parallel phases of modernRX (dataset generation, hashing).
+* Threads are created once per process, so no phase pays for thread creation and thread placement is decided in one place.
+* Not a part of RandomX algorithm.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace modernRX {
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        // Returns process-wide pool with one worker per logical processor. Created on first use.
+        [[nodiscard]] static ThreadPool& global();
+
+        // Creates pool with given number of workers and pins each of them to a single logical processor.
+        // Workers are pinned physical cores first, so worker i and i + 1 do not share a core as long as possible.
+        [[nodiscard]] explicit ThreadPool(const uint32_t worker_count = std::thread::hardware_concurrency());
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        // Schedules task on any worker. Idle workers steal tasks queued on busy ones.
+        void submit(Task task);
+
+        // Schedules task on given worker only. Such task is never stolen, so it always runs on processor the worker is pinned to.
+        // Meant for long-running tasks that rely on placement (e.g. VirtualMachine loops).
+        void submitTo(const uint32_t worker_id, Task task);
+
+        // Runs fn(task_id) for every task_id in range [0, task_count) and waits until all of them finish.
+        // Calling thread takes part in execution, so this makes progress even if all workers are busy.
+        // Rethrows first exception thrown by fn.
+        void parallelFor(const uint32_t task_count, const std::function<void(uint32_t)>& fn);
+
+        // Returns number of workers.
+        [[nodiscard]] uint32_t size() const noexcept;
+
+        // Returns true if all workers were successfully pinned to their logical processors.
+        [[nodiscard]] bool pinned() const noexcept;
+
+    private:
+        struct Worker {
+            std::mutex mutex; // Guards both task queues.
+            std::deque<Task> tasks; // Tasks that can be stolen by other workers.
+            std::deque<Task> own_tasks; // Tasks that can be executed only by this worker.
+            std::atomic<uint32_t> own_tasks_count{ 0 }; // Size of own_tasks readable without locking.
+            std::thread thread;
+        };
+
+        std::vector<uint32_t> processors; // Logical processors in pinning order, physical cores first. Empty if topology is unknown.
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::mutex sleep_mutex; // Guards stopping flag and is used to park idle workers.
+        std::condition_variable sleep_cv;
+        std::atomic<uint32_t> stealable_tasks_count{ 0 }; // Number of tasks waiting in all workers' stealable queues.
+        std::atomic<uint32_t> next_worker{ 0 }; // Round-robin counter for submit.
+        std::atomic<uint32_t> pinned_workers{ 0 };
+        bool stopping{ false };
+
+        void work(const uint32_t worker_id);
+
+        // Pops and runs a single task: own task first, then own stealable task, then steals from other workers.
+        // Returns false if no task was found.
+        bool tryRun(const uint32_t worker_id);
+
+        // Steals and runs a single task from any worker, starting from given one. Returns false if no task was found.
+        bool trySteal(const uint32_t start_worker_id);
+
+        // Returns logical processor that worker with given id should be pinned to.
+        [[nodiscard]] uint32_t processorOf(const uint32_t worker_id) const noexcept;
+    };
+}
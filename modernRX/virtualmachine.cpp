@@ -24,14 +24,29 @@ namespace modernRX {
         constexpr auto Sp_Offset{ Rf_Offset + 256 };
     }
 
-    VirtualMachine::VirtualMachine(std::span<std::byte, Required_Memory> scratchpad, JITRxProgram jit, const uint32_t vm_id)
-        : memory(scratchpad), jit(jit) {
-        std::memcpy(jit, Code_Buffer.data(), sizeof(Code_Buffer));
-        compiler.code_buffer = reinterpret_cast<char*>(jit) + Program_Offset;
+    VirtualMachine::VirtualMachine(std::span<std::byte, Required_Memory> scratchpad, JITRxBuffer jit_buffer, const uint32_t vm_id)
+        : memory(scratchpad) {
+        static_assert(Required_Code_Memory == Code_Buffers_Count * sizeof(Code_Buffer));
+
+        for (uint32_t i = 0; i < Code_Buffers_Count; ++i) {
+            jit_code[i] = jit_buffer.code + i * sizeof(Code_Buffer);
+            std::memcpy(jit_code[i], Code_Buffer.data(), sizeof(Code_Buffer));
+
+            // Code buffer may not start with function entry, depending on calling convention.
+            jit[i] = reinterpret_cast<JITRxProgram>(reinterpret_cast<const char*>(jit_buffer.program) + i * sizeof(Code_Buffer) + Entry_Offset);
+        }
+
         pdata.vm_id = vm_id;
     }
 
     void VirtualMachine::reset(BlockTemplate block_template, const_span<DatasetItem> dataset) noexcept {
+        std::array<std::byte, 64> template_seed;
+        blake2b::hash(template_seed, block_template.view());
+        reset(block_template, dataset, template_seed);
+    }
+
+    void VirtualMachine::reset(BlockTemplate block_template, const_span<DatasetItem> dataset, const_span<std::byte, 64> seed) noexcept {
+        std::copy(seed.begin(), seed.end(), this->seed.begin());
         this->dataset = dataset;
         this->block_template = block_template;
         this->new_block_template = true;
@@ -52,7 +67,7 @@ namespace modernRX {
 
     FloatingEnv global_fenv{};
 
-    void VirtualMachine::executeNext(std::function<void(const RxHash&)> callback) noexcept{
+    void VirtualMachine::executeNext(std::function<void(const RxHash&)> callback, const_span<std::byte> next_seed, const bool prepare_next) noexcept{
         const intrinsics::sse::FloatEnvironment fenv{};
         constexpr uint64_t Dataset_Extra_Items{ Rx_Dataset_Extra_Size / sizeof(DatasetItem) };
         static_assert(Dataset_Extra_Items == 524'287);
@@ -68,7 +83,6 @@ namespace modernRX {
 
         RxProgram program;
         const auto program_ptr{ reinterpret_cast<uintptr_t>(&program) };
-        compiler.program = &program;
 
         for (uint32_t i = 0; i < Rx_Program_Count - 1; ++i) {
             generateProgram(program);
@@ -76,7 +90,7 @@ namespace modernRX {
 
             *other_consts_ptr = OtherConsts{};
             *fenv_ptr = FloatingEnv{};
-            jit(scratchpad_ptr, dataset_ptr, program_ptr, global_ptr);
+            jit[jit_index](scratchpad_ptr, dataset_ptr, program_ptr, global_ptr);
 
             blake2b::hash(seed, span_cast<std::byte, sizeof(RegisterFile)>(reinterpret_cast<std::byte*>(rf_ptr)));
         }
@@ -96,20 +110,30 @@ namespace modernRX {
             Trace<TraceEvent::Execute> _;
             *other_consts_ptr = OtherConsts{};
             *fenv_ptr = FloatingEnv{};
-            jit(scratchpad_ptr, dataset_ptr, program_ptr, global_ptr);
+            jit[jit_index](scratchpad_ptr, dataset_ptr, program_ptr, global_ptr);
         }
 
 
         {
             Trace<TraceEvent::HashAndFill> _;
 
-            // Hash and fill for next iteration.
-            block_template.next();
-            blake2b::hash(seed, block_template.view());
-
             const auto rfa_view{ span_cast<std::byte, sizeof(RegisterFile::a)>(reinterpret_cast<std::byte*>(scratchpad_ptr - sizeof(RegisterFile::a))) };
             const auto scratchpad_view{ std::span<std::byte>(reinterpret_cast<std::byte*>(scratchpad_ptr), Rx_Scratchpad_L3_Size) };
-            aes::hashAndFill1R(rfa_view, seed, scratchpad_view);
+
+            if (!prepare_next) {
+                // No hash follows, so neither next seed nor scratchpad fill is needed.
+                aes::hash1R(rfa_view, scratchpad_view);
+            } else {
+                // Hash and fill for next iteration.
+                if (next_seed.empty()) {
+                    block_template.next();
+                    blake2b::hash(seed, block_template.view());
+                } else {
+                    std::copy(next_seed.begin(), next_seed.end(), seed.begin());
+                }
+
+                aes::hashAndFill1R(rfa_view, seed, scratchpad_view);
+            }
 
             // Get final hash.
             const auto rf_view{ span_cast<std::byte, sizeof(RegisterFile)>(reinterpret_cast<std::byte*>(rf_ptr)) };
@@ -130,15 +154,39 @@ namespace modernRX {
         const auto scratchpad_ptr{ reinterpret_cast<uintptr_t>(memory.data()) + Sp_Offset };
         const auto scratchpad_view{ std::span<std::byte>(reinterpret_cast<std::byte*>(scratchpad_ptr), Rx_Scratchpad_L3_Size) };
 
-        // Initialize memory.
-        blake2b::hash(seed, block_template.view());
+        // Initialize memory. Seed was already calculated at reset.
         aes::fill1R(scratchpad_view, seed);
     }
 
+    void VirtualMachine::hashFirst(const_span<std::byte> input, const_span<DatasetItem> dataset) noexcept {
+        std::array<std::byte, 64> input_seed;
+        blake2b::hashAny(input_seed, input);
+
+        // Block template is never used, as seeds of following inputs are given explicitly and hashLast does not prepare next hash.
+        reset(BlockTemplate{}, dataset, input_seed);
+        execute(nullptr); // First 'execute' after reset does only initialization.
+    }
+
+    RxHash VirtualMachine::hashNext(const_span<std::byte> next_input) noexcept {
+        std::array<std::byte, 64> next_seed;
+        blake2b::hashAny(next_seed, next_input);
+
+        executeNext([](const RxHash&) noexcept {}, next_seed);
+        return output;
+    }
+
+    RxHash VirtualMachine::hashLast() noexcept {
+        executeNext([](const RxHash&) noexcept {}, {}, false);
+        return output;
+    }
+
+    RxHash VirtualMachine::hash(const_span<std::byte> input, const_span<DatasetItem> dataset) noexcept {
+        hashFirst(input, dataset);
+        return hashLast();
+    }
+
     void VirtualMachine::generateProgram(RxProgram& program) noexcept {
-        intrinsics::prefetch<intrinsics::PrefetchMode::T0, 1>(&compiler.Base_Cmpl_Addr);
         for (int i = 0; i < 8; ++i) {
-            intrinsics::prefetch<intrinsics::PrefetchMode::T0, 1>(LUT_Instr_Cmpl_Offsets.data() + 32);
             intrinsics::prefetch<intrinsics::PrefetchMode::T0, 1>(compiler.instr_offset.data() + 32);
         }
         aes::fill4R(span_cast<std::byte>(program), seed);
@@ -146,7 +194,13 @@ namespace modernRX {
     }
 
     void VirtualMachine::compileProgram(const RxProgram& program) noexcept {
+        // Compile into other code buffer than previous program was executed from.
+        // Writing code that was just executed (and may still be in instruction cache or in flight) causes machine clears.
+        jit_index = (jit_index + 1) % Code_Buffers_Count;
+        compiler.code_buffer = reinterpret_cast<char*>(jit_code[jit_index]) + Program_Offset;
         compiler.reset();
+        compiler.decode(program);
+        compiler.analyze(program);
 
         // RDI = rf
         // RSI = memory
@@ -154,71 +208,39 @@ namespace modernRX {
         
 
         // Compile all instructions.
-        for (uint32_t i = 0; i < program.instructions.size(); ) {
-            const RxInstruction& instr{ program.instructions[i++] };
-            const RxInstruction& instr2{ program.instructions[i++] };
-            const RxInstruction& instr3{ program.instructions[i++] };
-            const RxInstruction& instr4{ program.instructions[i++] };
-
-            const auto cmpl_func{ ForceCast<InstrCmpl>(compiler.Base_Cmpl_Addr + LUT_Instr_Cmpl_Offsets[instr.opcode]) };
-            const auto cmpl_func2{ ForceCast<InstrCmpl>(compiler.Base_Cmpl_Addr + LUT_Instr_Cmpl_Offsets[instr2.opcode]) };
-            const auto cmpl_func3{ ForceCast<InstrCmpl>(compiler.Base_Cmpl_Addr + LUT_Instr_Cmpl_Offsets[instr3.opcode]) };
-            const auto cmpl_func4{ ForceCast<InstrCmpl>(compiler.Base_Cmpl_Addr + LUT_Instr_Cmpl_Offsets[instr4.opcode]) };
-            i -= 4;
-
-            compiler.instr_offset[i] = compiler.code_size;
-            (compiler.*cmpl_func)(instr, i++);
-
-            compiler.instr_offset[i] = compiler.code_size;
-            (compiler.*cmpl_func2)(instr2, i++);
-
-            compiler.instr_offset[i] = compiler.code_size;
-            (compiler.*cmpl_func3)(instr3, i++);
-
-            compiler.instr_offset[i] = compiler.code_size;
-            (compiler.*cmpl_func4)(instr4, i++);
-        }
+        compiler.compile(program);
 
-        constexpr auto loop_finalization_offset{ Loop_Finalization_Offset_3 };
+        // Loop finalization reading registers selected by program's entropy is already in code buffer, only jump to it is needed.
+        const auto loop_finalization_offset{ finalizationVariantOffset(program.entropy[12]) };
         constexpr auto Jmp_Code_Size{ 5 };
         constexpr uint8_t nops[8]{ 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90 };
 
-        if (compiler.code_size < Max_Program_Size - Jmp_Code_Size) {
-            // do the jmp
+        const auto compile_jmp = [this, loop_finalization_offset]() {
             const auto jmp_pos{ Program_Offset + compiler.code_size + Jmp_Code_Size };
             const int32_t jmp_offset{ loop_finalization_offset - jmp_pos };
             const uint8_t jmp{ 0xe9 };
             std::memcpy(compiler.code_buffer + compiler.code_size, &jmp, sizeof(uint8_t));
             std::memcpy(compiler.code_buffer + compiler.code_size + 1, &jmp_offset, sizeof(int32_t));
             compiler.code_size += Jmp_Code_Size;
+        };
+
+        const auto jmp_padding{ compiler.layout.jumpPadding(compiler.code_size, Jmp_Code_Size) };
+        if (compiler.code_size + jmp_padding < Max_Program_Size - Jmp_Code_Size) {
+            // do the jmp
+            compiler.emitNops(jmp_padding);
+            compile_jmp();
             const auto nop_size{ std::min<uint32_t>(sizeof(nops), Max_Program_Size - compiler.code_size)};
             std::memcpy(compiler.code_buffer + compiler.code_size, nops, nop_size);
             compiler.code_size += nop_size;
         } else {
-            // fill with nops
+            // fill with nops and do the jmp right after program buffer
             std::memcpy(compiler.code_buffer + compiler.code_size, nops, Max_Program_Size - compiler.code_size);
             compiler.code_size += Max_Program_Size - compiler.code_size;
+            compile_jmp();
         }
 
-        // Compile finalize registers.
         static_assert(Cache_Line_Align_Mask == 0x7FFF'FFC0);
         static_assert(std::has_single_bit(Cache_Line_Size));
         static_assert(Scratchpad_L3_Mask64 == 0x001F'FFC0);
-
-        const uint8_t read_reg2 = static_cast<uint8_t>(0xc7 + 8 * (4 + ((program.entropy[12] >> 2) & 1)));
-        const auto rr2_offset{ 18 };
-        std::memcpy(reinterpret_cast<char*>(jit) + loop_finalization_offset + rr2_offset, &read_reg2, sizeof(uint8_t));
-
-        const uint8_t read_reg3 = static_cast<uint8_t>(0xc7 + 8 * (6 + ((program.entropy[12] >> 3) & 1)));
-        const auto rr3_offset{ 21 };
-        std::memcpy(reinterpret_cast<char*>(jit) + loop_finalization_offset + rr3_offset, &read_reg3, sizeof(uint8_t));
-
-        const uint8_t read_reg0 = static_cast<uint8_t>(0xc2 + 8 * (0 + ((program.entropy[12] >> 0) & 1)));
-        const auto rr0_offset{ 155 };
-        std::memcpy(reinterpret_cast<char*>(jit) + loop_finalization_offset + rr0_offset, &read_reg0, sizeof(uint8_t));
-
-        const uint8_t read_reg1 = static_cast<uint8_t>(0xc2 + 8 * (2 + ((program.entropy[12] >> 1) & 1)));
-        const auto rr1_offset{ 158 };
-        std::memcpy(reinterpret_cast<char*>(jit) + loop_finalization_offset + rr1_offset, &read_reg1, sizeof(uint8_t));
     }
 }
@@ -26,6 +26,12 @@ namespace modernRX {
     // global - pointer to global, read-only data shared by all VMs.
     using JITRxProgram = void(*)(const uintptr_t scratchpad, const uintptr_t dataset, const uintptr_t program, const uintptr_t global);
 
+    // Two views of the same VirtualMachine's JIT code buffer memory (see DualMappedMemory).
+    struct JITRxBuffer {
+        std::byte* code{ nullptr }; // Writable view. Programs are compiled into it, but it is never executed.
+        JITRxProgram program{ nullptr }; // Executable view. Programs are executed from it, but it is never written.
+    };
+
     // Forward declarations.
     struct ProgramContext;
     struct RxInstruction;
@@ -48,22 +54,50 @@ namespace modernRX {
         };
 
         static constexpr size_t Required_Memory{ Rx_Scratchpad_L3_Size + sizeof(VirtualMachine::RegisterFile) + Rx_Program_Bytes_Size };
+        static constexpr uint32_t Code_Buffers_Count{ 2 }; // Programs are compiled into alternating code buffers.
+        static constexpr size_t Required_Code_Memory{ Code_Buffers_Count * 16 * 1024 };
 
     public:
-        [[nodiscard]] explicit VirtualMachine(std::span<std::byte, Required_Memory>, JITRxProgram, const uint32_t = 0);
+        [[nodiscard]] explicit VirtualMachine(std::span<std::byte, Required_Memory>, JITRxBuffer, const uint32_t = 0);
 
         // Resets VirtualMachine with new input and dataset.
         // Another VirtualMachine with same input and dataset will produce same result.
         void reset(BlockTemplate block_template, const_span<DatasetItem> dataset) noexcept;
+
+        // Same as above, but with seed already calculated as Blake2b hash of block template.
+        // Allows to seed many VirtualMachines at once with blake2b::hashMany.
+        void reset(BlockTemplate block_template, const_span<DatasetItem> dataset, const_span<std::byte, 64> seed) noexcept;
         
         // Executes chained RandomX programs based on seed provided at creation.
         // Returns result as a 32-bytes hash of final RegisterFile.
         void execute(std::function<void(const RxHash&)> callback) noexcept;
 
+        // Streaming interface for a sequence of arbitrary inputs (e.g. verifying a queue of blocks), same as randomx_calculate_hash_first/next/last.
+        // hashFirst starts hashing of the first input, hashNext returns hash of the previous input and starts hashing of the given one,
+        // hashLast returns hash of the last input. Scratchpad for the next input is filled while previous hash finalizes, the same way execute
+        // does for consecutive nonces; hashLast skips that step, so hashFirst or reset has to be called before next hash.
+        // Inputs may have any size. Replaces block template and dataset set by reset.
+        void hashFirst(const_span<std::byte> input, const_span<DatasetItem> dataset) noexcept;
+        [[nodiscard]] RxHash hashNext(const_span<std::byte> next_input) noexcept;
+        [[nodiscard]] RxHash hashLast() noexcept;
+
+        // Returns hash of single input. Same as hashFirst followed by hashLast.
+        [[nodiscard]] RxHash hash(const_span<std::byte> input, const_span<DatasetItem> dataset) noexcept;
+
         static consteval size_t requiredMemory() noexcept {
             return Required_Memory;
         }
 
+        // Returns size of JIT code memory required by single VirtualMachine.
+        static consteval size_t requiredCodeMemory() noexcept {
+            return Required_Code_Memory;
+        }
+
+        // Returns size of register file, which is stored right before scratchpad.
+        static consteval size_t registerFileSize() noexcept {
+            return sizeof(RegisterFile);
+        }
+
         PData getPData() const noexcept {
             return pdata;
         }
@@ -77,7 +111,9 @@ namespace modernRX {
 
         // Executes chained RandomX programs based on seed provided at creation.
         // Returns result as a 32-bytes hash of final RegisterFile.
-        void executeNext(std::function<void(const RxHash&)> callback) noexcept;
+        // If next_seed is empty, the next block template is hashed to get it.
+        // If prepare_next is false (last hash of a stream), scratchpad is only hashed, not filled for the next hash.
+        void executeNext(std::function<void(const RxHash&)> callback, const_span<std::byte> next_seed = {}, const bool prepare_next = true) noexcept;
 
 
         std::array<std::byte, 64> seed;
@@ -85,7 +121,9 @@ namespace modernRX {
         std::span<const DatasetItem> dataset;
         std::span<std::byte, Required_Memory> memory;
         BytecodeCompiler compiler;
-        JITRxProgram jit{ nullptr };
+        std::array<std::byte*, Code_Buffers_Count> jit_code{}; // Writable views of JIT code buffers.
+        std::array<JITRxProgram, Code_Buffers_Count> jit{}; // Entry points in executable views of JIT code buffers.
+        uint32_t jit_index{ 0 }; // Index of code buffer with latest compiled program.
         PData pdata;
         alignas(32) RxHash output;
         bool new_block_template{ false };
@@ -1,20 +1,41 @@
 #include <array>
 
+#include "assemblerdef.hpp"
 #include "randomxparams.hpp"
 
 namespace modernRX {
     constexpr uint32_t Max_Program_Size{ Rx_Program_Size * 32 };
-    constexpr uint32_t Code_Buffer_Size{ (Max_Program_Size / 2) * 3 };
+    constexpr uint32_t Code_Buffer_Size{ Max_Program_Size * 2 };
     constexpr int32_t Prologue_Size{ 384 };
     constexpr int32_t Loop_Initialization_Size{ 192 };
     constexpr int32_t Program_Offset{ Prologue_Size + Loop_Initialization_Size };
     constexpr int32_t Loop_Finalization_Size{ 192 };
     constexpr int32_t Epilogue_Size{ 216 };
     constexpr int32_t Loop_Finalization_Offset_3{ Program_Offset + Max_Program_Size /* nops to align */ };
+    constexpr int32_t Epilogue_Offset{ Loop_Finalization_Offset_3 + Loop_Finalization_Size };
+    constexpr int32_t SysV_Entry_Offset{ Epilogue_Offset + 256 }; // Entry code for System V calling convention is put in unused space after epilogue.
+
+    // Loop finalization reads 4 registers selected by program's entropy. Instead of patching them into the code before every program,
+    // buffer holds immutable copy of loop finalization for every selection and program jumps to the one selected by its entropy.
+    // Code at Loop_Finalization_Offset_3 is only a template for these copies and its first bytes are overwritten by program's jump if program fills whole program buffer.
+    constexpr int32_t Finalization_Variants_Offset{ (Max_Program_Size / 2) * 3 };
+    constexpr int32_t Finalization_Variant_Size{ 192 };
+    constexpr int32_t Finalization_Variants_Count{ 16 };
+    static_assert(Finalization_Variants_Offset + Finalization_Variants_Count * Finalization_Variant_Size <= Code_Buffer_Size);
+
+    // Returns offset of loop finalization that reads registers selected by given program entropy value.
+    // https://github.com/tevador/RandomX/blob/master/doc/specs.md#465-memory-access
+    [[nodiscard]] constexpr int32_t finalizationVariantOffset(const uint64_t entropy) noexcept {
+        return Finalization_Variants_Offset + static_cast<int32_t>(entropy % Finalization_Variants_Count) * Finalization_Variant_Size;
+    }
+
+    // Offset of function entry in code buffer. Buffer is written for Win64 calling convention, other conventions enter through adapter code.
+    constexpr int32_t Entry_Offset{ assembler::Native_Calling_Convention == assembler::CallingConvention::Win64 ? 0 : SysV_Entry_Offset };
 
 // Explicitly disable "truncation of constant value" for the following array, for convenience.
 #pragma warning(disable: 4309)
-    constexpr alignas(4096) std::array<char, Code_Buffer_Size> Code_Buffer{ 
+    // Expects arguments passed according to Win64 calling convention: RCX - scratchpad, RDX - dataset, R8 - program, R9 - global.
+    constexpr alignas(4096) std::array<char, Code_Buffer_Size> Base_Code_Buffer{ 
         // Offset: 0 (prologue)
         0x48, 0x8D, 0x41, 0x80, 0x48, 0x89, 0x58, 0x80, 0x48, 0x89, 0x68, 0x88, 0x48, 0x89, 0xD3, 0x48,
         0x89, 0xC2, 0x41, 0x8B, 0x40, 0x68, 0x25, 0xFF, 0xFF, 0x07, 0x00, 0xC1, 0xE0, 0x06, 0x48, 0x8D,
@@ -850,5 +871,112 @@ namespace modernRX {
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
         // Offset: 12288
     };
+
+    // Adapts Win64 code buffer to System V calling convention:
+    //   * puts entry code that moves arguments to registers expected by prologue at SysV_Entry_Offset,
+    //   * replaces saving XMM6-XMM15 in prologue and restoring them in epilogue with nops of the same size, as these registers are volatile in System V.
+    // GPR saves are left untouched, they are not needed for RSI and RDI, but are interleaved with other instructions.
+    // Returns code buffer with all loop finalization variants (see finalizationVariantOffset).
+    [[nodiscard]] consteval std::array<char, Code_Buffer_Size> makeWin64CodeBuffer() {
+        constexpr int32_t Loop_Offset{ Prologue_Size }; // Loop initialization.
+        constexpr int32_t Loop_Counter_Offset{ 0xa9 }; // sub rbx, 1
+        constexpr int32_t Jcc_Code_Size{ 6 };
+        constexpr int32_t Jmp_Code_Size{ 5 };
+        static_assert(Loop_Counter_Offset + 4 + Jcc_Code_Size + Jmp_Code_Size <= Finalization_Variant_Size);
+
+        // Loop back-edge (sub rbx, 1 macro-fused with jne) must not cross or end on 32-byte boundary (JCC erratum), so it does not need padding.
+        // Its target (loop initialization) and program buffer are 64-byte aligned.
+        static_assert(Finalization_Variants_Offset % 32 == 0 && Finalization_Variant_Size % 32 == 0);
+        static_assert(Loop_Counter_Offset / 32 == (Loop_Counter_Offset + 4 + Jcc_Code_Size) / 32);
+        static_assert(Loop_Offset % 64 == 0 && Program_Offset % 64 == 0);
+
+        const auto write_rel32 = [](std::array<char, Code_Buffer_Size>& buffer, const int32_t pos, const int32_t value) {
+            for (int32_t i = 0; i < 4; ++i) {
+                buffer[pos + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        };
+
+        auto buffer{ Base_Code_Buffer };
+        for (int32_t variant = 0; variant < Finalization_Variants_Count; ++variant) {
+            const int32_t offset{ finalizationVariantOffset(variant) };
+
+            // Copy loop finalization up to and including loop counter decrement.
+            for (int32_t i = 0; i < Loop_Counter_Offset + 4; ++i) {
+                buffer[offset + i] = Base_Code_Buffer[Loop_Finalization_Offset_3 + i];
+            }
+
+            // Select registers read by finalization (same encoding as RandomX's readReg0-3).
+            buffer[offset + 18] = static_cast<char>(0xc7 + 8 * (4 + ((variant >> 2) & 1))); // xor edi, readReg2
+            buffer[offset + 21] = static_cast<char>(0xc7 + 8 * (6 + ((variant >> 3) & 1))); // xor edi, readReg3
+            buffer[offset + 155] = static_cast<char>(0xc2 + 8 * (0 + ((variant >> 0) & 1))); // mov rdx, readReg0
+            buffer[offset + 158] = static_cast<char>(0xc2 + 8 * (2 + ((variant >> 1) & 1))); // xor rdx, readReg1
+
+            // jne loop initialization; jmp epilogue
+            int32_t pos{ offset + Loop_Counter_Offset + 4 };
+            buffer[pos] = 0x0f;
+            buffer[pos + 1] = 0x85;
+            write_rel32(buffer, pos + 2, Loop_Offset - (pos + Jcc_Code_Size));
+            pos += Jcc_Code_Size;
+
+            buffer[pos] = 0xe9;
+            write_rel32(buffer, pos + 1, Epilogue_Offset - (pos + Jmp_Code_Size));
+            pos += Jmp_Code_Size;
+
+            // Unreachable, fill with int3.
+            for (; pos < offset + Finalization_Variant_Size; ++pos) {
+                buffer[pos] = 0xcc;
+            }
+        }
+
+        return buffer;
+    }
+
+    [[nodiscard]] consteval std::array<char, Code_Buffer_Size> makeSysVCodeBuffer() {
+        struct Patch {
+            int32_t offset;
+            int32_t size;
+        };
+
+        constexpr std::array<Patch, 20> Xmm_Saves_Restores{
+            // movaps xmmword ptr [rbx/rcx + disp8], xmm6-xmm15
+            Patch{ 0x8d, 4 }, Patch{ 0x91, 4 }, Patch{ 0xc9, 5 }, Patch{ 0xce, 5 }, Patch{ 0xdc, 4 },
+            Patch{ 0xe0, 5 }, Patch{ 0xef, 5 }, Patch{ 0xf4, 5 }, Patch{ 0xfd, 5 }, Patch{ 0x102, 5 },
+            // movaps xmm6-xmm15, xmmword ptr [rcx + disp8]
+            Patch{ Epilogue_Offset + 0x60, 4 }, Patch{ Epilogue_Offset + 0x68, 4 }, Patch{ Epilogue_Offset + 0x70, 5 }, Patch{ Epilogue_Offset + 0x79, 5 },
+            Patch{ Epilogue_Offset + 0x8a, 4 }, Patch{ Epilogue_Offset + 0x91, 5 }, Patch{ Epilogue_Offset + 0xaa, 5 }, Patch{ Epilogue_Offset + 0xb3, 5 },
+            Patch{ Epilogue_Offset + 0xbc, 5 }, Patch{ Epilogue_Offset + 0xc5, 5 },
+        };
+
+        constexpr std::array<char, 4> Nop4{ 0x0f, 0x1f, 0x40, 0x00 };
+        constexpr std::array<char, 5> Nop5{ 0x0f, 0x1f, 0x44, 0x00, 0x00 };
+
+        auto buffer{ makeWin64CodeBuffer() };
+        for (const auto& patch : Xmm_Saves_Restores) {
+            for (int32_t i = 0; i < patch.size; ++i) {
+                buffer[patch.offset + i] = patch.size == 4 ? Nop4[i] : Nop5[i];
+            }
+        }
+
+        // RDI - scratchpad, RSI - dataset, RDX - program, RCX - global.
+        constexpr int32_t Entry_Code_Size{ 17 };
+        constexpr int32_t Jmp_Offset{ -(SysV_Entry_Offset + Entry_Code_Size) }; // Jump to prologue at offset 0.
+        const std::array<char, Entry_Code_Size> entry_code{
+            0x49, 0x89, 0xC9, // mov r9, rcx
+            0x49, 0x89, 0xD0, // mov r8, rdx
+            0x48, 0x89, 0xF2, // mov rdx, rsi
+            0x48, 0x89, 0xF9, // mov rcx, rdi
+            0xE9, static_cast<char>(Jmp_Offset & 0xff), static_cast<char>((Jmp_Offset >> 8) & 0xff), static_cast<char>((Jmp_Offset >> 16) & 0xff), static_cast<char>((Jmp_Offset >> 24) & 0xff), // jmp prologue
+        };
+
+        for (int32_t i = 0; i < Entry_Code_Size; ++i) {
+            buffer[SysV_Entry_Offset + i] = entry_code[i];
+        }
+
+        return buffer;
+    }
 #pragma warning(default: 4309)
+
+    constexpr alignas(4096) std::array<char, Code_Buffer_Size> Code_Buffer{
+        assembler::Native_Calling_Convention == assembler::CallingConvention::Win64 ? makeWin64CodeBuffer() : makeSysVCodeBuffer()
+    };
 }
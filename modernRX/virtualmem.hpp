@@ -1,16 +1,25 @@
 #pragma once
 
 /*
-* Wrapper over Windows virtual memory API.
+* Wrapper over platform virtual memory API (Windows and POSIX).
 * Used to allocate executable memory for JIT-compiled programs.
+* Memory is never writable and executable at the same virtual address (W^X).
 */
 
+#ifdef _WIN32
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include <cstdint>
+#include <cstring>
 #include <format>
+#include <utility>
 
 #include "aliases.hpp"
 #include "exception.hpp"
@@ -41,6 +50,7 @@ namespace modernRX {
     [[nodiscard]] constexpr jit_function_ptr<Fn> makeExecutable(const Code&& code, Data&& data) {
         const auto code_size{ as_span(code).size_bytes() };
 
+#ifdef _WIN32
         // Alloc buffer for writing code.
         auto buffer{ VirtualAlloc(nullptr, code_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE) };
         if (buffer == nullptr) {
@@ -61,21 +71,155 @@ namespace modernRX {
             VirtualFree(ptr, 0, MEM_RELEASE); // Ignore error.
             // moved_data will be destroyed and release memory here automatically.
         });
-    }
-
-    // Allocates executable memory that is also writeable (not protected).
-    // Use for performance when code buffers are allocated and changed frequently.
-    // May throw if memory allocation fails.
-    template<typename Fn>
-    [[nodiscard]] constexpr jit_function_ptr<Fn> makeExecutable(const size_t code_size) {
+#else
         // Alloc buffer for writing code.
-        const auto buffer{ VirtualAlloc(nullptr, code_size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE) };
-        if (buffer == nullptr) {
-            throw Exception(std::format("Failed to allocate memory with error: {:d}", GetLastError()));
+        auto buffer{ mmap(nullptr, code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+        if (buffer == MAP_FAILED) {
+            throw Exception(std::format("Failed to allocate memory with error: {:d}", errno));
+        }
+
+        std::memcpy(buffer, code.data(), code_size);
+
+        // Protect from writing, but make code executable.
+        if (mprotect(buffer, code_size, PROT_READ | PROT_EXEC) != 0) {
+            const auto err{ errno };
+            munmap(buffer, code_size); // Ignore error.
+            throw Exception(std::format("Failed to protect memory with error: {:d}", err));
         }
 
-        return jit_function_ptr<Fn>(reinterpret_cast<Fn*>(buffer), [](Fn* ptr) noexcept {
-            VirtualFree(ptr, 0, MEM_RELEASE); // Ignore error.           
+        return jit_function_ptr<Fn>(reinterpret_cast<Fn*>(buffer), [code_size, moved_data = std::move(data)](Fn* ptr) noexcept {
+            munmap(ptr, code_size); // Ignore error.
+            // moved_data will be destroyed and release memory here automatically.
         });
+#endif
     }
+
+    // Memory mapped twice onto the same physical pages: read-write view for code generation and read-execute view for execution.
+    // Code written through writable view is immediately visible through executable view, so frequently regenerated code
+    // (e.g. RandomX programs) can be rewritten without page protection changes and without RWX mappings,
+    // which hardened systems (SELinux deny_execmem, PaX MPROTECT) refuse.
+    // May throw if memory allocation or mapping fails.
+    class DualMappedMemory {
+    public:
+        [[nodiscard]] explicit DualMappedMemory() noexcept = default;
+        [[nodiscard]] explicit DualMappedMemory(const size_t size)
+            : size_(size) {
+#ifdef _WIN32
+            const auto section{ CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+                                                   static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr) };
+            if (section == nullptr) {
+                throw Exception(std::format("Failed to create memory section with error: {:d}", GetLastError()));
+            }
+
+            // Error code is captured right after failing call, as later successful calls may overwrite it.
+            DWORD err{ 0 };
+            writable_ = static_cast<std::byte*>(MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, size));
+            if (writable_ == nullptr) {
+                err = GetLastError();
+            } else {
+                executable_ = static_cast<std::byte*>(MapViewOfFile(section, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, size));
+                if (executable_ == nullptr) {
+                    err = GetLastError();
+                }
+            }
+
+            CloseHandle(section); // Views keep section alive.
+#else
+            const auto fd{ memfd_create("modernRX-jit", MFD_CLOEXEC) };
+            if (fd == -1) {
+                throw Exception(std::format("Failed to create memory file with error: {:d}", errno));
+            }
+
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                const auto err{ errno };
+                close(fd); // Ignore error.
+                throw Exception(std::format("Failed to resize memory file with error: {:d}", err));
+            }
+
+            // Error code is captured right after failing call, as later successful calls may overwrite it.
+            int err{ 0 };
+            const auto writable{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+            if (writable == MAP_FAILED) {
+                err = errno;
+            } else {
+                writable_ = static_cast<std::byte*>(writable);
+
+                const auto executable{ mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0) };
+                if (executable == MAP_FAILED) {
+                    err = errno;
+                } else {
+                    executable_ = static_cast<std::byte*>(executable);
+                }
+            }
+
+            close(fd); // Mappings keep file alive.
+#endif
+            if (writable_ == nullptr || executable_ == nullptr) {
+                release();
+                throw Exception(std::format("Failed to map memory with error: {:d}", err));
+            }
+        }
+
+        ~DualMappedMemory() noexcept {
+            release();
+        }
+
+        DualMappedMemory(const DualMappedMemory&) = delete;
+        DualMappedMemory& operator=(const DualMappedMemory&) = delete;
+        [[nodiscard]] DualMappedMemory(DualMappedMemory&& other) noexcept
+            : writable_(std::exchange(other.writable_, nullptr)), executable_(std::exchange(other.executable_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+        DualMappedMemory& operator=(DualMappedMemory&& other) noexcept {
+            if (this != &other) {
+                release();
+                writable_ = std::exchange(other.writable_, nullptr);
+                executable_ = std::exchange(other.executable_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+            }
+
+            return *this;
+        }
+
+        // Returns writable view of memory at given offset. Must not be executed.
+        [[nodiscard]] std::byte* writable(const size_t offset = 0) const noexcept {
+            return writable_ + offset;
+        }
+
+        // Returns executable view of memory at given offset as a function pointer. Must not be written.
+        template<typename Fn>
+        requires std::is_pointer_v<Fn> && std::is_function_v<std::remove_pointer_t<Fn>>
+        [[nodiscard]] Fn executable(const size_t offset = 0) const noexcept {
+            return reinterpret_cast<Fn>(executable_ + offset);
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return size_;
+        }
+
+    private:
+        std::byte* writable_{ nullptr };
+        std::byte* executable_{ nullptr };
+        size_t size_{ 0 };
+
+        void release() noexcept {
+#ifdef _WIN32
+            if (writable_ != nullptr) {
+                UnmapViewOfFile(writable_); // Ignore error.
+            }
+
+            if (executable_ != nullptr) {
+                UnmapViewOfFile(executable_); // Ignore error.
+            }
+#else
+            if (writable_ != nullptr) {
+                munmap(writable_, size_); // Ignore error.
+            }
+
+            if (executable_ != nullptr) {
+                munmap(executable_, size_); // Ignore error.
+            }
+#endif
+            writable_ = nullptr;
+            executable_ = nullptr;
+        }
+    };
 }
@@ -1,16 +1,34 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <format>
 #include <functional>
+#include <latch>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <print>
 #include <source_location>
+#include <thread>
+#include <vector>
 
 #include "aes1rhash.hpp"
 #include "aes1rrandom.hpp"
 #include "aes4rrandom.hpp"
 #include "argon2d.hpp"
+#include "assembler.hpp"
+#include "asynchasher.hpp"
 #include "blake2b.hpp"
 #include "blake2brandom.hpp"
+#include "bytecodecompiler.hpp"
 #include "cast.hpp"
 #include "dataset.hpp"
+#include "exception.hpp"
+#include "hashcache.hpp"
 #include "hasher.hpp"
+#include "isa.hpp"
+#include "randomx.h"
 #include "randomxparams.hpp"
 #include "reciprocal.hpp"
 #include "superscalar.hpp"
@@ -83,7 +101,25 @@ void runTest(const std::string_view name, const bool condition, std::function<vo
     }
 }
 
+// Runs test once for every instruction set that has dispatched kernels. Instruction sets unsupported by current CPU are skipped.
+void runIsaTest(const std::string_view name, std::function<void()> test) {
+    for (const auto isa : { Isa::AVX512, Isa::AVX2 }) {
+        runTest(std::format("{:s} [{:s}]", name, isaName(isa)), isaSupported(isa), [&] {
+            selectIsa(isa);
+            test();
+        });
+
+        selectIsa(detectIsa());
+    }
+}
+
+// Returns 4-batch compiler mode available for selected instruction set.
+[[nodiscard]] DatasetCompilerMode alternativeDatasetCompilerMode() noexcept {
+    return selectedIsa() == Isa::AVX512 ? DatasetCompilerMode::YMM : DatasetCompilerMode::AVX2;
+}
+
 void testBlake2bHash();
+void testBlake2bHashMany();
 void testArgon2dBlake2bHash();
 void testArgon2dFillMemory();
 void testAesGenerator1RFill();
@@ -92,22 +128,47 @@ void testAesHash1R();
 void testBlake2bRandom();
 void testSuperscalarGenerate();
 void testReciprocal();
+void testAssemblerEncoding();
+void testCodeLayoutPolicy();
+void testBytecodeDecode();
 void testDatasetGenerate();
+void testDatasetGenerateRange();
+void testDataset();
 void testVM();
+void testHashCache();
+void testCApi();
+void testAsyncHasher();
+void testHasherJobs();
+void testHasherReset();
+void testHasherParking();
+void testHasherElastic();
 
 
 int main() {
-    runTest("Blake2b::hash", true, testBlake2bHash);
-    runTest("Argon2d::Blake2b::hash", true, testArgon2dBlake2bHash);
-    runTest("Argon2d::fillMemory", true, testArgon2dFillMemory);
-    runTest("AesGenerator1R::fill", true, testAesGenerator1RFill);
-    runTest("AesGenerator4R::fill", true, testAesGenerator4RFill);
-    runTest("AesHash1R", true, testAesHash1R);
-    runTest("Blake2brandom::get", true, testBlake2bRandom);
+    runIsaTest("Blake2b::hash", testBlake2bHash);
+    runIsaTest("Blake2b::hashMany", testBlake2bHashMany);
+    runIsaTest("Argon2d::Blake2b::hash", testArgon2dBlake2bHash);
+    runIsaTest("Argon2d::fillMemory", testArgon2dFillMemory);
+    runIsaTest("AesGenerator1R::fill", testAesGenerator1RFill);
+    runIsaTest("AesGenerator4R::fill", testAesGenerator4RFill);
+    runIsaTest("AesHash1R", testAesHash1R);
+    runIsaTest("Blake2brandom::get", testBlake2bRandom);
     runTest("Reciprocal", true, testReciprocal);
+    runTest("Assembler::encoding", true, testAssemblerEncoding);
+    runTest("CodeLayoutPolicy::jumpPadding", true, testCodeLayoutPolicy);
+    runIsaTest("BytecodeCompiler::decode", testBytecodeDecode);
     runTest("Superscalar::generate", true, testSuperscalarGenerate);
-    runTest("Dataset::generate", true, testDatasetGenerate);
-    runTest("VirtualMachine::execute", true, testVM);
+    runIsaTest("Dataset::generate", testDatasetGenerate);
+    runIsaTest("Dataset::generateRange", testDatasetGenerateRange);
+    runIsaTest("Dataset::reset", testDataset);
+    runIsaTest("VirtualMachine::execute", testVM);
+    runTest("HashCache", true, testHashCache);
+    runTest("randomx_calculate_hash", true, testCApi);
+    runTest("AsyncHasher::hash", true, testAsyncHasher);
+    runTest("Hasher::addJob", true, testHasherJobs);
+    runTest("Hasher::reset", true, testHasherReset);
+    runTest("Hasher::setActiveVMs", true, testHasherParking);
+    runTest("Hasher::startElastic", true, testHasherElastic);
 }
 
 
@@ -155,6 +216,74 @@ void testBlake2bHash() {
 
     blake2b::hash(hash, data3);
     testAssert(hash == expected);
+
+    // Inputs not supported by hash.
+    blake2b::hashAny(hash, data3);
+    testAssert(hash == expected);
+
+    std::array<std::byte, 300> data4{};
+    data4.fill(std::byte{ 0x37 });
+
+    expected = byte_array(
+        0x82, 0xfc, 0xa8, 0x5e, 0x25, 0xc7, 0x5f, 0x3f, 0xe4, 0x68, 0x85, 0x5c, 0x0a, 0x63, 0xda, 0x88,
+        0x93, 0xf0, 0xde, 0xb9, 0xba, 0x5b, 0x8b, 0x72, 0x89, 0xdf, 0x97, 0xa5, 0x78, 0xf3, 0x51, 0x0d,
+        0x7b, 0x09, 0x4c, 0xff, 0xc0, 0x30, 0x6d, 0xaa, 0x5b, 0xf9, 0xa1, 0x05, 0x15, 0x5b, 0x44, 0xaa,
+        0xf6, 0xdc, 0xc4, 0x38, 0x7f, 0xf1, 0x2c, 0x8a, 0x83, 0xa3, 0x30, 0x62, 0xc2, 0xb0, 0x51, 0x49
+    );
+
+    blake2b::hashAny(hash, data4);
+    testAssert(hash == expected);
+
+    expected = byte_array(
+        0x7c, 0x3d, 0x90, 0x34, 0xc8, 0x8f, 0x2a, 0x45, 0xcc, 0x27, 0x72, 0x60, 0x0a, 0xfa, 0xa3, 0x23,
+        0x25, 0xe1, 0xbb, 0x78, 0xe6, 0x7e, 0x9e, 0x54, 0x7c, 0xa0, 0x7b, 0x84, 0x1c, 0x49, 0x11, 0xbf,
+        0xde, 0x58, 0xf0, 0x43, 0x85, 0xe5, 0x15, 0x12, 0xee, 0xce, 0xda, 0xbc, 0xe7, 0xf3, 0x43, 0xc6,
+        0x2f, 0x53, 0x0a, 0xec, 0xcd, 0xc4, 0x7b, 0x66, 0x2b, 0xc3, 0x61, 0x01, 0xae, 0xea, 0xd4, 0xb0
+    );
+
+    blake2b::hashAny(hash, std::span(data4).first(200));
+    testAssert(hash == expected);
+
+    expected = byte_array(
+        0x78, 0x6a, 0x02, 0xf7, 0x42, 0x01, 0x59, 0x03, 0xc6, 0xc6, 0xfd, 0x85, 0x25, 0x52, 0xd2, 0x72,
+        0x91, 0x2f, 0x47, 0x40, 0xe1, 0x58, 0x47, 0x61, 0x8a, 0x86, 0xe2, 0x17, 0xf7, 0x1f, 0x54, 0x19,
+        0xd2, 0x5e, 0x10, 0x31, 0xaf, 0xee, 0x58, 0x53, 0x13, 0x89, 0x64, 0x44, 0x93, 0x4e, 0xb0, 0x4b,
+        0x90, 0x3a, 0x68, 0x5b, 0x14, 0x48, 0xb7, 0x55, 0xd5, 0x6f, 0x70, 0x1a, 0xfe, 0x9b, 0xe2, 0xce
+    );
+
+    blake2b::hashAny(hash, std::span(data4).first(0));
+    testAssert(hash == expected);
+}
+
+void testBlake2bHashMany() {
+    // Every lane must produce the same hash as single-buffer version, regardless of number of messages in batch.
+    for (const size_t input_size : { 1u, 64u, Rx_Block_Template_Size, 128u, 256u }) {
+        for (const size_t digest_size : { 32, 64 }) {
+            for (uint32_t count = 1; count <= blake2b::Multi_Buffer_Lanes; ++count) {
+                std::array<std::array<std::byte, 256>, blake2b::Multi_Buffer_Lanes> data;
+                std::array<std::array<std::byte, 64>, blake2b::Multi_Buffer_Lanes> hashes;
+                std::array<std::span<const std::byte>, blake2b::Multi_Buffer_Lanes> inputs;
+                std::array<std::span<std::byte>, blake2b::Multi_Buffer_Lanes> outputs;
+
+                for (uint32_t lane = 0; lane < count; ++lane) {
+                    for (size_t i = 0; i < input_size; ++i) {
+                        data[lane][i] = static_cast<std::byte>(lane * 31 + i);
+                    }
+
+                    inputs[lane] = std::span(data[lane]).first(input_size);
+                    outputs[lane] = std::span(hashes[lane]).first(digest_size);
+                }
+
+                blake2b::hashMany(std::span(outputs).first(count), std::span(inputs).first(count));
+
+                for (uint32_t lane = 0; lane < count; ++lane) {
+                    std::array<std::byte, 64> expected;
+                    blake2b::hash(std::span(expected).first(digest_size), inputs[lane]);
+                    testAssert(std::equal(expected.begin(), expected.begin() + digest_size, hashes[lane].begin()));
+                }
+            }
+        }
+    }
 }
 
 void testArgon2dBlake2bHash() {
@@ -455,6 +584,104 @@ void testReciprocal() {
     testAssert(reciprocal(0xffffffff) == 9223372039002259456U);
 }
 
+void testAssemblerEncoding() {
+    using namespace assembler;
+    using namespace assembler::registers;
+
+    struct Encoding {
+        std::function<void(Context&)> emit;
+        std::vector<uint8_t> expected;
+    };
+
+    // Expected bytes come from GNU as; covers high registers, masking, broadcast, compressed disp8 and embedded rounding.
+    const std::vector<Encoding> encodings{
+        { [](auto& a) { a.vpaddq(ZMM17, ZMM30, ZMM9); }, { 0x62, 0xc1, 0x8d, 0x40, 0xd4, 0xc9 } }, // vpaddq zmm17, zmm30, zmm9
+        { [](auto& a) { a.vpaddq(Register::ZMM(24), ZMM8, ZMM31); }, { 0x62, 0x01, 0xbd, 0x48, 0xd4, 0xc7 } }, // vpaddq zmm24, zmm8, zmm31
+        { [](auto& a) { a.vpaddq(ZMM1, ZMM2, RSI[64]); }, { 0x62, 0xf1, 0xed, 0x48, 0xd4, 0x4e, 0x01 } }, // vpaddq zmm1, zmm2, [rsi+64]
+        { [](auto& a) { a.vpaddq(ZMM1, ZMM2, RSI[72]); }, { 0x62, 0xf1, 0xed, 0x48, 0xd4, 0x8e, 0x48, 0x00, 0x00, 0x00 } }, // vpaddq zmm1, zmm2, [rsi+72]
+        { [](auto& a) { a.vpaddq(ZMM1, ZMM2, Memory::BCST(RBX[-8])); }, { 0x62, 0xf1, 0xed, 0x58, 0xd4, 0x4b, 0xff } }, // vpaddq zmm1, zmm2, qword bcst [rbx-8]
+        { [](auto& a) { a.vpaddq(ZMM20, ZMM2, Memory::BCST(R12[1024])); }, { 0x62, 0xc1, 0xed, 0x58, 0xd4, 0xa4, 0x24, 0x00, 0x04, 0x00, 0x00 } }, // vpaddq zmm20, zmm2, qword bcst [r12+1024]
+        { [](auto& a) { a.vpaddq(ZMM1, ZMM2, Memory::BCST(RBX[2048])); }, { 0x62, 0xf1, 0xed, 0x58, 0xd4, 0x8b, 0x00, 0x08, 0x00, 0x00 } }, // vpaddq zmm1, zmm2, qword bcst [rbx+2048]
+        { [](auto& a) { a.vpxor(ZMM16, ZMM17, Memory::BCST(RBX[-256])); }, { 0x62, 0xe1, 0xf5, 0x50, 0xef, 0x43, 0xe0 } }, // vpxorq zmm16, zmm17, qword bcst [rbx-256]
+        { [](auto& a) { a.vpmullq(ZMM3, ZMM3, Memory::BCST(R10[8])); }, { 0x62, 0xd2, 0xe5, 0x58, 0x40, 0x5a, 0x01 } }, // vpmullq zmm3, zmm3, qword bcst [r10+8]
+        { [](auto& a) { a.vpmullq(YMM3, YMM4, YMM5); }, { 0x62, 0xf2, 0xdd, 0x28, 0x40, 0xdd } }, // vpmullq ymm3, ymm4, ymm5
+        { [](auto& a) { a.vpmullq(YMM3, YMM4, RAX[96]); }, { 0x62, 0xf2, 0xdd, 0x28, 0x40, 0x58, 0x03 } }, // vpmullq ymm3, ymm4, [rax+96]
+        { [](auto& a) { a.vpmullq(Register::XMM(3), Register::XMM(20), Register::XMM(5)); }, { 0x62, 0xf2, 0xdd, 0x00, 0x40, 0xdd } }, // vpmullq xmm3, xmm20, xmm5
+        { [](auto& a) { a.vprorq(YMM3, YMM9, 63); }, { 0x62, 0xd1, 0xe5, 0x28, 0x72, 0xc1, 0x3f } }, // vprorq ymm3, ymm9, 63
+        { [](auto& a) { a.vprorq(ZMM19, ZMM9, 7); }, { 0x62, 0xd1, 0xe5, 0x40, 0x72, 0xc1, 0x07 } }, // vprorq zmm19, zmm9, 7
+        { [](auto& a) { a.vprorq(ZMM1, ZMM2, 7, Mask::Z(K3)); }, { 0x62, 0xf1, 0xf5, 0xcb, 0x72, 0xc2, 0x07 } }, // vprorq zmm1{k3}{z}, zmm2, 7
+        { [](auto& a) { a.vpsubq(ZMM1, ZMM1, ZMM5, K1); }, { 0x62, 0xf1, 0xf5, 0x49, 0xfb, 0xcd } }, // vpsubq zmm1{k1}, zmm1, zmm5
+        { [](auto& a) { a.vpsubq(ZMM1, ZMM1, ZMM5, Mask::Z(K7)); }, { 0x62, 0xf1, 0xf5, 0xcf, 0xfb, 0xcd } }, // vpsubq zmm1{k7}{z}, zmm1, zmm5
+        { [](auto& a) { a.vpmullq(ZMM1, ZMM2, ZMM3, K2); }, { 0x62, 0xf2, 0xed, 0x4a, 0x40, 0xcb } }, // vpmullq zmm1{k2}, zmm2, zmm3
+        { [](auto& a) { a.vpsrlq(ZMM25, ZMM17, 32); }, { 0x62, 0xb1, 0xb5, 0x40, 0x73, 0xd1, 0x20 } }, // vpsrlq zmm25, zmm17, 32
+        { [](auto& a) { a.vpshufd(ZMM22, ZMM1, 0xb1); }, { 0x62, 0xe1, 0x7d, 0x48, 0x70, 0xf1, 0xb1 } }, // vpshufd zmm22, zmm1, 0xb1
+        { [](auto& a) { a.vshufi64x2(ZMM1, ZMM18, ZMM27, 0x44); }, { 0x62, 0x93, 0xed, 0x40, 0x43, 0xcb, 0x44 } }, // vshufi64x2 zmm1, zmm18, zmm27, 0x44
+        { [](auto& a) { a.vpmovq2m(K1, ZMM21); }, { 0x62, 0xb2, 0xfe, 0x48, 0x39, 0xcd } }, // vpmovq2m k1, zmm21
+        { [](auto& a) { a.vpbroadcastq(ZMM29, R13); }, { 0x62, 0x42, 0xfd, 0x48, 0x7c, 0xed } }, // vpbroadcastq zmm29, r13
+        { [](auto& a) { a.vmovdqa(ZMM30, RSP[128]); }, { 0x62, 0x61, 0xfd, 0x48, 0x6f, 0x74, 0x24, 0x02 } }, // vmovdqa64 zmm30, [rsp+128]
+        { [](auto& a) { a.vmovdqa(RSP[-64], ZMM12); }, { 0x62, 0x71, 0xfd, 0x48, 0x7f, 0x64, 0x24, 0xff } }, // vmovdqa64 [rsp-64], zmm12
+        { [](auto& a) { a.vmovntdq(R10[RCX[0]], ZMM16); }, { 0x62, 0xc1, 0x7d, 0x48, 0xe7, 0x04, 0x0a } }, // vmovntdq [r10+rcx], zmm16
+        { [](auto& a) { a.vmovntdq(RAX[R09[0]], ZMM1); }, { 0x62, 0xb1, 0x7d, 0x48, 0xe7, 0x0c, 0x08 } }, // vmovntdq [rax+r9], zmm1
+        { [](auto& a) { a.vmaxreg(ZMM31); }, { 0x62, 0x03, 0x05, 0x40, 0x25, 0xff, 0xff } }, // vpternlogd zmm31, zmm31, zmm31, 0xff
+        { [](auto& a) { a.vaddpd(ZMM16, ZMM1, ZMM31, {}, Rounding::Nearest); }, { 0x62, 0x81, 0xf5, 0x18, 0x58, 0xc7 } }, // vaddpd zmm16, zmm1, zmm31, {rn-sae}
+        { [](auto& a) { a.vsubpd(ZMM0, ZMM1, ZMM2, {}, Rounding::Down); }, { 0x62, 0xf1, 0xf5, 0x38, 0x5c, 0xc2 } }, // vsubpd zmm0, zmm1, zmm2, {rd-sae}
+        { [](auto& a) { a.vmulpd(ZMM8, ZMM9, ZMM10, K4, Rounding::Up); }, { 0x62, 0x51, 0xb5, 0x5c, 0x59, 0xc2 } }, // vmulpd zmm8{k4}, zmm9, zmm10, {ru-sae}
+        { [](auto& a) { a.vdivpd(ZMM0, ZMM1, ZMM2, Mask::Z(K1), Rounding::Zero); }, { 0x62, 0xf1, 0xf5, 0xf9, 0x5e, 0xc2 } }, // vdivpd zmm0{k1}{z}, zmm1, zmm2, {rz-sae}
+        { [](auto& a) { a.vsqrtpd(ZMM5, ZMM23, {}, Rounding::Zero); }, { 0x62, 0xb1, 0xfd, 0x78, 0x51, 0xef } }, // vsqrtpd zmm5, zmm23, {rz-sae}
+        { [](auto& a) { a.vsqrtpd(YMM5, YMM6); }, { 0x62, 0xf1, 0xfd, 0x28, 0x51, 0xee } }, // {evex} vsqrtpd ymm5, ymm6
+        { [](auto& a) { a.vaddpd(Register::XMM(17), Register::XMM(1), Register::XMM(2)); }, { 0x62, 0xe1, 0xf5, 0x08, 0x58, 0xca } }, // vaddpd xmm17, xmm1, xmm2
+        { [](auto& a) { a.kmovq(K1, RAX); }, { 0xc4, 0xe1, 0xfb, 0x92, 0xc8 } }, // kmovq k1, rax
+        { [](auto& a) { a.kmovq(RCX, K2); }, { 0xc4, 0xe1, 0xfb, 0x93, 0xca } }, // kmovq rcx, k2
+        { [](auto& a) { a.kmovq(R11, K7); }, { 0xc4, 0x61, 0xfb, 0x93, 0xdf } }, // kmovq r11, k7
+    };
+
+    for (const auto& [emit, expected] : encodings) {
+        Context asmb{ 64 };
+        emit(asmb);
+        const auto code{ asmb.flushCode() };
+        testAssert(std::ranges::equal(code, expected));
+    }
+}
+
+void testCodeLayoutPolicy() {
+    const CodeLayoutPolicy no_padding{};
+    testAssert(no_padding.jumpPadding(30, 9) == 0);
+
+    const CodeLayoutPolicy jcc_erratum{ .jcc_erratum_padding = true };
+    testAssert(jcc_erratum.jumpPadding(0, 9) == 0);
+    testAssert(jcc_erratum.jumpPadding(22, 9) == 0);
+    testAssert(jcc_erratum.jumpPadding(23, 9) == 9); // Ends on boundary.
+    testAssert(jcc_erratum.jumpPadding(30, 9) == 2); // Crosses boundary.
+    testAssert(jcc_erratum.jumpPadding(63, 5) == 1);
+    testAssert(jcc_erratum.jumpPadding(64, 5) == 0);
+}
+
+void testBytecodeDecode() {
+    BytecodeCompiler compiler{};
+    RxProgram program{};
+
+    // Every opcode once, then in scattered order.
+    for (uint32_t stride : { 1, 167 }) {
+        for (uint32_t i = 0; i < program.instructions.size(); ++i) {
+            program.instructions[i] = RxInstruction{ .opcode = static_cast<uint8_t>(i * stride), .dst_register = 0xff, .src_register = 0xff, .mod = 0xff, .imm32 = 0xffff'ffff };
+        }
+
+        compiler.decode(program);
+
+        std::array<int16_t, 256> first_of_bytecode{};
+        first_of_bytecode.fill(-1);
+        for (uint32_t i = 0; i < program.instructions.size(); ++i) {
+            const Bytecode bytecode{ compiler.bytecodes[i] };
+            testAssert(bytecode == LUT_Opcode[program.instructions[i].opcode]);
+
+            // Effects depend only on bytecode.
+            auto& first{ first_of_bytecode[static_cast<uint8_t>(bytecode)] };
+            first = first < 0 ? static_cast<int16_t>(i) : first;
+            testAssert(compiler.effects[i] == compiler.effects[first]);
+        }
+    }
+}
+
 void testSuperscalarGenerate() {
     blake2b::Random gen{ key, 0 };
     Superscalar superscalar{ gen };
@@ -554,7 +781,8 @@ void testDatasetGenerate() {
         ssPrograms[i] = superscalar.generate();
     }
 
-    const auto dt3{ generateDataset(cache.view(), ssPrograms) };
+    // Other 4-batch compiler mode has to produce the same dataset.
+    const auto dt3{ generateDataset(cache.view(), ssPrograms, alternativeDatasetCompilerMode()) };
 
     testAssert(dt3[0][0] == 0xa8c6fc589b44ff7d);
     testAssert(dt3[0][1] == 0xc9f123dfe6668790);
@@ -573,6 +801,85 @@ void testDatasetGenerate() {
     testAssert(dt3[30000000][0] == 0x73ba6a6449e3d04e);
 }
 
+void testDatasetGenerateRange() {
+    HeapArray<argon2d::Block, 4096> cache(Rx_Argon2d_Memory_Blocks);
+    argon2d::fillMemory(cache.buffer(), key);
+    blake2b::Random blakeRNG{ key, 0 };
+
+    Superscalar superscalar{ blakeRNG };
+    std::array<SuperscalarProgram, Rx_Cache_Accesses> ssPrograms;
+    for (auto& program : ssPrograms) {
+        program = superscalar.generate();
+    }
+
+    HeapArray<DatasetItem, 4096> memory(2 * Dataset_Range_Alignment);
+    testAssert(generateDatasetRange(memory.buffer(), 2137208, cache.view(), ssPrograms));
+    testAssert(memory[5][7] == 0x1dac57c3f3a27a8);
+
+    testAssert(generateDatasetRange(memory.buffer(), 0, cache.view(), ssPrograms, {}, nullptr, alternativeDatasetCompilerMode()));
+    testAssert(memory[0][0] == 0x680588a85ae222db);
+    testAssert(memory[3][7] == 0x7908e227a0effb29);
+
+    // Last range contains padding items.
+    const auto padding_range{ memory.buffer().first(Dataset_Range_Alignment) };
+    testAssert(generateDatasetRange(padding_range, 34078712, cache.view(), ssPrograms));
+    testAssert(memory[7][7] == 0x10844958c957dfc2);
+
+    // Unaligned range is rejected.
+    bool thrown{ false };
+    try {
+        generateDatasetRange(padding_range, 34078713, cache.view(), ssPrograms);
+    } catch (const Exception&) {
+        thrown = true;
+    }
+    testAssert(thrown);
+}
+
+void testDataset() {
+    Dataset dataset;
+    testAssert(dataset.state() == DatasetState::Empty);
+    testAssert(dataset.key().empty());
+
+    // Cancelled generation is reported as incomplete.
+    dataset.start(key);
+    dataset.cancel();
+    testAssert(!dataset.wait());
+    testAssert(dataset.state() == DatasetState::Cancelled);
+    testAssert(!dataset.ready(key));
+
+    // Restarting with new key reuses memory of cancelled generation.
+    const auto memory{ dataset.view().data() };
+    dataset.start(key2);
+    testAssert(dataset.wait());
+    testAssert(dataset.state() == DatasetState::Ready);
+    testAssert(dataset.ready(key2));
+    testAssert(std::ranges::equal(dataset.key(), key2));
+    testAssert(dataset.progress() == 1.0);
+    testAssert(dataset.view().data() == memory);
+
+    const auto dt{ dataset.view() };
+    testAssert(dt[0][0] == 0x889746a65b1ad149);
+    testAssert(dt[0][7] == 0x36546a1d2438247a);
+    testAssert(dt[2137213][7] == 0x886c35ecc7d5c336);
+    testAssert(dt[30000000][0] == 0x464aa837b5128d9e);
+
+    // Reset with the same key does not regenerate dataset (e.g. when shared dataset was already reset by other user).
+    testAssert(dataset.reset(key2));
+    testAssert(dataset.progress() == 1.0);
+    testAssert(dataset.view()[0][0] == 0x889746a65b1ad149);
+
+    // Already finished generation can be restarted too.
+    testAssert(dataset.reset(key3));
+    testAssert(dataset.ready(key3) && !dataset.ready(key2));
+    testAssert(dataset.view()[0][0] == 0xa8c6fc589b44ff7d);
+    testAssert(dataset.view()[30000000][0] == 0x73ba6a6449e3d04e);
+
+    // Cache and programs are kept, so dataset items can be recalculated from them.
+    alignas(64) std::array<DatasetItem, Dataset_Range_Alignment> items;
+    testAssert(generateDatasetRange(items, 30000000, dataset.cache(), dataset.programs()));
+    testAssert(items[0][0] == 0x73ba6a6449e3d04e);
+}
+
 void testVM() {
     {
         RxHash expected{
@@ -593,9 +900,9 @@ void testVM() {
 
         auto dataset{ generateDataset(cache.view(), programs) };
         HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad(VirtualMachine::requiredMemory());
-        auto jit = makeExecutable<JITRxProgram>(12 * 1024);
+        DualMappedMemory jit(VirtualMachine::requiredCodeMemory());
 
-        VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), reinterpret_cast<JITRxProgram>(jit.get()));
+        VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), JITRxBuffer{ jit.writable(), jit.executable<JITRxProgram>() });
         BlockTemplate bt;
         std::memcpy(bt.data, block_template.data(), sizeof(block_template));
         vm.reset(bt, dataset);
@@ -608,6 +915,18 @@ void testVM() {
 
         testAssert(actual == expected);
         testAssert(vm.getPData().hashes == 1);
+
+        // Streaming interface hashes arbitrary inputs; block template and test input are hashed one after another.
+        const RxHash expected_input{
+            0x63, 0x91, 0x83, 0xaa, 0xe1, 0xbf, 0x4c, 0x9a, 0x35, 0x88, 0x4c, 0xb4, 0x6b, 0x09, 0xca, 0xd9,
+            0x17, 0x5f, 0x04, 0xef, 0xd7, 0x68, 0x4e, 0x72, 0x62, 0xa0, 0xac, 0x1c, 0x2f, 0x0b, 0x4e, 0x3f
+        };
+
+        vm.hashFirst(block_template, dataset.view());
+        testAssert(vm.hashNext(input) == expected);
+        testAssert(vm.hashLast() == expected_input);
+        testAssert(vm.hash(input, dataset.view()) == expected_input);
+        testAssert(vm.hash(block_template, dataset.view()) == expected);
     }
 
     {
@@ -629,9 +948,9 @@ void testVM() {
 
         auto dataset{ generateDataset(cache.view(), programs) };
         HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad(VirtualMachine::requiredMemory());
-        auto jit = makeExecutable<JITRxProgram>(12 * 1024);
+        DualMappedMemory jit(VirtualMachine::requiredCodeMemory());
 
-        VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), reinterpret_cast<JITRxProgram>(jit.get()));
+        VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), JITRxBuffer{ jit.writable(), jit.executable<JITRxProgram>() });
         BlockTemplate bt;
         std::memcpy(bt.data, block_template.data(), sizeof(block_template));
         bt.data[42] = 1;
@@ -655,3 +974,458 @@ void testVM() {
         testAssert(vm.getPData().hashes == 2);
     }
 }
+
+void testCApi() {
+    const auto flags{ randomx_get_flags() | RANDOMX_FLAG_FULL_MEM };
+    randomx_cache* cache{ randomx_alloc_cache(flags) };
+    testAssert(cache != nullptr);
+    randomx_init_cache(cache, key.data(), key.size());
+
+    // Light mode is not supported.
+    testAssert(randomx_create_vm(flags, cache, nullptr) == nullptr);
+
+    // Dataset is split at unaligned item, as callers initializing dataset from many threads do.
+    randomx_dataset* dataset{ randomx_alloc_dataset(flags) };
+    testAssert(dataset != nullptr);
+    const auto item_count{ randomx_dataset_item_count() };
+    testAssert(item_count == 34078719);
+    randomx_init_dataset(dataset, cache, 0, 17039363);
+    randomx_init_dataset(dataset, cache, 17039363, item_count - 17039363);
+
+    // Keys that do not fit into single Blake2b block (and empty ones) initialize cache as well.
+    const auto cacheDigest = [cache]() {
+        std::array<std::byte, 32> digest;
+        blake2b::hashAny(digest, const_span<std::byte>(static_cast<const std::byte*>(randomx_get_cache_memory(cache)), argon2d::Memory_Size));
+        return digest;
+    };
+
+    std::array<std::byte, 200> long_key{};
+    long_key.fill(std::byte{ 0x37 });
+    randomx_init_cache(cache, long_key.data(), long_key.size());
+    const auto long_key_digest{ cacheDigest() };
+    randomx_init_cache(cache, nullptr, 0);
+    testAssert(cacheDigest() != long_key_digest);
+    randomx_init_cache(cache, long_key.data(), long_key.size());
+    testAssert(cacheDigest() == long_key_digest);
+    randomx_release_cache(cache);
+
+    const auto items{ static_cast<const DatasetItem*>(randomx_get_dataset_memory(dataset)) };
+    testAssert(items[0][0] == 0x680588a85ae222db);
+    testAssert(items[2137213][7] == 0x1dac57c3f3a27a8); // Same item as checked in Dataset::generateRange test.
+
+    randomx_vm* vm{ randomx_create_vm(flags, nullptr, dataset) };
+    testAssert(vm != nullptr);
+
+    const std::array<std::array<uint8_t, RANDOMX_HASH_SIZE>, 3> expected{ {
+        { 0x63, 0x91, 0x83, 0xaa, 0xe1, 0xbf, 0x4c, 0x9a, 0x35, 0x88, 0x4c, 0xb4, 0x6b, 0x09, 0xca, 0xd9,
+          0x17, 0x5f, 0x04, 0xef, 0xd7, 0x68, 0x4e, 0x72, 0x62, 0xa0, 0xac, 0x1c, 0x2f, 0x0b, 0x4e, 0x3f },
+        { 0x30, 0x0a, 0x0a, 0xdb, 0x47, 0x60, 0x3d, 0xed, 0xb4, 0x22, 0x28, 0xcc, 0xb2, 0xb2, 0x11, 0x10,
+          0x4f, 0x4d, 0xa4, 0x5a, 0xf7, 0x09, 0xcd, 0x75, 0x47, 0xcd, 0x04, 0x9e, 0x94, 0x89, 0xc9, 0x69 },
+        { 0xc3, 0x6d, 0x4e, 0xd4, 0x19, 0x1e, 0x61, 0x73, 0x09, 0x86, 0x7e, 0xd6, 0x6a, 0x44, 0x3b, 0xe4,
+          0x07, 0x50, 0x14, 0xe2, 0xb0, 0x61, 0xbc, 0xda, 0xf9, 0xce, 0x7b, 0x72, 0x1d, 0x2b, 0x77, 0xa8 },
+    } };
+
+    std::array<uint8_t, RANDOMX_HASH_SIZE> actual{};
+    randomx_calculate_hash(vm, input.data(), input.size(), actual.data());
+    testAssert(actual == expected[0]);
+
+    randomx_calculate_hash(vm, input3.data(), input3.size(), actual.data());
+    testAssert(actual == expected[2]);
+
+    // Null dataset is ignored.
+    randomx_vm_set_dataset(vm, nullptr);
+    randomx_calculate_hash(vm, input.data(), input.size(), actual.data());
+    testAssert(actual == expected[0]);
+
+    // Pipelined hashing yields the same hashes.
+    randomx_calculate_hash_first(vm, input.data(), input.size());
+    randomx_calculate_hash_next(vm, input2.data(), input2.size(), actual.data());
+    testAssert(actual == expected[0]);
+    randomx_calculate_hash_next(vm, input3.data(), input3.size(), actual.data());
+    testAssert(actual == expected[1]);
+    randomx_calculate_hash_last(vm, actual.data());
+    testAssert(actual == expected[2]);
+
+    randomx_destroy_vm(vm);
+    randomx_release_dataset(dataset);
+}
+
+// Minimal coroutine type that starts eagerly and is never awaited itself.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+DetachedTask awaitHash(AsyncHasher& hasher, const_span<std::byte> input, AsyncHasher::Executor executor, RxHash& result, std::latch& done) {
+    result = co_await hasher.hash(input, std::move(executor));
+    done.count_down();
+}
+
+DetachedTask awaitAbandonedHash(AsyncHasher& hasher, const_span<std::byte> input, bool& failed, std::latch& done) {
+    try {
+        static_cast<void>(co_await hasher.hash(input));
+    } catch (const Exception&) {
+        failed = true;
+    }
+
+    done.count_down();
+}
+
+void testAsyncHasher() {
+    const std::array<RxHash, 3> expected{ {
+        { 0x63, 0x91, 0x83, 0xaa, 0xe1, 0xbf, 0x4c, 0x9a, 0x35, 0x88, 0x4c, 0xb4, 0x6b, 0x09, 0xca, 0xd9,
+          0x17, 0x5f, 0x04, 0xef, 0xd7, 0x68, 0x4e, 0x72, 0x62, 0xa0, 0xac, 0x1c, 0x2f, 0x0b, 0x4e, 0x3f },
+        { 0x30, 0x0a, 0x0a, 0xdb, 0x47, 0x60, 0x3d, 0xed, 0xb4, 0x22, 0x28, 0xcc, 0xb2, 0xb2, 0x11, 0x10,
+          0x4f, 0x4d, 0xa4, 0x5a, 0xf7, 0x09, 0xcd, 0x75, 0x47, 0xcd, 0x04, 0x9e, 0x94, 0x89, 0xc9, 0x69 },
+        { 0xc3, 0x6d, 0x4e, 0xd4, 0x19, 0x1e, 0x61, 0x73, 0x09, 0x86, 0x7e, 0xd6, 0x6a, 0x44, 0x3b, 0xe4,
+          0x07, 0x50, 0x14, 0xe2, 0xb0, 0x61, 0xbc, 0xda, 0xf9, 0xce, 0x7b, 0x72, 0x1d, 0x2b, 0x77, 0xa8 },
+    } };
+    const std::array<const_span<std::byte>, 3> inputs{ input, input2, input3 };
+
+    AsyncHasher hasher{ key, 0, 64 };
+
+    // Many more hashes in flight than VMs; half of coroutines are resumed inline, half through executor.
+    constexpr uint32_t Requests{ 24 };
+    std::array<RxHash, Requests> results{};
+    std::latch done{ Requests };
+    std::atomic<uint32_t> executed{ 0 };
+    const AsyncHasher::Executor executor{ [&executed](std::coroutine_handle<> handle) {
+        executed.fetch_add(1, std::memory_order_relaxed);
+        handle.resume();
+    } };
+
+    for (uint32_t i = 0; i < Requests; ++i) {
+        awaitHash(hasher, inputs[i % inputs.size()], i % 2 == 0 ? nullptr : executor, results[i], done);
+    }
+
+    done.wait();
+    testAssert(executed.load() == Requests / 2);
+    for (uint32_t i = 0; i < Requests; ++i) {
+        testAssert(results[i] == expected[i % expected.size()]);
+    }
+
+    // Duplicates may be calculated more than once while the first one is in flight, but afterwards all of them are served from cache.
+    const auto stats{ hasher.cacheStats() };
+    testAssert(stats.hits + stats.misses == Requests);
+
+    constexpr uint32_t Cached_Requests{ 3 };
+    std::array<RxHash, Cached_Requests> cached{};
+    std::latch cached_done{ Cached_Requests };
+    for (uint32_t i = 0; i < Cached_Requests; ++i) {
+        awaitHash(hasher, inputs[i], nullptr, cached[i], cached_done);
+    }
+
+    cached_done.wait();
+    testAssert(cached == expected);
+    testAssert(hasher.cacheStats().hits == stats.hits + Cached_Requests);
+
+    // Hasher sharing Dataset uses it as is, without generating it again.
+    AsyncHasher shared{ hasher.getDataset(), 1 };
+    shared.reset(key);
+    testAssert(shared.getDataset() == hasher.getDataset());
+
+    RxHash shared_result{};
+    std::latch shared_done{ 1 };
+    awaitHash(shared, input, nullptr, shared_result, shared_done);
+    shared_done.wait();
+    testAssert(shared_result == expected[0]);
+
+    // Hashes are calculated while Hasher mines with the same Dataset, even if its VirtualMachines occupy all shared pool workers.
+    Hasher miner{ hasher.getDataset() };
+    BlockTemplate bt;
+    std::memcpy(bt.data, block_template.data(), sizeof(block_template));
+    miner.resetVM(bt);
+    miner.run();
+
+    RxHash mining_result{};
+    std::latch mining_done{ 1 };
+    awaitHash(shared, input2, nullptr, mining_result, mining_done);
+    mining_done.wait();
+    miner.stop();
+    testAssert(mining_result == expected[1]);
+
+    // Key changed by other user of shared Dataset makes cached hashes unusable, so they are calculated again with new key.
+    shared.reset(key2);
+    const auto hits{ hasher.cacheStats().hits };
+
+    RxHash reset_result{};
+    std::latch reset_done{ 1 };
+    awaitHash(hasher, input, nullptr, reset_result, reset_done);
+    reset_done.wait();
+    testAssert(reset_result != expected[0]);
+    testAssert(hasher.cacheStats().hits == hits);
+
+    // Hash queued while Dataset is not generated is resumed with exception when hasher is destroyed.
+    bool abandoned_failed{ false };
+    std::latch abandoned_done{ 1 };
+    {
+        AsyncHasher empty{ std::make_shared<Dataset>(), 1 };
+        awaitAbandonedHash(empty, input, abandoned_failed, abandoned_done);
+    }
+
+    testAssert(abandoned_done.try_wait() && abandoned_failed);
+}
+
+void testHashCache() {
+    HashCache cache{ 100 };
+    const auto key_digest{ HashCache::digest(key) };
+    const auto other_key_digest{ HashCache::digest(byte_array('t', 'e', 's', 't', ' ', 'k', 'e', 'y', ' ', '0', '0', '1')) };
+    const auto input_digest{ HashCache::digest(input) };
+
+    testAssert(HashCache::digest(input) == input_digest);
+    testAssert(HashCache::digest(input2) != input_digest);
+    testAssert(!cache.find(key_digest, input_digest).has_value());
+
+    RxHash hash{};
+    hash.data.fill(0xab);
+    cache.insert(key_digest, input_digest, hash);
+    testAssert(cache.find(key_digest, input_digest) == hash);
+    testAssert(!cache.find(other_key_digest, input_digest).has_value());
+    testAssert(!cache.find(key_digest, HashCache::digest(input2)).has_value());
+
+    const auto stats{ cache.stats() };
+    testAssert(stats.hits == 1 && stats.misses == 3);
+    testAssert(stats.hitRate() == 0.25);
+
+    cache.clear();
+    testAssert(!cache.find(key_digest, input_digest).has_value());
+    testAssert(cache.stats().hits == 0 && cache.stats().misses == 1);
+}
+
+void testHasherJobs() {
+    const RxHash expected{
+        0x58, 0x16, 0xfd, 0xd8, 0xd8, 0xa3, 0x77, 0x78, 0x89, 0x63, 0x23, 0xf0, 0x9c, 0x65, 0x52, 0x94,
+        0x8e, 0xb5, 0x0a, 0xac, 0x12, 0x97, 0x23, 0x8b, 0xd7, 0x6e, 0xcd, 0xb5, 0x38, 0xc8, 0xc8, 0x57
+    };
+
+    Hasher hasher{ key };
+    const auto dataset{ hasher.getDataset() };
+
+    BlockTemplate bt;
+    std::memcpy(bt.data, block_template.data(), sizeof(block_template));
+    BlockTemplate bt2{ bt };
+    bt2.data[0] ^= 0xff;
+
+    HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad(VirtualMachine::requiredMemory());
+    DualMappedMemory jit(VirtualMachine::requiredCodeMemory());
+    VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), JITRxBuffer{ jit.writable(), jit.executable<JITRxProgram>() });
+    const auto expected2{ vm.hash(bt2.view(), dataset->view()) };
+
+    // First VirtualMachine starts every job from its block template, so its hash has to be among job's results.
+    std::mutex mutex;
+    bool found{ false }, found2{ false };
+    hasher.resetVM(bt);
+    const auto job_id{ hasher.addJob(bt2, dataset, 3, [&](const RxHash& hash) {
+        std::lock_guard lock{ mutex };
+        found2 = found2 || hash == expected2;
+    }) };
+
+    hasher.run([&](const RxHash& hash) {
+        std::lock_guard lock{ mutex };
+        found = found || hash == expected;
+    });
+
+    while (hasher.hashes() < 1024) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    hasher.stop();
+    testAssert(found && found2);
+
+    // Job with weight 3 gets about 3 times more hashes than default job with weight 1.
+    const auto hashes{ hasher.hashes() };
+    const auto job_hashes{ hasher.hashes(job_id) };
+    testAssert(job_hashes < hashes);
+
+    const auto ratio{ static_cast<double>(job_hashes) / (hashes - job_hashes) };
+    testAssert(ratio > 2.0 && ratio < 4.0);
+
+    hasher.removeJob(job_id);
+    testAssert(hasher.hashes(job_id) == 0);
+    testAssert(hasher.hashes() == hashes);
+
+    // Weights above Max_Job_Weight are clamped, so such job does not starve other heavy jobs.
+    const auto heavy_id{ hasher.addJob(bt2, dataset, std::numeric_limits<uint32_t>::max()) };
+    const auto max_id{ hasher.addJob(bt2, dataset, Hasher::Max_Job_Weight) };
+    hasher.run([](const RxHash&) {});
+
+    while (hasher.hashes(heavy_id) + hasher.hashes(max_id) < 256) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    hasher.stop();
+    const auto heavy_ratio{ static_cast<double>(hasher.hashes(heavy_id)) / hasher.hashes(max_id) };
+    testAssert(heavy_ratio > 0.5 && heavy_ratio < 2.0);
+}
+
+void testHasherReset() {
+    Hasher hasher{ key };
+    const auto dataset{ hasher.getDataset() };
+
+    BlockTemplate bt;
+    std::memcpy(bt.data, block_template.data(), sizeof(block_template));
+
+    HeapArray<std::byte, Rx_Scratchpad_L3_Size> scratchpad(VirtualMachine::requiredMemory());
+    DualMappedMemory jit(VirtualMachine::requiredCodeMemory());
+    VirtualMachine vm(scratchpad.buffer<VirtualMachine::requiredMemory()>(), JITRxBuffer{ jit.writable(), jit.executable<JITRxProgram>() });
+
+    // Hashes of consecutive nonces with the first key; reset has to take effect before all of them are hashed.
+    constexpr uint32_t Max_Hashes_Before_Reset{ 256 };
+    std::vector<RxHash> expected;
+    vm.reset(bt, dataset->view());
+    vm.execute(nullptr); // First 'execute' after reset does only initialization.
+    for (uint32_t i = 0; i < Max_Hashes_Before_Reset; ++i) {
+        vm.execute([&expected](const RxHash& hash) { expected.push_back(hash); });
+    }
+
+    // Only the first VirtualMachine runs, so hashes are reported in order of consecutive nonces.
+    std::mutex mutex;
+    std::vector<RxHash> results;
+    hasher.setActiveVMs(1);
+    hasher.resetVM(bt);
+    hasher.run([&](const RxHash& hash) {
+        std::lock_guard lock{ mutex };
+        results.push_back(hash);
+    });
+
+    while (hasher.hashes() == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Dataset is regenerated while hashing; slice in progress is finished with previous content.
+    hasher.reset(byte_array('t', 'e', 's', 't', ' ', 'k', 'e', 'y', ' ', '0', '0', '1'));
+    const auto hashes_after_reset{ hasher.hashes() };
+    while (hasher.hashes() < hashes_after_reset + 32) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    hasher.stop();
+
+    // Every hash was calculated either with the first key or, from some nonce on, with the second one; none with partially rewritten dataset.
+    size_t first_key_hashes{ 0 };
+    while (first_key_hashes < results.size() && first_key_hashes < expected.size() && results[first_key_hashes] == expected[first_key_hashes]) {
+        ++first_key_hashes;
+    }
+
+    testAssert(first_key_hashes > 0 && first_key_hashes < expected.size());
+
+    size_t nonce{ 0 };
+    size_t second_key_hashes{ 0 };
+    vm.reset(bt, dataset->view());
+    vm.execute(nullptr);
+    while (nonce < results.size()) {
+        vm.execute([&](const RxHash& hash) {
+            if (nonce >= first_key_hashes && results[nonce] == hash) {
+                ++second_key_hashes;
+            }
+
+            ++nonce;
+        });
+    }
+
+    testAssert(first_key_hashes + second_key_hashes == results.size());
+}
+
+void testHasherParking() {
+    Hasher hasher{ key };
+
+    BlockTemplate bt;
+    std::memcpy(bt.data, block_template.data(), sizeof(block_template));
+
+    const auto waitHashes = [&hasher](const uint64_t hashes) {
+        while (hasher.hashes() <= hashes) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    const auto waitParked = [&hasher](const uint32_t parked) {
+        while (hasher.parkedVMs() != parked) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    hasher.resetVM(bt);
+    hasher.run([](const RxHash&) {});
+    waitHashes(0);
+
+    // Parked VirtualMachines finish their current slice and then stop hashing.
+    hasher.setActiveVMs(0);
+    testAssert(hasher.activeVMs() == 0);
+    waitParked(hasher.maxVMs());
+
+    const auto hashes{ hasher.hashes() };
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    testAssert(hasher.hashes() == hashes);
+    testAssert(hasher.parkedVMs() == hasher.maxVMs());
+
+    // Unparked VirtualMachines continue where they stopped, without reset.
+    hasher.setActiveVMs(std::numeric_limits<uint32_t>::max());
+    testAssert(hasher.activeVMs() == hasher.maxVMs());
+    waitParked(0);
+    waitHashes(hashes);
+
+    // Stopping must not block on parked VirtualMachines.
+    hasher.setActiveVMs(0);
+    waitParked(hasher.maxVMs());
+    hasher.stop();
+    testAssert(hasher.parkedVMs() == 0);
+    hasher.setActiveVMs(hasher.maxVMs());
+}
+
+void testHasherElastic() {
+    Hasher hasher{};
+    const auto max_vms{ hasher.maxVMs() };
+    const auto min_vms{ max_vms / 2 };
+
+    // Enough high readings to park down to min_vms and then enough low ones to unpark all VirtualMachines.
+    const auto steps{ max_vms + 2 };
+    std::vector<uint32_t> active;
+    std::latch done{ 1 };
+
+    ElasticOptions options{ .min_vms = min_vms, .interval = std::chrono::milliseconds(1) };
+    options.pressure_source = [&]() -> std::optional<double> {
+        if (active.size() > 2 * steps) {
+            return std::nullopt;
+        }
+
+        // Active VirtualMachines are recorded before the reading is applied.
+        active.push_back(hasher.activeVMs());
+        if (active.size() > 2 * steps) {
+            done.count_down();
+            return std::nullopt;
+        }
+
+        return active.size() <= steps ? 1.0 : 0.0;
+    };
+
+    hasher.startElastic(options);
+    done.wait();
+    hasher.stopElastic();
+
+    // Exactly one VirtualMachine is parked or unparked per reading, never below min_vms.
+    testAssert(active[0] == max_vms);
+    for (uint32_t i = 1; i <= steps; ++i) {
+        testAssert(active[i] == std::max(active[i - 1], min_vms + 1) - 1);
+    }
+
+    testAssert(active[steps] == min_vms);
+    for (uint32_t i = steps + 1; i <= 2 * steps; ++i) {
+        testAssert(active[i] == std::min(active[i - 1] + 1, max_vms));
+    }
+
+    testAssert(active[2 * steps] == max_vms);
+
+    bool thrown{ false };
+    try {
+        hasher.startElastic(ElasticOptions{ .park_pressure = 0.01, .unpark_pressure = 0.5 });
+    } catch (const Exception&) {
+        thrown = true;
+    }
+
+    testAssert(thrown);
+}